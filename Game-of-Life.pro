@@ -0,0 +1,39 @@
+# qmake project file for the Game of Life GUI.
+TEMPLATE = app
+TARGET = Game-of-Life
+CONFIG += qt thread release
+QMAKE_CXXFLAGS += -std=c++11
+LIBS += -pthread
+
+HEADERS += boardwidget.h \
+           cell.h \
+           density.h \
+           edges.h \
+           gridwindow.h \
+           hashlife.h \
+           history.h \
+           kernel.h \
+           patternio.h \
+           simulation.h \
+           snapshot.h \
+           sparseplane.h \
+           threadpool.h \
+           world.h
+
+SOURCES += boardwidget.cpp \
+           cell.cpp \
+           density.cpp \
+           edges.cpp \
+           gridwindow.cpp \
+           hashlife.cpp \
+           history.cpp \
+           kernel.cpp \
+           kernel_avx2.cpp \
+           kernel_avx512.cpp \
+           main.cpp \
+           patternio.cpp \
+           simulation.cpp \
+           snapshot.cpp \
+           sparseplane.cpp \
+           threadpool.cpp \
+           world.cpp
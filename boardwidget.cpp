@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cmath>
+#include "boardwidget.h"
+
+using namespace std;
+
+// Constructor: Creates the board widget. It draws nothing until it is shown a frame.
+BoardWidget::BoardWidget(QWidget *parent)
+: QWidget(parent)
+{
+    frame = NULL;
+    stale = true;
+    level = -1;
+    scale = 1;
+    originX = originY = 0;
+    fitted = true;
+    painting = false;
+    paintHealth = false;
+    paintedRow = paintedCol = -1;
+    panning = false;
+
+    // Any life at all shows as light gray, darkening to black as the block fills up. The square root brings out
+    // sparse life, which would otherwise be too pale to see.
+    shades[0] = qRgb(255, 255, 255);
+    for(int i = 1; i < 256; i++)
+    {
+        int gray = (int)(210 * (1 - sqrt((i - 1) / 254.0)));
+        shades[i] = qRgb(gray, gray, gray);
+    }
+}
+
+// Basic destructor.
+BoardWidget::~BoardWidget()
+{
+}
+
+// Marks the board as changed and asks Qt for a repaint. Several refreshes before the next paint cost one render.
+void BoardWidget::refresh()
+{
+    stale = true;
+    update();
+}
+
+// Shows the next frame of the simulation. Only the tiles of the board that the frame says have changed since
+// the frame before are redrawn, and Qt is asked to repaint just those parts of the widget. A settled board has
+// no changed tiles and costs nothing. Runs of changed tiles next to each other in a row of tiles are redrawn
+// together. The frame must stay as it is until the next one is shown.
+void BoardWidget::showFrame(const SimulationFrame *next)
+{
+    bool resized = frame == NULL || frame->rows != next->rows || frame->cols != next->cols;
+    frame = next;
+    if(resized)
+    {
+        fitted = true;                          // A new board is shown whole.
+        clampView();
+        updateGeometry();                       // The size hint follows the board.
+        refresh();
+    }
+    if(stale)
+        return;                                 // The next paint renders everything anyway.
+    const vector<unsigned char> &dirtyTiles = frame->dirty;
+    int tileRows = frame->tileRows, tileCols = frame->tileCols;
+    int across = (frame->cols + tileCols - 1) / tileCols;
+    int down = (int)dirtyTiles.size() / across;
+    int shift = (level >= 0) ? frame->density.getBlockShift(level) : 0;    // A pixel shows a whole block.
+    for(int i = 0; i < down; i++)
+    {
+        for(int j = 0; j < across; j++)
+        {
+            if(dirtyTiles[(size_t)i * across + j] == 0)
+                continue;
+            int first = j;
+            while(j + 1 < across && dirtyTiles[(size_t)i * across + j + 1] != 0)
+                j++;
+
+            // The image rows and columns that show the cells of the run of tiles, or the blocks around them.
+            long long rowBegin = ((long long)i * tileRows >> shift) << shift;
+            long long rowEnd = ((((long long)(i + 1) * tileRows - 1) >> shift) + 1) << shift;
+            long long colBegin = ((long long)first * tileCols >> shift) << shift;
+            long long colEnd = ((((long long)(j + 1) * tileCols - 1) >> shift) + 1) << shift;
+            int top = lower_bound(sampleRows.begin(), sampleRows.end(), rowBegin) - sampleRows.begin();
+            int bottom = lower_bound(sampleRows.begin(), sampleRows.end(), rowEnd) - sampleRows.begin();
+            int left = lower_bound(sampleCols.begin(), sampleCols.end(), colBegin) - sampleCols.begin();
+            int right = lower_bound(sampleCols.begin(), sampleCols.end(), colEnd) - sampleCols.begin();
+            if(top < bottom && left < right)
+            {
+                render(top, bottom, left, right);
+                update(imageToWidget(top, bottom, left, right));
+            }
+        }
+    }
+}
+
+// Zooms out (or in) to show the whole board, and keeps it fitted to the widget until the user zooms or pans.
+void BoardWidget::fitBoard()
+{
+    fitted = true;
+    clampView();
+    refresh();
+}
+
+// Zooms by a factor, keeping the cell under a point of the widget where it is. Cells can be made up to 64 pixels
+// wide (or as wide as the board fitted to the widget, if that is wider), and the board half the size of the widget.
+void BoardWidget::zoomAt(const QPoint &point, double factor)
+{
+    if(frame == NULL || frame->rows == 0)
+        return;
+    double x = originX + point.x() / scale, y = originY + point.y() / scale;
+    scale = min(max(scale * factor, fitScale() / 2), max(64.0, fitScale()));
+    originX = x - point.x() / scale;
+    originY = y - point.y() / scale;
+    fitted = false;
+    clampView();
+    refresh();
+}
+
+// Accessor method - Gets the width of a cell on the widget, in pixels.
+double BoardWidget::getScale() const
+{
+    return scale;
+}
+
+// Asks for 19x19 pixel cells, as the grid of buttons had, but no more than a typical screen.
+QSize BoardWidget::sizeHint() const
+{
+    if(frame == NULL || frame->rows == 0)
+        return QSize(400, 300);
+    return QSize((int)min(19LL * frame->cols, 1600LL), (int)min(19LL * frame->rows, 900LL));
+}
+
+// Hit-tests a point of the widget: finds the cell drawn under it. Returns false if the point is off of the board.
+bool BoardWidget::cellAt(const QPoint &point, int &row, int &col) const
+{
+    if(frame == NULL || frame->rows == 0)
+        return false;
+    double x = floor(originX + (point.x() + 0.5) / scale), y = floor(originY + (point.y() + 0.5) / scale);
+    if(x < 0 || y < 0 || x >= frame->cols || y >= frame->rows)
+        return false;
+    col = (int)x;
+    row = (int)y;
+    return true;
+}
+
+// Works out the scale at which the whole board fits the widget.
+double BoardWidget::fitScale() const
+{
+    if(frame == NULL || frame->rows == 0 || width() <= 0 || height() <= 0)
+        return 1;
+    return min((double)width() / frame->cols, (double)height() / frame->rows);
+}
+
+// Fits the board to the widget if it is still fitted, and otherwise keeps the center of the widget over the board
+// so that it cannot be lost by panning away from it.
+void BoardWidget::clampView()
+{
+    if(frame == NULL || frame->rows == 0)
+        return;
+    double halfWidth = width() / (2 * scale), halfHeight = height() / (2 * scale);
+    if(fitted)
+    {
+        scale = fitScale();
+        halfWidth = width() / (2 * scale);
+        halfHeight = height() / (2 * scale);
+        originX = frame->cols / 2.0 - halfWidth;
+        originY = frame->rows / 2.0 - halfHeight;
+        return;
+    }
+    originX = min(max(originX + halfWidth, 0.0), (double)frame->cols) - halfWidth;
+    originY = min(max(originY + halfHeight, 0.0), (double)frame->rows) - halfHeight;
+}
+
+// Sizes the image for the view. Zoomed in, it holds one pixel for each cell in view and is stretched onto the
+// widget. Zoomed out, it holds one pixel for each screen pixel over the board, sampling the cell at its center,
+// or once a pixel covers 8 cells or more, the biggest block of the density pyramid that fits in the pixel. The
+// sample tables are built once per view.
+void BoardWidget::layoutImage()
+{
+    clampView();
+    level = -1;
+    int w = 0, h = 0;
+    if(scale >= 1)
+    {
+        int c0 = max(0, (int)floor(originX)), c1 = min(frame->cols, (int)ceil(originX + width() / scale));
+        int r0 = max(0, (int)floor(originY)), r1 = min(frame->rows, (int)ceil(originY + height() / scale));
+        w = max(0, c1 - c0);
+        h = max(0, r1 - r0);
+        sampleCols.resize(w);
+        for(int x = 0; x < w; x++)
+            sampleCols[x] = c0 + x;
+        sampleRows.resize(h);
+        for(int y = 0; y < h; y++)
+            sampleRows[y] = r0 + y;
+        imageTarget = QRectF((c0 - originX) * scale, (r0 - originY) * scale, w * scale, h * scale);
+    }
+    else
+    {
+        int x0 = max(0, (int)ceil(-originX * scale - 0.5)), x1 = min(width(), (int)ceil((frame->cols - originX) * scale - 0.5));
+        int y0 = max(0, (int)ceil(-originY * scale - 0.5)), y1 = min(height(), (int)ceil((frame->rows - originY) * scale - 0.5));
+        w = max(0, x1 - x0);
+        h = max(0, y1 - y0);
+        sampleCols.resize(w);
+        for(int x = 0; x < w; x++)
+            sampleCols[x] = min(max((int)floor(originX + (x0 + x + 0.5) / scale), 0), frame->cols - 1);
+        sampleRows.resize(h);
+        for(int y = 0; y < h; y++)
+            sampleRows[y] = min(max((int)floor(originY + (y0 + y + 0.5) / scale), 0), frame->rows - 1);
+        imageTarget = QRectF(x0, y0, w, h);
+
+        const DensityPyramid &density = frame->density;
+        double footprint = 1 / scale;               // The cells across a pixel.
+        if(density.getLevels() > 0 && footprint >= (1 << density.getBlockShift(0)))
+        {
+            level = 0;
+            while(level + 1 < density.getLevels() && (double)(1LL << density.getBlockShift(level + 1)) <= footprint)
+                level++;
+        }
+    }
+    if(image.width() != w || image.height() != h)
+        image = (w > 0 && h > 0) ? QImage(w, h, QImage::Format_RGB32) : QImage();
+}
+
+// Renders the image rows [top, bottom) and columns [left, right) from the frame: from its packed cells, or from the
+// live counts of its density pyramid.
+void BoardWidget::render(int top, int bottom, int left, int right)
+{
+    if(level < 0)
+    {
+        const QRgb colors[2] = {qRgb(255, 255, 255), qRgb(0, 0, 0)};     // DEAD = white, LIVE = black.
+        const uint64_t *board = &frame->cells[0];
+        const int64_t stride = frame->words;
+        for(int y = top; y < bottom; y++)
+        {
+            const uint64_t *line = board + sampleRows[y] * stride;
+            QRgb *out = (QRgb *)image.scanLine(y);
+            for(int x = left; x < right; x++)
+                out[x] = colors[(line[sampleCols[x] >> 6] >> (sampleCols[x] & 63)) & 1];
+        }
+        return;
+    }
+
+    const DensityPyramid &density = frame->density;
+    const uint32_t *counts = density.getLevel(level);
+    const int64_t across = density.getLevelCols(level);
+    const int shift = density.getBlockShift(level);
+    const uint64_t area = (uint64_t)1 << (2 * shift);
+    for(int y = top; y < bottom; y++)
+    {
+        const uint32_t *line = counts + (sampleRows[y] >> shift) * across;
+        QRgb *out = (QRgb *)image.scanLine(y);
+        for(int x = left; x < right; x++)
+        {
+            uint64_t count = line[sampleCols[x] >> shift];
+            out[x] = shades[count == 0 ? 0 : min(1 + count * 254 / area, (uint64_t)255)];
+        }
+    }
+}
+
+// Works out the part of the widget a block of the image is stretched over, with a pixel to spare on each side
+// for rounding.
+QRect BoardWidget::imageToWidget(int top, int bottom, int left, int right) const
+{
+    double pixelWidth = imageTarget.width() / image.width(), pixelHeight = imageTarget.height() / image.height();
+    int x0 = (int)floor(imageTarget.left() + left * pixelWidth) - 1;
+    int x1 = (int)ceil(imageTarget.left() + right * pixelWidth) + 1;
+    int y0 = (int)floor(imageTarget.top() + top * pixelHeight) - 1;
+    int y1 = (int)ceil(imageTarget.top() + bottom * pixelHeight) + 1;
+    return QRect(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+// Draws the board in view, rendering it first if the view or the board changed. Cells big enough to see get the
+// thin borders the grid of buttons used to have.
+void BoardWidget::paintEvent(QPaintEvent *)
+{
+    if(frame == NULL || frame->rows == 0)
+        return;
+    if(stale)
+    {
+        stale = false;
+        layoutImage();
+        if(!image.isNull())
+            render(0, image.height(), 0, image.width());
+    }
+    if(image.isNull())
+        return;
+    QPainter painter(this);
+    painter.drawImage(imageTarget, image, QRectF(0, 0, image.width(), image.height()));
+
+    if(scale >= 5)
+    {
+        painter.setPen(QColor(Qt::lightGray));
+        int top = (int)floor(imageTarget.top()), bottom = (int)ceil(imageTarget.top() + imageTarget.height());
+        int left = (int)floor(imageTarget.left()), right = (int)ceil(imageTarget.left() + imageTarget.width());
+        for(int j = sampleCols.front(); j <= sampleCols.back() + 1; j++)
+        {
+            int x = (int)floor((j - originX) * scale + 0.5);
+            painter.drawLine(x, top, x, bottom);
+        }
+        for(int i = sampleRows.front(); i <= sampleRows.back() + 1; i++)
+        {
+            int y = (int)floor((i - originY) * scale + 0.5);
+            painter.drawLine(left, y, right, y);
+        }
+    }
+}
+
+// The image depends on the size of the widget, so it is rendered again on the next paint.
+void BoardWidget::resizeEvent(QResizeEvent *)
+{
+    clampView();
+    stale = true;
+}
+
+// Flips the cell under the mouse (DEAD/white to LIVE/black or back) and keeps painting that state while dragging
+// with the left button. The right button drags the board around instead.
+void BoardWidget::mousePressEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::RightButton)
+    {
+        panning = true;
+        panFrom = event->pos();
+        return;
+    }
+    int row, col;
+    if(event->button() != Qt::LeftButton || !cellAt(event->pos(), row, col))
+        return;
+    painting = true;
+    paintHealth = !isHealthy(row, col);
+    paintedRow = paintedCol = -1;
+    paintCell(event->pos());
+}
+
+// Paints the cells the mouse is dragged over, or drags the board along with the mouse.
+void BoardWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if(panning)
+    {
+        originX -= (event->pos().x() - panFrom.x()) / scale;
+        originY -= (event->pos().y() - panFrom.y()) / scale;
+        panFrom = event->pos();
+        fitted = false;
+        clampView();
+        refresh();
+    }
+    else if(painting)
+        paintCell(event->pos());
+}
+
+// Stops painting cells or dragging the board.
+void BoardWidget::mouseReleaseEvent(QMouseEvent *)
+{
+    painting = false;
+    panning = false;
+}
+
+// Zooms in or out by a quarter for each notch of the wheel, around the mouse.
+void BoardWidget::wheelEvent(QWheelEvent *event)
+{
+    zoomAt(event->pos(), pow(1.25, event->delta() / 120.0));
+}
+
+// Reads a cell of the frame on display.
+bool BoardWidget::isHealthy(int row, int col) const
+{
+    return (frame->cells[(size_t)row * frame->words + (col >> 6)] >> (col & 63)) & 1;
+}
+
+// Asks for the cell under a point to be set to the health being painted, if it is not already. The change shows
+// up with the next frame, so the cell is only asked for once while the mouse stays on it.
+void BoardWidget::paintCell(const QPoint &point)
+{
+    int row, col;
+    if(!cellAt(point, row, col) || isHealthy(row, col) == paintHealth || (row == paintedRow && col == paintedCol))
+        return;
+    paintedRow = row;
+    paintedCol = col;
+    emit cellEdited(row, col, paintHealth);
+}
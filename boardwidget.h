@@ -0,0 +1,91 @@
+// A header file for a widget that draws a board of cells, zoomed and panned.
+#ifndef BOARDWIDGET_H_
+#define BOARDWIDGET_H_
+
+#include <vector>
+#include <QWidget>
+#include <QImage>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QWheelEvent>
+#include <QResizeEvent>
+#include <QRect>
+#include <QRectF>
+#include <QColor>
+#include <stdint.h>
+#include "simulation.h"
+
+/*
+Class: BoardWidget.
+    A single widget that draws a frame published by the simulation through a viewport that can be zoomed
+    (with the mouse wheel, around the mouse) and panned (by dragging with the right mouse button) over a
+    board of any size.  Until the user zooms or pans, the whole board is fitted to the widget.
+    Only the part of the board in view is rendered, into a QImage that QPainter stretches onto the
+    screen: one pixel per cell when cells are bigger than a pixel, and one pixel per screen pixel when
+    they are smaller.  Zoomed out that far, each pixel shows the cell at its center until a pixel covers
+    8 cells or more; from there on it is shaded by the live count of a block of the frame's density
+    pyramid as big as the pixel, so sparse life stays visible and the cost of a frame depends on the
+    size of the widget and not on the size of the board.  For each new frame only the tiles it reports
+    as changed are rendered and repainted, so a settled board costs nothing to show.
+    The widget never touches the world itself: clicks are mapped back to the cell under the mouse and
+    sent out as cellEdited() for the simulation to apply.  Clicking flips the cell and dragging paints
+    the same state onto every cell the mouse passes over.
+*/
+class BoardWidget : public QWidget
+{
+    Q_OBJECT                            // Macro allowing us to have signals & slots on this object.
+
+    private:
+        const SimulationFrame *frame;   // The frame on display, held until the next one is shown.
+        QImage image;                   // The board in view as last rendered, one pixel per sampled cell or block.
+        bool stale;                     // Set when the board must be rendered again before painting.
+        std::vector<int> sampleRows;    // The board row at the center of each row of the image.
+        std::vector<int> sampleCols;    // The board column at the center of each column of the image.
+        int level;                      // The level of the density pyramid drawn, or -1 to draw cells.
+        QRectF imageTarget;             // Where the image is drawn on the widget.
+        QRgb shades[256];               // Colors from DEAD/white to all LIVE/black, for the density of a block.
+        double scale;                   // The width of a cell on the widget, in pixels.
+        double originX;                 // The board column at the widget's left edge.
+        double originY;                 // The board row at the widget's top edge.
+        bool fitted;                    // Set while the whole board is fitted to the widget.
+        bool painting;                  // Set while the left mouse button is down on the board.
+        bool paintHealth;               // The health painted onto the cells the mouse drags over.
+        int paintedRow;                 // The cell painted last, so that it is only sent once per drag.
+        int paintedCol;
+        bool panning;                   // Set while the board is being dragged around.
+        QPoint panFrom;                 // Where the mouse was when the board was last dragged.
+
+    public:
+        BoardWidget(QWidget *parent = NULL);            // Constructor.
+        virtual ~BoardWidget();                         // Destructor.
+        void refresh();                                 // Redraws the whole board from the frame on display.
+        void showFrame(const SimulationFrame *next);    // Shows a new frame, redrawing only the tiles it changed.
+        void fitBoard();                                // Zooms out (or in) to show the whole board.
+        void zoomAt(const QPoint &point, double factor);    // Zooms keeping the cell under a point where it is.
+        double getScale() const;                        // The width of a cell on the widget, in pixels.
+        bool cellAt(const QPoint &point, int &row, int &col) const;    // Hit-tests a point of the widget.
+        virtual QSize sizeHint() const;                 // Asks for 19x19 pixel cells, as the old grid had.
+
+    signals:
+        void cellEdited(int row, int col, bool health);     // The user set a cell to LIVE (true) or DEAD (false).
+
+    protected:
+        virtual void paintEvent(QPaintEvent *event);            // Draws the board.
+        virtual void resizeEvent(QResizeEvent *event);          // Renders the board again at the new size.
+        virtual void mousePressEvent(QMouseEvent *event);       // Flips the cell under the mouse, or starts panning.
+        virtual void mouseMoveEvent(QMouseEvent *event);        // Paints cells or pans while the mouse is dragged.
+        virtual void mouseReleaseEvent(QMouseEvent *event);     // Stops painting or panning.
+        virtual void wheelEvent(QWheelEvent *event);            // Zooms around the mouse.
+
+    private:
+        double fitScale() const;        // The scale at which the whole board fits the widget.
+        void clampView();               // Keeps the center of the widget over the board.
+        void layoutImage();             // Sizes the image and picks what it samples for the view.
+        void render(int top, int bottom, int left, int right);     // Renders a block of the image from the frame.
+        QRect imageToWidget(int top, int bottom, int left, int right) const;   // Where a block of the image is drawn.
+        bool isHealthy(int row, int col) const; // Reads a cell of the frame on display.
+        void paintCell(const QPoint &point);    // Sets the cell under a point to the health being painted.
+};
+
+#endif
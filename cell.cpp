@@ -15,26 +15,16 @@
 
 #include "cell.h"
 
-// Initialize the population iterators to 0
-int Cell::population = 0;
-int Cell::living = 0;
-int Cell::deceased = 0;
-
 Cell::Cell()
 {
 	breed = normal;
 	health = false;
-	deceased++;
 }
 
 Cell::Cell(species aBreed, bool aHealth)
 {
 	breed = aBreed;
 	health = aHealth;
-	if(aHealth)
-		living++;
-	else
-		deceased++;
 }
 
 Cell::~Cell(){}
@@ -49,33 +39,8 @@ bool Cell::isHealthy() const
 	return health;
 }
 
-int Cell::getPopulation() const
-{
-	return population;
-}
-
-int Cell::getLiving() const
-{
-	return living;
-}
-
-int Cell::getDeceased() const
-{
-	return deceased;
-}
-
 void Cell::setHealth(bool newHealth)
 {
-	if(health && !newHealth)
-	{
-		living--;
-		deceased++;
-	}
-	else if(!health && newHealth)
-	{
-		living++;
-		deceased--;
-	}
 	health = newHealth;
 }
 
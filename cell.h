@@ -33,15 +33,6 @@ private:
 	dead. */
 	bool health;
 
-	/* The running number of cells created. */
-	static int population;
-
-	/* The running number of alive cells. */
-	static int living;
-
-	/* The running number of deceased cells. */
-	static int deceased;
-
 public:
 
 /***************************************************************************************************
@@ -55,8 +46,7 @@ public:
 	The default constructor.
 
  Description:
-	Initializes the breed of the cell to normal and the health of the cell to dead (FALSE). Iterates
-	the population and the deceased.
+	Initializes the breed of the cell to normal and the health of the cell to dead (FALSE).
 ***************************************************************************************************/
 
 	Cell();
@@ -69,10 +59,7 @@ public:
 	Public.
 
  Description:
-	A constructor. Initializes the breed and health of the cell to the specified values. Iterates
-    the population. If the health of the cell being created is specified as dead (FALSE), the living
-    are incremented. Conversely, if the health of the cell being created is specified as dead
-    (FALSE), the deceased are incremented.
+	A constructor. Initializes the breed and health of the cell to the specified values.
 
  Parameters:
 	1.	species aBreed - The breed of the cell.
@@ -127,54 +114,6 @@ public:
 
 	bool isHealthy() const;
 
-/***************************************************************************************************
- Method:
-	int getPopulation() const
-
- Scope:
-	Public.
-
- Description:
-    Gets the population of cells.
-
- Returns:
-	This method returns the population of the cells.
-***************************************************************************************************/
-
-	int getPopulation() const;
-
-/***************************************************************************************************
- Method:
-	int getLiving() const
-
- Scope:
-	Public.
-
- Description:
-	Gets the population of living cells.
-
- Returns:
-	This method returns the population of living cells.
-***************************************************************************************************/
-
-	int getLiving() const;
-
-/***************************************************************************************************
- Method:
-	int getDeceased() const
-
- Scope:
-	Public.
-
- Description:
-	Gets the population of deceased cells.
-
- Returns:
-	This method returns the population of deceased cells.
-***************************************************************************************************/
-
-	int getDeceased() const;
-
 /***************************************************************************************************
  Method:
 	void setHealth(const bool newHealth)
@@ -183,10 +122,12 @@ public:
 	Public.
 
  Description:
-	Revives or kills the cell. Sets the health member of the cell to the specified value. If the
-    health of the cell is alive (TRUE) and the new health specified is dead (FALSE), the deceased
-    are incremented. Conversely, if the health of the cell is dead (FALSE) and the new health
-    specified is alive (TRUE), the living are incremented.
+	Revives or kills the cell. Sets the health member of the cell to the specified value.
+
+ Remarks:
+	Cells no longer keep a count of the living and the deceased: counters shared by every cell were
+	shared by every world as well. World::getPopulation(), World::getBorn() and World::getDied()
+	count the cells of each world instead.
 
  Parameters:
 	1.	bool newHealth - The new health of the cell (TRUE for alive, FALSE for dead).
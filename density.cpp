@@ -0,0 +1,201 @@
+/***************************************************************************************************
+ File Name:
+	density.cpp
+
+ Purpose:
+	Implementation file for density pyramids. Counts the living cells of the blocks of a board and
+	sums them up the levels, from scratch or only where the board changed.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "density.h"
+
+namespace
+{
+
+/* Counts the living cells of each byte of a word, leaving the count in the byte. */
+inline uint64_t countBytes(uint64_t word)
+{
+	word = word - ((word >> 1) & 0x5555555555555555ull);
+	word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+	return (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0full;
+}
+
+}
+
+DensityPyramid::DensityPyramid()
+{
+	rows = 0;
+	cols = 0;
+}
+
+void DensityPyramid::resize(const int numRows, const int numCols)
+{
+	rows = (numRows > 0) ? numRows : 0;
+	cols = (numCols > 0) ? numCols : 0;
+	levelRows.clear();
+	levelCols.clear();
+	counts.clear();
+	if((rows == 0) || (cols == 0))
+		return;
+
+	int down = (rows + (1 << BASE_SHIFT) - 1) >> BASE_SHIFT;
+	int across = (cols + (1 << BASE_SHIFT) - 1) >> BASE_SHIFT;
+	for(;;)
+	{
+		levelRows.push_back(down);
+		levelCols.push_back(across);
+		counts.push_back(std::vector<uint32_t>((size_t)down * across, 0));
+		if((down == 1) && (across == 1))
+			break;
+		down = (down + 1) / 2;
+		across = (across + 1) / 2;
+	}
+}
+
+void DensityPyramid::countBase(const uint64_t* board, const BoardLayout& layout,
+							   const int rowBegin, const int rowEnd, const int colBegin,
+							   const int colEnd)
+{
+	// Eight blocks share a word, and their bytes of eight rows sum to at most 64 each
+	const int blockRows = 1 << BASE_SHIFT;
+	const int perWord = 64 >> BASE_SHIFT;
+	const int across = levelCols[0];
+	std::vector<uint32_t>& base = counts[0];
+	for(int blockRow = rowBegin; blockRow < rowEnd; blockRow++)
+	{
+		const int first = blockRow * blockRows;
+		const int last = (first + blockRows < rows) ? first + blockRows : rows;
+		for(int w = colBegin / perWord; w <= (colEnd - 1) / perWord; w++)
+		{
+			uint64_t sum = 0;
+			for(int row = first; row < last; row++)
+				sum += countBytes(board[(int64_t)row * layout.stride + w]);
+			const int begin = (w * perWord > colBegin) ? w * perWord : colBegin;
+			const int end = (w * perWord + perWord < colEnd) ? w * perWord + perWord : colEnd;
+			for(int blockCol = begin; blockCol < end; blockCol++)
+				base[(size_t)blockRow * across + blockCol] =
+					(uint32_t)(sum >> ((blockCol - w * perWord) * 8)) & 0xff;
+		}
+	}
+}
+
+void DensityPyramid::sumLevel(const int level, const int rowBegin, const int rowEnd,
+							  const int colBegin, const int colEnd)
+{
+	const std::vector<uint32_t>& below = counts[level - 1];
+	std::vector<uint32_t>& above = counts[level];
+	const int belowRows = levelRows[level - 1];
+	const int belowCols = levelCols[level - 1];
+	const int across = levelCols[level];
+	for(int row = rowBegin; row < rowEnd; row++)
+	{
+		const uint32_t* top = &below[(size_t)2 * row * belowCols];
+		const uint32_t* bottom = (2 * row + 1 < belowRows) ? top + belowCols : 0;
+		for(int col = colBegin; col < colEnd; col++)
+		{
+			const int left = 2 * col;
+			const bool right = left + 1 < belowCols;
+			uint32_t sum = top[left] + (right ? top[left + 1] : 0);
+			if(bottom != 0)
+				sum += bottom[left] + (right ? bottom[left + 1] : 0);
+			above[(size_t)row * across + col] = sum;
+		}
+	}
+}
+
+int DensityPyramid::getRows() const
+{
+	return rows;
+}
+
+int DensityPyramid::getCols() const
+{
+	return cols;
+}
+
+int DensityPyramid::getLevels() const
+{
+	return (int)counts.size();
+}
+
+int DensityPyramid::getBlockShift(const int level) const
+{
+	return BASE_SHIFT + level;
+}
+
+int DensityPyramid::getLevelRows(const int level) const
+{
+	return ((level >= 0) && (level < getLevels())) ? levelRows[level] : 0;
+}
+
+int DensityPyramid::getLevelCols(const int level) const
+{
+	return ((level >= 0) && (level < getLevels())) ? levelCols[level] : 0;
+}
+
+const uint32_t* DensityPyramid::getLevel(const int level) const
+{
+	return ((level >= 0) && (level < getLevels())) ? &counts[level][0] : 0;
+}
+
+void DensityPyramid::build(const uint64_t* board, const BoardLayout& layout)
+{
+	if((layout.rows != rows) || (layout.cols != cols) || counts.empty())
+		resize(layout.rows, layout.cols);
+	if(counts.empty())
+		return;
+	countBase(board, layout, 0, levelRows[0], 0, levelCols[0]);
+	for(int level = 1; level < getLevels(); level++)
+		sumLevel(level, 0, levelRows[level], 0, levelCols[level]);
+}
+
+void DensityPyramid::update(const uint64_t* board, const BoardLayout& layout,
+							const std::vector<unsigned char>& tiles, const int tileRows,
+							const int tileCols)
+{
+	const int down = (tileRows > 0) ? (layout.rows + tileRows - 1) / tileRows : 0;
+	const int across = (tileCols > 0) ? (layout.cols + tileCols - 1) / tileCols : 0;
+	if((layout.rows != rows) || (layout.cols != cols) || counts.empty() ||
+	   (tiles.size() != (size_t)down * across))
+	{
+		build(board, layout);
+		return;
+	}
+
+	for(int i = 0; i < down; i++)
+	{
+		for(int j = 0; j < across; j++)
+		{
+			if(tiles[(size_t)i * across + j] == 0)
+				continue;
+
+			// A run of changed tiles in a row of tiles is counted as one, and the blocks above it
+			// are summed once for the run
+			int last = j;
+			while((last + 1 < across) && (tiles[(size_t)i * across + last + 1] != 0))
+				last++;
+			const int size = 1 << BASE_SHIFT;
+			int rowBegin = i * tileRows / size;
+			int rowEnd = ((int64_t)(i + 1) * tileRows + size - 1) / size;
+			int colBegin = j * tileCols / size;
+			int colEnd = ((int64_t)(last + 1) * tileCols + size - 1) / size;
+			if(rowEnd > levelRows[0])
+				rowEnd = levelRows[0];
+			if(colEnd > levelCols[0])
+				colEnd = levelCols[0];
+			countBase(board, layout, rowBegin, rowEnd, colBegin, colEnd);
+			for(int level = 1; level < getLevels(); level++)
+			{
+				rowBegin /= 2;
+				rowEnd = (rowEnd + 1) / 2;
+				colBegin /= 2;
+				colEnd = (colEnd + 1) / 2;
+				sumLevel(level, rowBegin, rowEnd, colBegin, colEnd);
+			}
+			j = last;
+		}
+	}
+}
@@ -0,0 +1,296 @@
+/***************************************************************************************************
+ File Name:
+	density.h
+
+ Purpose:
+	Specification file for density pyramids. Defines a class called DensityPyramid that holds the
+	number of living cells in every block of a board at a ladder of block sizes, so that a view of
+	a board far bigger than the screen can shade each pixel from one count rather than sampling the
+	cells under it.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef DENSITY_H
+#define DENSITY_H
+
+#include "kernel.h"
+#include <stdint.h>
+#include <vector>
+
+/***************************************************************************************************
+ Class:
+	DensityPyramid
+
+ Description:
+	The live counts of the blocks of a board. Level 0 splits the board into blocks of 8x8 cells,
+	and each level after it into blocks twice as wide and high, each the sum of the four blocks
+	below it, up to a level of a single block. Blocks on the bottom and right edges of the board
+	cover fewer cells.
+
+ Remarks:
+	After the board is played the pyramid is brought up to date from the tiles that changed (see
+	World::takeDirtyTiles()): the blocks of level 0 inside them are counted again, and only the
+	blocks above those are summed again, so a board that has mostly settled costs little to keep.
+***************************************************************************************************/
+
+class DensityPyramid
+{
+
+private:
+
+	/* The log2 of the width and height of a block of level 0. */
+	static const int BASE_SHIFT = 3;
+
+	/* The size of the board. */
+	int rows;
+	int cols;
+
+	/* The number of blocks down and across each level, and their counts, row by row. */
+	std::vector<int> levelRows;
+	std::vector<int> levelCols;
+	std::vector<std::vector<uint32_t> > counts;
+
+/***************************************************************************************************
+ Method:
+	void resize(int numRows, int numCols)
+
+ Scope:
+	Private.
+
+ Description:
+	Lays out the levels for a board of the given size, with every count 0.
+
+ Parameters:
+	1.	int numRows - The number of rows of the board.
+	2.	int numCols - The number of columns of the board.
+***************************************************************************************************/
+
+	void resize(int numRows, int numCols);
+
+/***************************************************************************************************
+ Method:
+	void countBase(const uint64_t* board, const BoardLayout& layout, int rowBegin, int rowEnd,
+				   int colBegin, int colEnd)
+
+ Scope:
+	Private.
+
+ Description:
+	Counts the living cells of a range of blocks of level 0. The cells of a word are counted a byte
+	at a time, eight blocks at once, with the bytes of eight rows summed in one word.
+
+ Parameters:
+	1.	const uint64_t* board - Row 0 of the board.
+	2.	const BoardLayout& layout - The layout of the board.
+	3.	int rowBegin and rowEnd - The rows of blocks to count, the end excluded.
+	4.	int colBegin and colEnd - The columns of blocks to count, the end excluded.
+***************************************************************************************************/
+
+	void countBase(const uint64_t* board, const BoardLayout& layout, int rowBegin, int rowEnd,
+				   int colBegin, int colEnd);
+
+/***************************************************************************************************
+ Method:
+	void sumLevel(int level, int rowBegin, int rowEnd, int colBegin, int colEnd)
+
+ Scope:
+	Private.
+
+ Description:
+	Sums a range of blocks of a level from the blocks of the level below.
+
+ Parameters:
+	1.	int level - The level, at least 1.
+	2.	int rowBegin and rowEnd - The rows of blocks to sum, the end excluded.
+	3.	int colBegin and colEnd - The columns of blocks to sum, the end excluded.
+***************************************************************************************************/
+
+	void sumLevel(int level, int rowBegin, int rowEnd, int colBegin, int colEnd);
+
+public:
+
+/***************************************************************************************************
+ Method:
+	DensityPyramid()
+
+ Scope:
+	Public.
+
+ Description:
+	The default constructor. Creates the pyramid of an empty board of no cells.
+***************************************************************************************************/
+
+	DensityPyramid();
+
+/***************************************************************************************************
+ Method:
+	int getRows() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of rows of the board counted.
+
+ Returns:
+	This method returns the number of rows of the board.
+***************************************************************************************************/
+
+	int getRows() const;
+
+/***************************************************************************************************
+ Method:
+	int getCols() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of columns of the board counted.
+
+ Returns:
+	This method returns the number of columns of the board.
+***************************************************************************************************/
+
+	int getCols() const;
+
+/***************************************************************************************************
+ Method:
+	int getLevels() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of levels, the last of which is a single block.
+
+ Returns:
+	This method returns the number of levels, or 0 for a board of no cells.
+***************************************************************************************************/
+
+	int getLevels() const;
+
+/***************************************************************************************************
+ Method:
+	int getBlockShift(int level) const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the size of the blocks of a level: the cell at (row, col) is counted in block
+	(row >> shift, col >> shift).
+
+ Parameters:
+	1.	int level - The level.
+
+ Returns:
+	This method returns the log2 of the width and height of the blocks of the level.
+***************************************************************************************************/
+
+	int getBlockShift(int level) const;
+
+/***************************************************************************************************
+ Method:
+	int getLevelRows(int level) const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of rows of blocks of a level.
+
+ Parameters:
+	1.	int level - The level.
+
+ Returns:
+	This method returns the number of rows of blocks, or 0 if there is no such level.
+***************************************************************************************************/
+
+	int getLevelRows(int level) const;
+
+/***************************************************************************************************
+ Method:
+	int getLevelCols(int level) const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of columns of blocks of a level.
+
+ Parameters:
+	1.	int level - The level.
+
+ Returns:
+	This method returns the number of columns of blocks, or 0 if there is no such level.
+***************************************************************************************************/
+
+	int getLevelCols(int level) const;
+
+/***************************************************************************************************
+ Method:
+	const uint32_t* getLevel(int level) const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the counts of a level, getLevelCols() of them a row, row after row.
+
+ Parameters:
+	1.	int level - The level.
+
+ Returns:
+	This method returns the counts of the level, or 0 if there is no such level.
+***************************************************************************************************/
+
+	const uint32_t* getLevel(int level) const;
+
+/***************************************************************************************************
+ Method:
+	void build(const uint64_t* board, const BoardLayout& layout)
+
+ Scope:
+	Public.
+
+ Description:
+	Counts every block of a board from scratch.
+
+ Parameters:
+	1.	const uint64_t* board - Row 0 of the board, laid out as layout describes, with the cells
+		past the last column dead.
+	2.	const BoardLayout& layout - The layout of the board.
+***************************************************************************************************/
+
+	void build(const uint64_t* board, const BoardLayout& layout);
+
+/***************************************************************************************************
+ Method:
+	void update(const uint64_t* board, const BoardLayout& layout,
+				const std::vector<unsigned char>& tiles, int tileRows, int tileCols)
+
+ Scope:
+	Public.
+
+ Description:
+	Brings the counts up to date with a board of which only some tiles changed since the pyramid
+	was last built or updated. Builds it from scratch instead if the board is not the size it was,
+	or if the flags do not match the tiles of the board.
+
+ Parameters:
+	1.	const uint64_t* board - Row 0 of the board, as for build().
+	2.	const BoardLayout& layout - The layout of the board.
+	3.	const std::vector<unsigned char>& tiles - A flag for every tile, nonzero if the tile may
+		have changed, as World::takeDirtyTiles() gives them.
+	4.	int tileRows - The number of rows of a tile.
+	5.	int tileCols - The number of columns of a tile, a multiple of 64.
+***************************************************************************************************/
+
+	void update(const uint64_t* board, const BoardLayout& layout,
+				const std::vector<unsigned char>& tiles, int tileRows, int tileCols);
+};
+
+#endif
@@ -0,0 +1,110 @@
+/***************************************************************************************************
+ File Name:
+	edges.cpp
+
+ Purpose:
+	Implementation file for the edge policies of the game engine. Writes and clears the halo of a
+	bounded board for the toroidal and Klein bottle worlds.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "edges.h"
+#include <string.h>
+
+const bool DeadEdges::WRAPS;
+const bool DeadEdges::MIRRORS;
+const bool TorusEdges::WRAPS;
+const bool TorusEdges::MIRRORS;
+const bool KleinEdges::WRAPS;
+const bool KleinEdges::MIRRORS;
+
+namespace
+{
+
+inline uint64_t* rowOf(const BoardLayout& layout, uint64_t* board, const int row)
+{
+	return board + (int64_t)row * layout.stride;
+}
+
+/* Reverses the order of the bits of a word. */
+inline uint64_t reverseBits(uint64_t word)
+{
+	word = ((word >> 1) & 0x5555555555555555ull) | ((word & 0x5555555555555555ull) << 1);
+	word = ((word >> 2) & 0x3333333333333333ull) | ((word & 0x3333333333333333ull) << 2);
+	word = ((word >> 4) & 0x0f0f0f0f0f0f0f0full) | ((word & 0x0f0f0f0f0f0f0f0full) << 4);
+	return __builtin_bswap64(word);
+}
+
+/* Copies a row of cells flipped left to right. */
+void mirrorRow(const BoardLayout& layout, const uint64_t* src, uint64_t* dst)
+{
+	// Reversing the words puts cell c at bit 64 * words - 1 - c, which is pad too far left
+	const int pad = 64 * layout.words - layout.cols;
+	for(int w = 0; w < layout.words; w++)
+	{
+		const uint64_t low = reverseBits(src[layout.words - 1 - w]);
+		const uint64_t high = (w + 1 < layout.words) ? reverseBits(src[layout.words - 2 - w]) : 0;
+		dst[w] = (pad == 0) ? low : (low >> pad) | (high << (64 - pad));
+	}
+}
+
+/* Writes the ghost cells on either side of rows -1 to rows, once the halo rows are written. */
+void fillGhosts(const BoardLayout& layout, uint64_t* board)
+{
+	const int last = layout.cols - 1;
+	const int ghost = layout.cols & 63;
+	for(int row = -1; row <= layout.rows; row++)
+	{
+		uint64_t* cells = rowOf(layout, board, row);
+		cells[-1] = ((cells[last >> 6] >> (last & 63)) & 1) << 63;
+		if(ghost == 0)
+			cells[layout.words] = cells[0] & 1;
+		else
+			cells[layout.words - 1] = (cells[layout.words - 1] & layout.lastMask) |
+									  ((cells[0] & 1) << ghost);
+	}
+}
+
+/* Kills the halo rows and the ghost cells. */
+void clearGhosts(const BoardLayout& layout, uint64_t* board)
+{
+	const size_t bytes = (layout.words + 2) * sizeof(uint64_t);
+	memset(rowOf(layout, board, -1) - 1, 0, bytes);
+	memset(rowOf(layout, board, layout.rows) - 1, 0, bytes);
+	for(int row = 0; row < layout.rows; row++)
+	{
+		uint64_t* cells = rowOf(layout, board, row);
+		cells[-1] = 0;
+		cells[layout.words] = 0;
+		cells[layout.words - 1] &= layout.lastMask;
+	}
+}
+
+}
+
+void TorusEdges::fillHalo(const BoardLayout& layout, uint64_t* board)
+{
+	const size_t bytes = layout.words * sizeof(uint64_t);
+	memcpy(rowOf(layout, board, -1), rowOf(layout, board, layout.rows - 1), bytes);
+	memcpy(rowOf(layout, board, layout.rows), rowOf(layout, board, 0), bytes);
+	fillGhosts(layout, board);
+}
+
+void TorusEdges::clearHalo(const BoardLayout& layout, uint64_t* board)
+{
+	clearGhosts(layout, board);
+}
+
+void KleinEdges::fillHalo(const BoardLayout& layout, uint64_t* board)
+{
+	mirrorRow(layout, rowOf(layout, board, layout.rows - 1), rowOf(layout, board, -1));
+	mirrorRow(layout, rowOf(layout, board, 0), rowOf(layout, board, layout.rows));
+	fillGhosts(layout, board);
+}
+
+void KleinEdges::clearHalo(const BoardLayout& layout, uint64_t* board)
+{
+	clearGhosts(layout, board);
+}
@@ -0,0 +1,121 @@
+/***************************************************************************************************
+ File Name:
+	edges.h
+
+ Purpose:
+	Specification file for the edge policies of the game engine. An edge policy decides what lies
+	past the edges of a bounded board. The world is templated on the policy, so the choice costs
+	nothing per cell: the kernels always read the halo around the board, and only the halo is
+	rewritten for each generation.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef EDGES_H
+#define EDGES_H
+
+#include <stdint.h>
+#include "kernel.h"
+
+/***************************************************************************************************
+ Struct:
+	DeadEdges, TorusEdges and KleinEdges
+
+ Description:
+	The edge policies. Each of them provides:
+		1.	WRAPS - TRUE if the edges are glued to each other rather than dead.
+		2.	MIRRORS - TRUE if the top and bottom edges are glued with a left to right flip.
+		3.	bool wrap(int& row, int& col, int rows, int cols) - Moves a location that lies at most
+			one cell off of the board to the cell of the board it stands for. Returns FALSE if there
+			is no such cell (the location is dead).
+		4.	void fillHalo(const BoardLayout& layout, uint64_t* board) - Writes the halo rows and the
+			ghost cells on either side of every row, which the kernels read as the neighbors of the
+			cells on the edges.
+		5.	void clearHalo(const BoardLayout& layout, uint64_t* board) - Kills the halo again, so it
+			never outlives the generation it was written for.
+
+	DeadEdges is the bounded world: every cell off of the board is dead and the halo is never
+	written. TorusEdges glues the left edge to the right edge and the top edge to the bottom edge.
+	KleinEdges glues the left edge to the right edge, and the top edge to the bottom edge flipped
+	left to right, which makes a Klein bottle.
+
+ Remarks:
+	The ghost cell left of a row is bit 63 of word -1 of the row (which is the last padding word
+	of the previous row) and the ghost cell right of a row is column cols, in the last word of the
+	row or in the first padding word. Both are dead except while a generation is computed.
+***************************************************************************************************/
+
+struct DeadEdges
+{
+	static const bool WRAPS = false;
+	static const bool MIRRORS = false;
+
+	static bool wrap(int& row, int& col, int rows, int cols);
+	static void fillHalo(const BoardLayout& layout, uint64_t* board);
+	static void clearHalo(const BoardLayout& layout, uint64_t* board);
+};
+
+struct TorusEdges
+{
+	static const bool WRAPS = true;
+	static const bool MIRRORS = false;
+
+	static bool wrap(int& row, int& col, int rows, int cols);
+	static void fillHalo(const BoardLayout& layout, uint64_t* board);
+	static void clearHalo(const BoardLayout& layout, uint64_t* board);
+};
+
+struct KleinEdges
+{
+	static const bool WRAPS = true;
+	static const bool MIRRORS = true;
+
+	static bool wrap(int& row, int& col, int rows, int cols);
+	static void fillHalo(const BoardLayout& layout, uint64_t* board);
+	static void clearHalo(const BoardLayout& layout, uint64_t* board);
+};
+
+// The location lookups are called for every neighbor by the SCALAR engine, so they are inline
+
+inline bool DeadEdges::wrap(int& row, int& col, const int rows, const int cols)
+{
+	return (row >= 0) && (row < rows) && (col >= 0) && (col < cols);
+}
+
+inline void DeadEdges::fillHalo(const BoardLayout&, uint64_t*)
+{
+}
+
+inline void DeadEdges::clearHalo(const BoardLayout&, uint64_t*)
+{
+}
+
+inline bool TorusEdges::wrap(int& row, int& col, const int rows, const int cols)
+{
+	if(col < 0)
+		col += cols;
+	else if(col >= cols)
+		col -= cols;
+	if(row < 0)
+		row += rows;
+	else if(row >= rows)
+		row -= rows;
+	return true;
+}
+
+inline bool KleinEdges::wrap(int& row, int& col, const int rows, const int cols)
+{
+	if(col < 0)
+		col += cols;
+	else if(col >= cols)
+		col -= cols;
+	if((row < 0) || (row >= rows))
+	{
+		row = (row < 0) ? row + rows : row - rows;
+		col = cols - 1 - col;
+	}
+	return true;
+}
+
+#endif
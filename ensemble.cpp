@@ -0,0 +1,371 @@
+/***************************************************************************************************
+ File Name:
+	ensemble.cpp
+
+ Purpose:
+	Implementation file for ensembles of small boards. Packs the boards into strips stepped by the
+	kernels and plays each strip on the thread pool until its boards have settled.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "ensemble.h"
+#include "threadpool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+Ensemble::Ensemble(const int numBoards, const int numRows, const int numCols)
+{
+	count = (numBoards > 0) ? numBoards : 1;
+	rows = (numRows > 0) ? numRows : 1;
+	cols = (numCols > 0) ? numCols : 1;
+	words = (cols + 63) / 64;
+	lastMask = (cols % 64 == 0) ? ~(uint64_t)0 : ((uint64_t)1 << (cols % 64)) - 1;
+
+	// Each board takes its words and a dead word; the last board's dead word is the row padding
+	const int slotWords = words + 1;
+	perStrip = (STRIP_WORDS + 1) / slotWords;
+	if(perStrip < 1)
+		perStrip = 1;
+	if(perStrip > count)
+		perStrip = count;
+	numStrips = (count + perStrip - 1) / perStrip;
+	layout.rows = rows;
+	layout.words = perStrip * slotWords - 1;
+	layout.cols = layout.words * 64;
+	layout.stride = (layout.words + 2 + LINE_WORDS - 1) / LINE_WORDS * LINE_WORDS;
+	layout.lastMask = ~(uint64_t)0;
+
+	// Leading padding and top halo, the rows, the bottom halo, then a line for the vector kernels
+	bufferWords = (size_t)LINE_WORDS + layout.stride + ((size_t)rows + 1) * layout.stride +
+				  LINE_WORDS;
+	const size_t bytes = (size_t)numStrips * 2 * bufferWords * sizeof(uint64_t);
+	void* memory = 0;
+	if(posix_memalign(&memory, LINE_WORDS * sizeof(uint64_t), bytes) != 0)
+		throw std::bad_alloc();
+	memset(memory, 0, bytes);
+	block = (uint64_t*)memory;
+	parity.assign(numStrips, 0);
+
+	boards.resize(count);
+	periodWindow = 32;
+	savedCells.assign((size_t)count * rows * words, 0);
+	for(int b = 0; b < count; b++)
+		resetBoard(b, 0);
+
+	parseRule("B3/S23", kernelRule);
+	compileRule(kernelRule, ruleTable);
+	kernel = detectKernel();
+	pool = 0;
+}
+
+Ensemble::~Ensemble()
+{
+	delete pool;
+	free(block);
+}
+
+uint64_t* Ensemble::cellsOf(const int board) const
+{
+	const int strip = board / perStrip;
+	const size_t buffer = (size_t)strip * 2 + parity[strip];
+	return block + buffer * bufferWords + LINE_WORDS + layout.stride +
+		   (size_t)(board % perStrip) * (words + 1);
+}
+
+void Ensemble::cleanStrip(const int strip)
+{
+	const int first = strip * perStrip;
+	const int numBoards = (first + perStrip < count) ? perStrip : count - first;
+	uint64_t* const cells = cellsOf(first);
+	for(int row = 0; row < rows; row++)
+	{
+		uint64_t* line = cells + (int64_t)row * layout.stride;
+		for(int b = 0; b < numBoards; b++)
+		{
+			uint64_t* board = line + (size_t)b * (words + 1);
+			board[words - 1] &= lastMask;
+			board[words] = 0;
+		}
+	}
+}
+
+bool Ensemble::notePeriod(const int board)
+{
+	Board& state = boards[board];
+	if(periodWindow == 0)
+		return false;
+
+	// The first repeat of the saved generation gives the period. Boards that are still changing
+	// almost always differ in the first few words, so the comparison is cheaper than a hash.
+	const size_t boardWords = (size_t)rows * words;
+	uint64_t* saved = &savedCells[(size_t)board * boardWords];
+	const uint64_t* cells = cellsOf(board);
+	if(state.savedTurn >= 0)
+	{
+		int row = 0;
+		for(; row < rows; row++)
+		{
+			const uint64_t* line = cells + (int64_t)row * layout.stride;
+			const uint64_t* copy = saved + (size_t)row * words;
+			int w = 0;
+			while((w < words) && (line[w] == copy[w]))
+				w++;
+			if(w < words)
+				break;
+		}
+		if(row == rows)
+		{
+			state.period = state.turn - state.savedTurn;
+			state.periodStart = state.savedTurn;
+			return true;
+		}
+	}
+
+	// Save a new generation once the old one has been compared with a whole window of turns
+	if((state.savedTurn < 0) || (state.turn - state.savedTurn >= periodWindow))
+	{
+		for(int row = 0; row < rows; row++)
+			memcpy(saved + (size_t)row * words, cells + (int64_t)row * layout.stride,
+				   words * sizeof(uint64_t));
+		state.savedTurn = state.turn;
+	}
+	return false;
+}
+
+bool Ensemble::advance(const int board, const int64_t maxTurns,
+					   const std::function<bool(int)>& finished)
+{
+	for(;;)
+	{
+		Board& state = boards[board];
+		if(!notePeriod(board) && (state.turn < maxTurns))
+			return true;
+		state.finished = true;
+
+		// A new run started by the callback is checked like any other
+		if(!finished || !finished(board) || boards[board].finished)
+			return false;
+	}
+}
+
+void Ensemble::resetBoard(const int board, const int64_t numTurn)
+{
+	Board& state = boards[board];
+	state.turn = numTurn;
+	state.period = 0;
+	state.periodStart = 0;
+	state.finished = false;
+	state.savedTurn = -1;
+}
+
+int Ensemble::getBoards() const
+{
+	return count;
+}
+
+int Ensemble::getRows() const
+{
+	return rows;
+}
+
+int Ensemble::getCols() const
+{
+	return cols;
+}
+
+std::string Ensemble::getRule() const
+{
+	return formatRule(kernelRule);
+}
+
+bool Ensemble::setRule(const std::string& rulestring)
+{
+	KernelRule newRule;
+	if(!parseRule(rulestring.c_str(), newRule))
+		return false;
+	kernelRule = newRule;
+	compileRule(kernelRule, ruleTable);
+	for(int b = 0; b < count; b++)
+		resetBoard(b, boards[b].turn);
+	return true;
+}
+
+KernelType Ensemble::getKernel() const
+{
+	return kernel;
+}
+
+void Ensemble::setKernel(const KernelType newKernel)
+{
+	kernel = (newKernel <= detectKernel()) ? newKernel : detectKernel();
+}
+
+int Ensemble::getThreads() const
+{
+	return (pool != 0) ? pool->getThreads() : 1;
+}
+
+void Ensemble::setThreads(const int numThreads)
+{
+	delete pool;
+	pool = 0;
+	if(numThreads != 1)
+	{
+		pool = new ThreadPool(numThreads);
+		if(pool->getThreads() == 1)
+		{
+			delete pool;
+			pool = 0;
+		}
+	}
+}
+
+int Ensemble::getPeriodWindow() const
+{
+	return periodWindow;
+}
+
+void Ensemble::setPeriodWindow(const int numTurns)
+{
+	periodWindow = (numTurns > 0) ? numTurns : 0;
+	for(int b = 0; b < count; b++)
+		resetBoard(b, boards[b].turn);
+}
+
+void Ensemble::clearBoard(const int board)
+{
+	if((board < 0) || (board >= count))
+		return;
+	uint64_t* cells = cellsOf(board);
+	for(int row = 0; row < rows; row++)
+		memset(cells + (int64_t)row * layout.stride, 0, words * sizeof(uint64_t));
+	resetBoard(board, 0);
+}
+
+void Ensemble::setCells(const int board, const uint64_t* cells)
+{
+	if((board < 0) || (board >= count))
+		return;
+	uint64_t* target = cellsOf(board);
+	for(int row = 0; row < rows; row++)
+	{
+		uint64_t* line = target + (int64_t)row * layout.stride;
+		memcpy(line, cells + (int64_t)row * words, words * sizeof(uint64_t));
+		line[words - 1] &= lastMask;
+	}
+	resetBoard(board, 0);
+}
+
+void Ensemble::getCells(const int board, uint64_t* cells) const
+{
+	if((board < 0) || (board >= count))
+		return;
+	const uint64_t* source = cellsOf(board);
+	for(int row = 0; row < rows; row++)
+		memcpy(cells + (int64_t)row * words, source + (int64_t)row * layout.stride,
+			   words * sizeof(uint64_t));
+}
+
+bool Ensemble::getHealth(const int board, const int row, const int col) const
+{
+	if((board < 0) || (board >= count) || (row < 0) || (row >= rows) || (col < 0) ||
+	   (col >= cols))
+		return false;
+	return (cellsOf(board)[(int64_t)row * layout.stride + (col >> 6)] >> (col & 63)) & 1;
+}
+
+void Ensemble::setHealth(const int board, const int row, const int col, const bool newHealth)
+{
+	if((board < 0) || (board >= count) || (row < 0) || (row >= rows) || (col < 0) ||
+	   (col >= cols))
+		return;
+	uint64_t& word = cellsOf(board)[(int64_t)row * layout.stride + (col >> 6)];
+	const uint64_t bit = (uint64_t)1 << (col & 63);
+	word = newHealth ? (word | bit) : (word & ~bit);
+	resetBoard(board, boards[board].turn);
+}
+
+int64_t Ensemble::getPopulation(const int board) const
+{
+	if((board < 0) || (board >= count))
+		return 0;
+	const uint64_t* cells = cellsOf(board);
+	int64_t population = 0;
+	for(int row = 0; row < rows; row++)
+		for(int w = 0; w < words; w++)
+			population += __builtin_popcountll(cells[(int64_t)row * layout.stride + w]);
+	return population;
+}
+
+int64_t Ensemble::getTurn(const int board) const
+{
+	return ((board >= 0) && (board < count)) ? boards[board].turn : 0;
+}
+
+bool Ensemble::isFinished(const int board) const
+{
+	return ((board >= 0) && (board < count)) ? boards[board].finished : false;
+}
+
+int64_t Ensemble::getPeriod(const int board) const
+{
+	return ((board >= 0) && (board < count)) ? boards[board].period : 0;
+}
+
+int64_t Ensemble::getPeriodStart(const int board) const
+{
+	return ((board >= 0) && (board < count)) ? boards[board].periodStart : 0;
+}
+
+int64_t Ensemble::play(const int64_t maxTurns, const std::function<bool(int)>& finished)
+{
+	std::vector<int64_t> computed(numStrips, 0);
+	const std::function<void(int)> job = [&](const int strip)
+	{
+		const int first = strip * perStrip;
+		const int last = (first + perStrip < count) ? first + perStrip : count;
+		int running = 0;
+		for(int b = first; b < last; b++)
+		{
+			// A board stopped by an earlier turn limit goes on, its saved generation stale by now
+			if(boards[b].finished && (boards[b].period == 0) && (boards[b].turn < maxTurns))
+				resetBoard(b, boards[b].turn);
+			if(!boards[b].finished && advance(b, maxTurns, finished))
+				running++;
+		}
+
+		uint64_t* const base = block + (size_t)strip * 2 * bufferWords + LINE_WORDS +
+							   layout.stride;
+		while(running > 0)
+		{
+			const uint64_t* src = base + parity[strip] * bufferWords;
+			uint64_t* dst = base + (parity[strip] ^ 1) * bufferWords;
+			TileCounts counts;
+			stepKernel(kernel, layout, src, dst, 0, rows, 0, layout.words, ruleTable, counts);
+			parity[strip] ^= 1;
+			computed[strip] += running;
+			cleanStrip(strip);
+
+			running = 0;
+			for(int b = first; b < last; b++)
+			{
+				boards[b].turn++;
+				if(!boards[b].finished && advance(b, maxTurns, finished))
+					running++;
+			}
+		}
+	};
+	if(pool != 0)
+		pool->run(numStrips, job);
+	else
+		for(int strip = 0; strip < numStrips; strip++)
+			job(strip);
+
+	int64_t total = 0;
+	for(int strip = 0; strip < numStrips; strip++)
+		total += computed[strip];
+	return total;
+}
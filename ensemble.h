@@ -0,0 +1,675 @@
+/***************************************************************************************************
+ File Name:
+	ensemble.h
+
+ Purpose:
+	Specification file for ensembles of small boards. Defines a class called Ensemble that evolves
+	many boards of the same size side by side in one block of memory, for runs such as random soup
+	censuses where millions of small boards are each played until they settle.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "kernel.h"
+
+class ThreadPool;
+
+/***************************************************************************************************
+ Class:
+	Ensemble
+
+ Description:
+	A set of bounded boards of the same size, each with its own turn, that are played until each of
+	them settles into a still life or an oscillator or runs out of turns.
+
+ Remarks:
+	The boards are packed into strips: the rows of several boards lie next to each other in the
+	same board rows, each board followed by one dead word that is cleared after every generation so
+	that neighboring boards never see each other. A strip is stepped as one board by the kernels,
+	so the words of a vector belong to different boards, and the strips are stepped independently
+	by the threads of the ensemble, each until all of its boards have finished. All the strips,
+	both generations of each, lie in a single allocation.
+***************************************************************************************************/
+
+class Ensemble
+{
+
+private:
+
+	/* The number of words in a cache line. Rows and buffers are padded to whole lines. */
+	static const int LINE_WORDS = 8;
+
+	/* The number of words a strip row aims for. Wider strips keep the vectors fuller, narrower
+	ones stop stepping finished boards sooner. */
+	static const int STRIP_WORDS = 32;
+
+	/* The state of one board:
+		1.	turn - The number of generations the board has been stepped since it was set.
+		2.	period and periodStart - The cycle the board has settled into, or 0 if none is known.
+		3.	finished - Set once the board has settled or run out of turns.
+		4.	savedTurn - The turn of the generation saved to recognize a cycle, or -1 if none is. */
+	struct Board
+	{
+		int64_t turn;
+		int64_t period;
+		int64_t periodStart;
+		bool finished;
+		int64_t savedTurn;
+	};
+
+	/* The number of boards and their size. */
+	int count;
+	int rows;
+	int cols;
+
+	/* The number of words holding the cells of a row of one board. */
+	int words;
+
+	/* The number of boards in a strip and the number of strips. */
+	int perStrip;
+	int numStrips;
+
+	/* The layout of a strip, seen by the kernels as one board of perStrip * (words + 1) - 1
+	words. */
+	BoardLayout layout;
+
+	/* The bits of the last word of a row of a board that hold cells. */
+	uint64_t lastMask;
+
+	/* The number of words of one generation of a strip, halos and padding included. */
+	size_t bufferWords;
+
+	/* The generations of every strip: two buffers of bufferWords per strip, and which of the two
+	holds the current generation. */
+	uint64_t* block;
+	std::vector<unsigned char> parity;
+
+	/* The state of every board, and the saved generation of every board, packed rows of words
+	words one board after the other. */
+	std::vector<Board> boards;
+	std::vector<uint64_t> savedCells;
+	int periodWindow;
+
+	/* The rule of the game, as given and compiled for the kernels. */
+	KernelRule kernelRule;
+	RuleTable ruleTable;
+
+	/* The kernel stepping the strips. */
+	KernelType kernel;
+
+	/* The threads stepping the strips, or NULL if the calling thread steps them alone. */
+	ThreadPool* pool;
+
+	/* Ensembles own their block and threads and cannot be copied. */
+	Ensemble(const Ensemble&);
+	Ensemble& operator=(const Ensemble&);
+
+/***************************************************************************************************
+ Method:
+	uint64_t* cellsOf(int board) const
+
+ Scope:
+	Private.
+
+ Description:
+	Finds the current generation of a board.
+
+ Parameters:
+	1.	int board - The board.
+
+ Returns:
+	This method returns a pointer to word 0 of row 0 of the board. Its rows are layout.stride words
+	apart.
+***************************************************************************************************/
+
+	uint64_t* cellsOf(int board) const;
+
+/***************************************************************************************************
+ Method:
+	void cleanStrip(int strip)
+
+ Scope:
+	Private.
+
+ Description:
+	Kills the cells the kernel brought to life in the dead words between the boards of a strip and
+	past their last columns.
+
+ Parameters:
+	1.	int strip - The strip.
+***************************************************************************************************/
+
+	void cleanStrip(int strip);
+
+/***************************************************************************************************
+ Method:
+	bool notePeriod(int board)
+
+ Scope:
+	Private.
+
+ Description:
+	Compares the current generation of a board with its saved generation. If they are the same the
+	board has entered a cycle, whose period is the number of turns between them. A new generation
+	is saved once the saved one is periodWindow turns old, so every cycle of up to periodWindow
+	turns is found within two windows of the board entering it.
+
+ Parameters:
+	1.	int board - The board.
+
+ Returns:
+	This method returns TRUE if the board has entered a cycle.
+***************************************************************************************************/
+
+	bool notePeriod(int board);
+
+/***************************************************************************************************
+ Method:
+	bool advance(int board, int64_t maxTurns, const std::function<bool(int)>& finished)
+
+ Scope:
+	Private.
+
+ Description:
+	Decides whether a board that is not finished needs another generation. A board that has
+	settled or reached maxTurns is marked finished and handed to finished, which may start a new
+	run on it; the new run is then checked the same way.
+
+ Parameters:
+	1.	int board - The board.
+	2.	int64_t maxTurns - The turn at which boards stop.
+	3.	const std::function<bool(int)>& finished - See play(). May be empty.
+
+ Returns:
+	This method returns TRUE if the board needs another generation.
+***************************************************************************************************/
+
+	bool advance(int board, int64_t maxTurns, const std::function<bool(int)>& finished);
+
+/***************************************************************************************************
+ Method:
+	void resetBoard(int board, int64_t numTurn)
+
+ Scope:
+	Private.
+
+ Description:
+	Forgets the cycle and the saved generation of a board after its cells were changed.
+
+ Parameters:
+	1.	int board - The board.
+	2.	int64_t numTurn - The new turn of the board.
+***************************************************************************************************/
+
+	void resetBoard(int board, int64_t numTurn);
+
+public:
+
+/***************************************************************************************************
+ Method:
+	Ensemble(int numBoards, int numRows, int numCols)
+
+ Scope:
+	Public.
+
+ Description:
+	A constructor. Allocates the boards, all dead, with the rule B3/S23, a period window of 32
+	turns and one thread.
+
+ Parameters:
+	1.	int numBoards - The number of boards. At least one.
+	2.	int numRows - The number of rows of every board. At least one.
+	3.	int numCols - The number of columns of every board. At least one.
+
+ Remarks:
+	Throws std::bad_alloc if the boards do not fit in memory.
+***************************************************************************************************/
+
+	Ensemble(int numBoards, int numRows, int numCols);
+
+/***************************************************************************************************
+ Method:
+	~Ensemble()
+
+ Scope:
+	Public.
+
+ Description:
+	The destructor. Stops the threads and frees the boards.
+***************************************************************************************************/
+
+	~Ensemble();
+
+/***************************************************************************************************
+ Method:
+	int getBoards() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of boards of the ensemble.
+
+ Returns:
+	This method returns the number of boards.
+***************************************************************************************************/
+
+	int getBoards() const;
+
+/***************************************************************************************************
+ Method:
+	int getRows() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of rows of every board.
+
+ Returns:
+	This method returns the number of rows.
+***************************************************************************************************/
+
+	int getRows() const;
+
+/***************************************************************************************************
+ Method:
+	int getCols() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of columns of every board.
+
+ Returns:
+	This method returns the number of columns.
+***************************************************************************************************/
+
+	int getCols() const;
+
+/***************************************************************************************************
+ Method:
+	std::string getRule() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the rule of the game, the same for every board.
+
+ Returns:
+	This method returns the rulestring in B/S notation.
+***************************************************************************************************/
+
+	std::string getRule() const;
+
+/***************************************************************************************************
+ Method:
+	bool setRule(const std::string& rulestring)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the rule of the game for every board. The boards forget their cycles, since a cycle under
+	one rule says nothing about another.
+
+ Parameters:
+	1.	const std::string& rulestring - The rule, in B/S or S/B notation (see parseRule()).
+
+ Returns:
+	This method returns TRUE if the rule was set and FALSE if the rulestring is invalid, in which
+	case the rule is left unchanged.
+***************************************************************************************************/
+
+	bool setRule(const std::string& rulestring);
+
+/***************************************************************************************************
+ Method:
+	KernelType getKernel() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the kernel that steps the strips.
+
+ Returns:
+	This method returns the kernel.
+***************************************************************************************************/
+
+	KernelType getKernel() const;
+
+/***************************************************************************************************
+ Method:
+	void setKernel(KernelType newKernel)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the kernel that steps the strips. All kernels produce bit-identical results.
+
+ Parameters:
+	1.	KernelType newKernel - The kernel to use.
+
+ Remarks:
+	A kernel that the CPU does not support is replaced by the widest one it does support.
+***************************************************************************************************/
+
+	void setKernel(KernelType newKernel);
+
+/***************************************************************************************************
+ Method:
+	int getThreads() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of threads that step the strips, including the one calling play().
+
+ Returns:
+	This method returns the number of threads used by play().
+***************************************************************************************************/
+
+	int getThreads() const;
+
+/***************************************************************************************************
+ Method:
+	void setThreads(int numThreads)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the number of threads that step the strips. Each thread takes a strip and plays it until
+	all of its boards have finished before taking the next, so there is no barrier between
+	generations. The results do not depend on the number of threads.
+
+ Parameters:
+	1.	int numThreads - The number of threads, including the one calling play(). A value of 0 uses
+		one thread per hardware thread. The default is 1.
+***************************************************************************************************/
+
+	void setThreads(int numThreads);
+
+/***************************************************************************************************
+ Method:
+	int getPeriodWindow() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the longest cycle the boards are checked for.
+
+ Returns:
+	This method returns the period window in turns.
+***************************************************************************************************/
+
+	int getPeriodWindow() const;
+
+/***************************************************************************************************
+ Method:
+	void setPeriodWindow(int numTurns)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the longest cycle the boards are checked for. Each board saves one of its generations and
+	compares every following generation with it, saving a newer one every numTurns turns, so a
+	board finishes at most two windows after entering a cycle of up to numTurns turns. Unlike
+	World::setPeriodWindow() no hashes are kept: comparing with the saved generation stops at the
+	first difference, which is found right away on boards that are still changing. Every board
+	forgets its cycle.
+
+ Parameters:
+	1.	int numTurns - The period window. A value of 0 turns cycle detection off, so boards only
+		finish at maxTurns. The default is 32.
+***************************************************************************************************/
+
+	void setPeriodWindow(int numTurns);
+
+/***************************************************************************************************
+ Method:
+	void clearBoard(int board)
+
+ Scope:
+	Public.
+
+ Description:
+	Kills every cell of a board and starts a new run on it at turn 0.
+
+ Parameters:
+	1.	int board - The board.
+***************************************************************************************************/
+
+	void clearBoard(int board);
+
+/***************************************************************************************************
+ Method:
+	void setCells(int board, const uint64_t* cells)
+
+ Scope:
+	Public.
+
+ Description:
+	Replaces the cells of a board and starts a new run on it at turn 0.
+
+ Parameters:
+	1.	int board - The board.
+	2.	const uint64_t* cells - The cells, packed the way World::setCells() takes them: the rows one
+		after the other, (cols + 63) / 64 words each, bit (col % 64) of word col / 64 holding the
+		cell at col. Bits past the last column are ignored.
+***************************************************************************************************/
+
+	void setCells(int board, const uint64_t* cells);
+
+/***************************************************************************************************
+ Method:
+	void getCells(int board, uint64_t* cells) const
+
+ Scope:
+	Public.
+
+ Description:
+	Copies the current generation of a board.
+
+ Parameters:
+	1.	int board - The board.
+	2.	uint64_t* cells - Receives the cells, packed as setCells() takes them.
+***************************************************************************************************/
+
+	void getCells(int board, uint64_t* cells) const;
+
+/***************************************************************************************************
+ Method:
+	bool getHealth(int board, int row, int col) const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the health of a cell of a board.
+
+ Parameters:
+	1.	int board - The board.
+	2.	int row - The row of the cell.
+	3.	int col - The column of the cell.
+
+ Returns:
+	This method returns TRUE if the cell is alive. Cells off of the board are dead.
+***************************************************************************************************/
+
+	bool getHealth(int board, int row, int col) const;
+
+/***************************************************************************************************
+ Method:
+	void setHealth(int board, int row, int col, bool newHealth)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the health of a cell of a board. The board keeps its turn but forgets its cycle and is no
+	longer finished.
+
+ Parameters:
+	1.	int board - The board.
+	2.	int row - The row of the cell.
+	3.	int col - The column of the cell.
+	4.	bool newHealth - The new health of the cell.
+
+ Remarks:
+	Cells off of the board are ignored.
+***************************************************************************************************/
+
+	void setHealth(int board, int row, int col, bool newHealth);
+
+/***************************************************************************************************
+ Method:
+	int64_t getPopulation(int board) const
+
+ Scope:
+	Public.
+
+ Description:
+	Counts the living cells of the current generation of a board.
+
+ Parameters:
+	1.	int board - The board.
+
+ Returns:
+	This method returns the number of living cells.
+***************************************************************************************************/
+
+	int64_t getPopulation(int board) const;
+
+/***************************************************************************************************
+ Method:
+	int64_t getTurn(int board) const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the turn of a board: the number of generations it has been stepped since its cells were
+	set.
+
+ Parameters:
+	1.	int board - The board.
+
+ Returns:
+	This method returns the turn of the board.
+***************************************************************************************************/
+
+	int64_t getTurn(int board) const;
+
+/***************************************************************************************************
+ Method:
+	bool isFinished(int board) const
+
+ Scope:
+	Public.
+
+ Description:
+	Determines whether a board has finished: it has settled into a cycle or reached the turn limit
+	of play().
+
+ Parameters:
+	1.	int board - The board.
+
+ Returns:
+	This method returns TRUE if the board has finished.
+***************************************************************************************************/
+
+	bool isFinished(int board) const;
+
+/***************************************************************************************************
+ Method:
+	int64_t getPeriod(int board) const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the period of the cycle a board has settled into.
+
+ Parameters:
+	1.	int board - The board.
+
+ Returns:
+	This method returns 1 for a still life (an empty board included), the period of an
+	oscillator, or 0 if the board has not been seen to repeat.
+***************************************************************************************************/
+
+	int64_t getPeriod(int board) const;
+
+/***************************************************************************************************
+ Method:
+	int64_t getPeriodStart(int board) const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets a turn by which a board had settled into its cycle.
+
+ Parameters:
+	1.	int board - The board.
+
+ Returns:
+	This method returns the turn of the generation the board was found to repeat, at most one
+	period window after the board entered its cycle, or 0 if no cycle is known. World finds the
+	exact turn, at the price of hashing every generation.
+***************************************************************************************************/
+
+	int64_t getPeriodStart(int board) const;
+
+/***************************************************************************************************
+ Method:
+	int64_t play(int64_t maxTurns, const std::function<bool(int)>& finished)
+
+ Scope:
+	Public.
+
+ Description:
+	Steps every board that has not finished until it settles into a cycle or reaches turn
+	maxTurns. Boards that reached the turn limit of an earlier call without settling go on. Every
+	board that finishes is handed to finished, if given, as soon as it does: it may read the
+	results of the board and start a new run on it with setCells() or clearBoard() and return
+	TRUE, in which case the new run is played as well. This keeps the strips full when more runs
+	are queued than there are boards.
+
+ Parameters:
+	1.	int64_t maxTurns - The turn at which boards stop if they have not settled.
+	2.	const std::function<bool(int)>& finished - Called with the index of each board as it
+		finishes. May be empty.
+
+ Returns:
+	This method returns the number of generations played, summed over the boards that had not
+	finished.
+
+ Remarks:
+	finished runs on the threads of the ensemble, concurrently for boards of different strips,
+	and may only touch the board it is called with. A finished board whose strip still has boards
+	running is stepped along with them, so its turn keeps counting and its cells keep following
+	its cycle.
+***************************************************************************************************/
+
+	int64_t play(int64_t maxTurns,
+				 const std::function<bool(int)>& finished = std::function<bool(int)>());
+};
+
+#endif
@@ -1,29 +1,67 @@
 #include <iostream>
+#include <algorithm>
+#include <climits>
 #include "gridwindow.h"
 
 using namespace std;
 
-// Constructor for window. It constructs the three portions of the GUI and lays them out vertically.
+// The speeds the speed slider steps through, in turns a second. The last one, 0, plays as fast as the computer
+// goes; at high speeds the simulation plays many turns per call to the engine and the screen shows the latest.
+static const double SPEEDS[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 100000, 0};
+static const int NUM_SPEEDS = sizeof(SPEEDS) / sizeof(SPEEDS[0]);
+static const int DEFAULT_SPEED = 1;     // Two turns a second, as the old 500 millisecond timer played them.
+
+// Constructor for window. It constructs the four portions of the GUI and lays them out vertically.
 GridWindow::GridWindow(QWidget *parent,int row,int col, World *world)
 : QWidget(parent)
 {
 	master = world;
 	rows = row;
 	cols = col;
+	sim = NULL;
+	shownTurn = 0;
+	rewind = new HistoryRing();  // 64 MB of recent generations unless setRewindBudget() says otherwise.
+	if(master != NULL)          // The grid always mirrors the size of the master world.
+	{
+		rows = master->getRows();
+		cols = master->getCols();
+		shownTurn = master->getTurn();
+		rewind->record(*master);
+		sim = new Simulation(*master);
+		sim->setRate(SPEEDS[DEFAULT_SPEED]);
+		sim->setObserver([this](const World &played)
+		{
+			rewind->record(played);    // Keep every generation so that it can be scrubbed back to.
+			noteRewind();
+		});
+	}
+	noteRewind();
+	rateTurn = shownTurn;
+	rateClock.start();
     QHBoxLayout *header = setupHeader();            // Setup the title at the top.
-    QGridLayout *grid = setupGrid();	// Setup the grid of colored cells in the middle.
+    BoardWidget *grid = setupBoard();               // Setup the board of colored cells in the middle.
+    QHBoxLayout *scrubRow = setupScrubber();        // Setup the scrub slider under the grid.
+    QHBoxLayout *speedRow = setupSpeedRow();        // Setup the speed slider under that.
     QHBoxLayout *buttonRow = setupButtonRow();    // Setup the row of buttons across the bottom.
     QVBoxLayout *layout = new QVBoxLayout();        // Put it all onto one box.
     layout->addLayout(header);
-    layout->addLayout(grid);
+    layout->addWidget(grid, 1);                     // The board takes all the room the rest leaves.
+    layout->addLayout(scrubRow);
+    layout->addLayout(speedRow);
     layout->addLayout(buttonRow);
     setLayout(layout);
+
+    timer = new QTimer(this);                                           // One timer for the life of the window.
+    connect(this->timer, SIGNAL(timeout()), this, SLOT(timerFired()));  // Connect "timerFired" method class to the "timeout" signal fired by the timer.
+    this->timer->start(16);                                             // Look for a new generation about 60 times a second.
 }
 
-// Destructor.
+// Destructor. The simulation goes first, since its thread records into the rewind history.
 GridWindow::~GridWindow()
 {
+    delete sim;
     delete title;
+    delete rewind;
 }
 
 // Builds header section of the GUI.  
@@ -41,33 +79,63 @@ QHBoxLayout* GridWindow::setupHeader()
     return header;                      // Returns header to grid window.
 }
 
-// Builds the grid of cells.  This method populates the grid's 2D array of GridCells with MxN cells.
-// We pass a pointer to the master world in each cell so that the cells can access what state
-// they should be.
-QGridLayout* GridWindow::setupGrid()
+// Builds the board: a single widget that draws every cell of the master world and turns clicks into
+// cells, however big the world is.
+BoardWidget* GridWindow::setupBoard()
 {
-    QGridLayout *grid = new QGridLayout();      // Creates grid layout.
-
-    grid->setHorizontalSpacing(0);              // Cells should be side by side.
-    grid->setVerticalSpacing(0);
-    grid->setSpacing(0);
-    grid->setAlignment(Qt::AlignHCenter);
-
-    for(int i=0; i < rows; i++)                     //Each row is a vector of grid cells.
+    board = new BoardWidget(this);
+    connect(board, SIGNAL(cellEdited(int,int,bool)), this, SLOT(handleEdit(int,int,bool)));
+    if(sim != NULL)
     {
-        std::vector<GridCell*> row;                 // Creates new vector for current row.
-        cells.push_back(row);
-        for(int j=0; j < cols; j++)
-        {
-            GridCell *cell = new GridCell(NULL, master, i, j);        // Creates and adds new cell to row.
-            cells.at(i).push_back(cell);
-
-            grid->addWidget(cell,i,j);              // Adds to cell to grid layout. Column expands vertically.
-            grid->setColumnStretch(j,1);
-        }
-        grid->setRowStretch(i,1);                   // Sets row expansion horizontally.
+        bool fresh;
+        board->showFrame(sim->takeFrame(fresh));    // The world as it starts.
     }
-    return grid;                                    // Returns grid.
+    return board;
+}
+
+// Builds the scrub slider. It spans the generations kept by the rewind history, oldest on the left.
+QHBoxLayout* GridWindow::setupScrubber()
+{
+    QHBoxLayout *scrubRow = new QHBoxLayout();      // Creates horizontal box for the slider.
+
+    turnLabel = new QLabel(this);                   // Shows which turn is on the grid.
+    turnLabel->setFixedWidth(150);
+    scrubRow->addWidget(turnLabel);
+
+    scrubber = new QSlider(Qt::Horizontal, this);
+    connect(scrubber, SIGNAL(valueChanged(int)), this, SLOT(handleScrub(int)));
+    scrubRow->addWidget(scrubber);
+
+    updateScrubber();
+    return scrubRow;
+}
+
+// Builds the speed slider, from one turn a second on the left to as fast as it goes on the right, with the speed
+// picked and the speed actually reached next to it.
+QHBoxLayout* GridWindow::setupSpeedRow()
+{
+    QHBoxLayout *speedRow = new QHBoxLayout();      // Creates horizontal box for the slider.
+
+    QLabel *speedTitle = new QLabel("SPEED", this);
+    speedTitle->setFixedWidth(150);
+    speedRow->addWidget(speedTitle);
+
+    speedSlider = new QSlider(Qt::Horizontal, this);
+    speedSlider->setRange(0, NUM_SPEEDS - 1);
+    speedSlider->setValue(DEFAULT_SPEED);
+    connect(speedSlider, SIGNAL(valueChanged(int)), this, SLOT(handleSpeed(int)));
+    speedRow->addWidget(speedSlider);
+
+    speedLabel = new QLabel(this);                  // The speed picked.
+    speedLabel->setFixedWidth(150);
+    speedRow->addWidget(speedLabel);
+
+    rateLabel = new QLabel("0 TURNS/S", this);     // The speed reached, which a big board may fall short of.
+    rateLabel->setFixedWidth(150);
+    speedRow->addWidget(rateLabel);
+
+    handleSpeed(DEFAULT_SPEED);
+    return speedRow;
 }
 
 // Builds the footer section of the GUI that holds all of the buttons.
@@ -94,6 +162,24 @@ QHBoxLayout* GridWindow::setupButtonRow()
     connect(pauseButton, SIGNAL(clicked()), this, SLOT(handlePause()));     
     buttonRow->addWidget(pauseButton);  
 
+    // Step Button - Pauses the game and plays one generation.
+    QPushButton *stepButton = new QPushButton("STEP");
+    stepButton->setFixedSize(100,25);
+    connect(stepButton, SIGNAL(clicked()), this, SLOT(handleStep()));
+    buttonRow->addWidget(stepButton);
+
+    // Step Back Button - Pauses the game and goes back one generation.
+    QPushButton *backButton = new QPushButton("STEP BACK");
+    backButton->setFixedSize(100,25);
+    connect(backButton, SIGNAL(clicked()), this, SLOT(handleStepBack()));
+    buttonRow->addWidget(backButton);
+
+    // Fit Button - Zooms the board back out to show all of it.
+    QPushButton *fitButton = new QPushButton("FIT");
+    fitButton->setFixedSize(100,25);
+    connect(fitButton, SIGNAL(clicked()), this, SLOT(handleFit()));
+    buttonRow->addWidget(fitButton);
+
     // Quit Button - Exits program.
     QPushButton *quitButton = new QPushButton("EXIT");
     quitButton->setFixedSize(100,25); 
@@ -109,26 +195,26 @@ QHBoxLayout* GridWindow::setupButtonRow()
 */
 void GridWindow::handleClear()
 {
-    for(unsigned int row=0; row < cells.size(); row++)          // Loops through current rows' cells.
-    {
-    for(unsigned int col=0; col < cells[row].size(); col++)
-        {
-            GridCell *cell = cells[row][col];                   // Grab the current cell & set its value to dead.
-            cell->setType(DEAD);
-            //master->setHealth(row, col, FALSE);
-        }
-    }
+    if(sim == NULL)
+        return;
+    bool running = sim->isRunning();
+    sim->stop();                                    // The world is only changed while it is not being played.
+    std::vector<uint64_t> empty((size_t)rows * master->getLayout().words, 0);   // A board of DEAD cells.
+    master->setCells(&empty[0], master->getTurn());
+    sim->publish();
+    if(running)
+        sim->start();
 }
 
 /*
     SLOT method for handling clicks on the "start" button. 
-    Receives "clicked" signals on the "start" button and begins game simulation.
+    Receives "clicked" signals on the "start" button and begins game simulation. Clicking it while the game runs
+    does nothing.
 */
 void GridWindow::handleStart()
 {
-    this->timer = new QTimer(this);                                     // Creates new timer.
-    connect(this->timer, SIGNAL(timeout()), this, SLOT(timerFired()));  // Connect "timerFired" method class to the "timeout" signal fired by the timer.
-    this->timer->start(500);                                            // Timer to fire every 500 milliseconds.
+    if(sim != NULL)
+        sim->start();
 }
 
 /*
@@ -137,25 +223,156 @@ void GridWindow::handleStart()
 */
 void GridWindow::handlePause()
 {
-        this->timer->stop();        // Stops the timer.
-        delete this->timer;         // Deletes timer.
+    if(sim != NULL)
+        sim->stop();                // Returns once the generation being played is finished.
 }
 
-// Accessor method - Gets the 2D vector of grid cells.
-std::vector<std::vector<GridCell*> >& GridWindow::getCells()
+/*
+    SLOT method for handling clicks on the "step" button.
+    Pauses the game and plays a single turn.
+*/
+void GridWindow::handleStep()
 {
-    return this->cells;
+    if(sim == NULL)
+        return;
+    handlePause();
+    sim->step();
 }
 
+/*
+    SLOT method for handling the speed slider.
+    Sets how many turns a second the game plays, whether it is running or not.
+*/
+void GridWindow::handleSpeed(int value)
+{
+    double speed = SPEEDS[std::min(std::max(value, 0), NUM_SPEEDS - 1)];
+    if(speed > 0)
+        speedLabel->setText(QString("%1/S").arg(speed, 0, 'f', 0));
+    else
+        speedLabel->setText("MAX");
+    if(sim != NULL)
+        sim->setRate(speed);
+}
+
+/*
+    SLOT method for handling clicks on the "step back" button.
+    Pauses the game and puts the generation before the one on display back on the grid.
+*/
+void GridWindow::handleStepBack()
+{
+    if(sim == NULL)
+        return;
+    handlePause();                  // Settles the turn of the master world.
+    rewindTo(master->getTurn() - 1);
+}
+
+/*
+    SLOT method for handling clicks on the "fit" button.
+    Zooms and pans the board so that all of it is in view, and keeps it that way as the window is resized.
+*/
+void GridWindow::handleFit()
+{
+    board->fitBoard();
+}
+
+/*
+    SLOT method for handling the scrub slider.
+    Pauses the game and puts the generation under the slider on the grid. Resuming plays on from there,
+    dropping the generations that came after it.
+*/
+void GridWindow::handleScrub(int value)
+{
+    rewindTo(firstTurn + value);
+}
+
+/*
+    SLOT method for handling clicks on the board.
+    Sets the cell the user clicked or dragged over. While the game runs the simulation applies it before its next
+    turn; either way it shows up with the next frame.
+*/
+void GridWindow::handleEdit(int row, int col, bool health)
+{
+    if(sim != NULL)
+        sim->edit(row, col, health);
+}
+
+// Sets how much memory the rewind history may take, dropping its oldest generations if they no longer fit.
+// Pauses the game, since the simulation records into the history as it plays.
+void GridWindow::setRewindBudget(size_t bytes)
+{
+    handlePause();
+    rewind->setMaxBytes(bytes);
+    noteRewind();
+    updateScrubber();
+}
+
+// Accessor method - Gets the simulation playing the master world.
+Simulation* GridWindow::getSimulation()
+{
+    return this->sim;
+}
+
+// Puts a recorded generation back into the master world and onto the grid. Decoding goes from the keyframe
+// before the generation, so it takes milliseconds however far back it is.
+void GridWindow::rewindTo(int64_t turn)
+{
+    handlePause();
+    if(master == NULL || !rewind->seek(turn) || !rewind->restore(*master))
+        return;
+    sim->publish();                 // Shown with the next frame.
+    noteRewind();
+}
+
+// Accessor method - Gets the board widget.
+BoardWidget* GridWindow::getBoard()
+{
+    return this->board;
+}
+
+// Shows the latest generation the simulation has finished, if it is one that has not been shown yet. Never waits
+// for the simulation; only the parts of the board that changed are drawn again.
 void GridWindow::timerFired()
 {
-	master->play(1);				// Move the master world forward one turn.
-	// Update the gridWindow to match the master world.
-	for (int i = 0; i < rows; i++)
+	if(sim == NULL)
+		return;
+	bool fresh;
+	const SimulationFrame *frame = sim->takeFrame(fresh);
+	if(fresh)
 	{
-		for (int j = 0; j < cols; j++)
-		{
-			cells[i][j]->updateCell();
-		}
+		shownTurn = frame->turn;
+		board->showFrame(frame);
+		updateScrubber();
 	}
+	updateRate();
+}
+
+// Shows the number of turns played a second, counted from the turns on display over the last half second or so.
+// Going back in time counts as no turns.
+void GridWindow::updateRate()
+{
+	qlonglong elapsed = rateClock.elapsed();
+	if(elapsed < 500)
+		return;
+	double rate = std::max(shownTurn - rateTurn, (int64_t)0) * 1000.0 / elapsed;
+	rateLabel->setText(QString("%1 TURNS/S").arg(rate, 0, 'f', 0));
+	rateTurn = shownTurn;
+	rateClock.restart();
+}
+
+// Publishes the range of turns the rewind history holds, for the slider to read on the window's thread.
+void GridWindow::noteRewind()
+{
+	firstTurn = rewind->getFirstTurn();
+	lastTurn = rewind->getLastTurn();
+}
+
+// Moves the slider to the turn on display, over the range of generations the rewind history still holds.
+void GridWindow::updateScrubber()
+{
+	int64_t first = firstTurn, span = lastTurn - first;
+	scrubber->blockSignals(true);	// Moving the slider here is not the user scrubbing.
+	scrubber->setRange(0, (int)std::min(std::max(span, (int64_t)0), (int64_t)INT_MAX));
+	scrubber->setValue((int)std::min(std::max(shownTurn - first, (int64_t)0), (int64_t)INT_MAX));
+	scrubber->blockSignals(false);
+	turnLabel->setText(QString("TURN %1").arg((qlonglong)shownTurn));
 }
@@ -3,46 +3,85 @@
 #define GRIDWINDOW_H_
 
 #include <vector>
+#include <atomic>
 #include <QWidget>
 #include <QTimer>
-#include <QGridLayout>
 #include <QLabel>
+#include <QSlider>
+#include <QPushButton>
+#include <QElapsedTimer>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
 #include <QApplication>
-#include "gridcell.h"
+#include "boardwidget.h"
+#include "history.h"
+#include "simulation.h"
 #include "world.h"
 
 /*
 class GridWindow:
     This is the class representing the whole window that comes up when this program runs.  
-    It contains a header section with a title, a middle section of MxN cells and a bottom section with buttons.
+    It contains a header section with a title, a middle section drawing the MxN cells (zoomed and panned with
+    the mouse, see BoardWidget), a slider to scrub back
+    through the recent generations, a speed slider and a bottom section with buttons.
+    The master world is played by a Simulation on a thread of its own, so a big board never holds up the
+    window.  A timer polls the simulation for its latest generation about 60 times a second and shows it
+    without waiting; generations finished in between are never drawn.  Anything that changes the world
+    directly (clearing, stepping back, scrubbing) pauses the simulation first.
 */
 class GridWindow : public QWidget
 {
     Q_OBJECT                            // Macro to allow this object to have signals & slots.
 
     private:
-        std::vector<std::vector<GridCell*> > cells;     // A 2D vector containing pointers to all the cells in the grid.
+        BoardWidget *board;                             // Draws all the cells and lets the user click on them.
         QLabel *title;                                  // A pointer to the Title text on the window.
-        QTimer *timer;                                  // Creates timer object.
+        QTimer *timer;                                  // Polls the simulation for new frames to draw.
+        QSlider *scrubber;                              // Scrubs back and forth through the recent generations.
+        QLabel *turnLabel;                              // Shows the turn on display.
+        QSlider *speedSlider;                           // Picks the number of turns played a second.
+        QLabel *speedLabel;                             // Shows the speed picked.
+        QLabel *rateLabel;                              // Shows the turns actually played a second.
+        QElapsedTimer rateClock;                        // Times the turns counted for rateLabel,
+        int64_t rateTurn;                               // which are counted from this one.
+        HistoryRing *rewind;                            // The recent generations of the master world, compressed.
+        std::atomic<int64_t> firstTurn;                 // The oldest and newest turns the rewind history holds,
+        std::atomic<int64_t> lastTurn;                  // which it is filled with on the simulation's thread.
+        int64_t shownTurn;                              // The turn on display.
         int rows;
         int cols;
         World *master;
+        Simulation *sim;                                // Plays the master world (NULL if there is none).
 
     public slots:
         void handleClear();             // Handler function for clicking the Clear button.
         void handleStart();             // Handler function for clicking the Start button.
         void handlePause();             // Handler function for clicking the Pause button.
+        void handleStep();              // Handler function for clicking the Step button.
+        void handleStepBack();          // Handler function for clicking the Step Back button.
+        void handleFit();               // Handler function for clicking the Fit button.
+        void handleSpeed(int value);    // Handler function for dragging the speed slider.
+        void handleScrub(int value);    // Handler function for dragging the scrub slider.
+        void handleEdit(int row, int col, bool health);    // Handler function for clicks on the board.
         void timerFired();              // Method called whenever timer fires.
 
     public:
         GridWindow(QWidget *parent = NULL,int rows=3,int cols=3, World *A = NULL);       // Constructor.
         virtual ~GridWindow();                                          // Destructor.
-        std::vector<std::vector<GridCell*> >& getCells();               // Accessor for the array of grid cells.
+        BoardWidget* getBoard();                                        // Accessor for the board widget.
+        void setRewindBudget(size_t bytes);                             // Sets the memory kept for scrubbing back.
+        Simulation* getSimulation();                                    // Accessor for the simulation.
 
     private:
         QHBoxLayout* setupHeader();                     // Helper function to construct the GUI header.
-        QGridLayout* setupGrid();      // Helper function to constructor the GUI's grid.
+        BoardWidget* setupBoard();         // Helper function to construct the GUI's board.
+        QHBoxLayout* setupScrubber();      // Helper function to setup the scrub slider above the buttons.
+        QHBoxLayout* setupSpeedRow();      // Helper function to setup the speed slider above the buttons.
         QHBoxLayout* setupButtonRow();     // Helper function to setup the row of buttons at the bottom.
+        void rewindTo(int64_t turn);       // Puts a recorded generation back into the master world.
+        void noteRewind();                 // Publishes the range of turns the rewind history holds.
+        void updateScrubber();             // Matches the slider and the turn label to the turn on display.
+        void updateRate();                 // Shows how many turns a second were played lately.
 };
 
 #endif
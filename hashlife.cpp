@@ -0,0 +1,462 @@
+/***************************************************************************************************
+ File Name:
+	hashlife.cpp
+
+ Purpose:
+	Implementation file for the HashLife engine of the game. Defines a class called HashLife that
+	evolves a pattern on the unbounded plane with a hash-consed quadtree whose nodes remember their
+	own future, so it can jump ahead by huge powers of two generations at once.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "hashlife.h"
+
+const uint32_t HashLife::NONE;
+const uint8_t HashLife::FREE;
+const size_t HashLife::MIN_MEMORY;
+
+namespace
+{
+
+inline size_t hashNode(const uint32_t nw, const uint32_t ne, const uint32_t sw, const uint32_t se)
+{
+	uint64_t h = nw;
+	h = h * 0x9e3779b97f4a7c15ull + ne;
+	h = h * 0x9e3779b97f4a7c15ull + sw;
+	h = h * 0x9e3779b97f4a7c15ull + se;
+	return (size_t)(h ^ (h >> 29));
+}
+
+}
+
+HashLife::HashLife(const KernelRule& rule, const size_t maxBytes)
+{
+	count = 0;
+	maxMemory = (maxBytes > MIN_MEMORY) ? maxBytes : MIN_MEMORY;
+	collections = 0;
+
+	// Nothing is collected until the empty universe is built
+	threshold = (size_t)-1;
+
+	// One generation of every 4x4 block, which is all the rule is needed for
+	base.assign(1 << 16, 0);
+	for(int block = 0; block < (1 << 16); block++)
+	{
+		for(int row = 1; row <= 2; row++)
+		{
+			for(int col = 1; col <= 2; col++)
+			{
+				int numLiving = 0;
+				for(int i = row - 1; i <= row + 1; i++)
+				{
+					for(int j = col - 1; j <= col + 1; j++)
+					{
+						if((i != row) || (j != col))
+							numLiving += (block >> (4 * i + j)) & 1;
+					}
+				}
+				const bool alive = (block >> (4 * row + col)) & 1;
+				const unsigned counts = alive ? rule.survival : rule.birth;
+				if((counts >> numLiving) & 1)
+					base[block] |= 1 << (2 * (row - 1) + (col - 1));
+			}
+		}
+	}
+
+	buckets.assign(1 << 16, NONE);
+	for(int health = 0; health < 2; health++)
+	{
+		const uint32_t i = allocate();
+		Node& node = nodes[i];
+		node.nw = node.ne = node.sw = node.se = health;
+		node.chain = NONE;
+		node.result = NONE;
+		node.population = health;
+		node.level = 0;
+		node.resultStep = 0;
+		node.marked = 0;
+		leaf[health] = i;
+	}
+	root = leaf[0];
+	empty.push_back(leaf[0]);
+	root = emptyNode(3);
+	threshold = maxMemory;
+}
+
+uint32_t HashLife::allocate()
+{
+	if(!freeList.empty())
+	{
+		const uint32_t i = freeList.back();
+		freeList.pop_back();
+		return i;
+	}
+	nodes.push_back(Node());
+	return (uint32_t)(nodes.size() - 1);
+}
+
+uint32_t HashLife::emptyNode(const int level)
+{
+	while((int)empty.size() <= level)
+	{
+		const uint32_t e = empty.back();
+		const uint32_t bigger = join(e, e, e, e);
+		empty.push_back(bigger);
+	}
+	return empty[level];
+}
+
+uint32_t HashLife::join(const uint32_t nw, const uint32_t ne, const uint32_t sw, const uint32_t se)
+{
+	const size_t h = hashNode(nw, ne, sw, se);
+	for(uint32_t i = buckets[h & (buckets.size() - 1)]; i != NONE; i = nodes[i].chain)
+	{
+		const Node& node = nodes[i];
+		if((node.nw == nw) && (node.ne == ne) && (node.sw == sw) && (node.se == se))
+			return i;
+	}
+
+	// A new node: make room for it first
+	if(getMemory() > threshold)
+	{
+		const size_t mark = stack.size();
+		stack.push_back(nw);
+		stack.push_back(ne);
+		stack.push_back(sw);
+		stack.push_back(se);
+		collect();
+		stack.resize(mark);
+	}
+	if(count >= buckets.size())
+		rehash(buckets.size() * 2);
+
+	const uint32_t i = allocate();
+	Node& node = nodes[i];
+	node.nw = nw;
+	node.ne = ne;
+	node.sw = sw;
+	node.se = se;
+	node.result = NONE;
+	node.population = nodes[nw].population + nodes[ne].population + nodes[sw].population +
+					  nodes[se].population;
+	node.level = nodes[nw].level + 1;
+	node.resultStep = 0;
+	node.marked = 0;
+	const size_t bucket = h & (buckets.size() - 1);
+	node.chain = buckets[bucket];
+	buckets[bucket] = i;
+	count++;
+	return i;
+}
+
+uint32_t HashLife::keep(const uint32_t node)
+{
+	stack.push_back(node);
+	return node;
+}
+
+uint32_t HashLife::centre(const uint32_t node)
+{
+	const Node n = nodes[node];
+	return join(nodes[n.nw].se, nodes[n.ne].sw, nodes[n.sw].ne, nodes[n.se].nw);
+}
+
+uint32_t HashLife::step(const uint32_t node, const int k)
+{
+	const Node n = nodes[node];
+	if(n.population == 0)
+		return emptyNode(n.level - 1);
+	if((n.result != NONE) && (n.resultStep == k))
+		return n.result;
+
+	uint32_t result;
+	if(n.level == 2)
+	{
+		// The base case: look the 4x4 block up
+		const uint32_t quadrant[4] = {n.nw, n.ne, n.sw, n.se};
+		int block = 0;
+		for(int row = 0; row < 4; row++)
+		{
+			for(int col = 0; col < 4; col++)
+			{
+				const Node& q = nodes[quadrant[(row >> 1) * 2 + (col >> 1)]];
+				const uint32_t cells[4] = {q.nw, q.ne, q.sw, q.se};
+				const uint64_t alive = nodes[cells[(row & 1) * 2 + (col & 1)]].population;
+				block |= (int)alive << (4 * row + col);
+			}
+		}
+		const int next = base[block];
+		result = join(leaf[next & 1], leaf[(next >> 1) & 1], leaf[(next >> 2) & 1],
+					  leaf[(next >> 3) & 1]);
+	}
+	else
+	{
+		const size_t mark = stack.size();
+		keep(node);
+
+		// The nine overlapping squares of half the width, from the top left to the bottom right
+		const Node nw = nodes[n.nw], ne = nodes[n.ne], sw = nodes[n.sw], se = nodes[n.se];
+		uint32_t square[9];
+		square[0] = n.nw;
+		square[1] = keep(join(nw.ne, ne.nw, nw.se, ne.sw));
+		square[2] = n.ne;
+		square[3] = keep(join(nw.sw, nw.se, sw.nw, sw.ne));
+		square[4] = keep(join(nw.se, ne.sw, sw.ne, se.nw));
+		square[5] = keep(join(ne.sw, ne.se, se.nw, se.ne));
+		square[6] = n.sw;
+		square[7] = keep(join(sw.ne, se.nw, sw.se, se.sw));
+		square[8] = n.se;
+
+		// A full step of 2^(level - 2) is two half steps; a shorter one only steps the second time
+		const bool full = (k == n.level - 2);
+		const int half = full ? n.level - 3 : k;
+		uint32_t inner[9];
+		for(int i = 0; i < 9; i++)
+			inner[i] = keep(full ? step(square[i], half) : centre(square[i]));
+
+		const uint32_t a = keep(step(keep(join(inner[0], inner[1], inner[3], inner[4])), half));
+		const uint32_t b = keep(step(keep(join(inner[1], inner[2], inner[4], inner[5])), half));
+		const uint32_t c = keep(step(keep(join(inner[3], inner[4], inner[6], inner[7])), half));
+		const uint32_t d = keep(step(keep(join(inner[4], inner[5], inner[7], inner[8])), half));
+		result = join(a, b, c, d);
+		stack.resize(mark);
+	}
+
+	nodes[node].result = result;
+	nodes[node].resultStep = (uint8_t)k;
+	return result;
+}
+
+void HashLife::expand()
+{
+	const Node r = nodes[root];
+	const size_t mark = stack.size();
+	keep(root);
+	const uint32_t e = keep(emptyNode(r.level - 1));
+	const uint32_t nw = keep(join(e, e, e, r.nw));
+	const uint32_t ne = keep(join(e, e, r.ne, e));
+	const uint32_t sw = keep(join(e, r.sw, e, e));
+	const uint32_t se = keep(join(r.se, e, e, e));
+	root = join(nw, ne, sw, se);
+	stack.resize(mark);
+}
+
+bool HashLife::isContained() const
+{
+	const Node& r = nodes[root];
+	if(r.level < 3)
+		return false;
+	const uint64_t inner = nodes[nodes[nodes[r.nw].se].se].population +
+						   nodes[nodes[nodes[r.ne].sw].sw].population +
+						   nodes[nodes[nodes[r.sw].ne].ne].population +
+						   nodes[nodes[nodes[r.se].nw].nw].population;
+	return inner == r.population;
+}
+
+void HashLife::run(const uint64_t generations)
+{
+	for(int k = 63; k >= 0; k--)
+	{
+		if(((generations >> k) & 1) == 0)
+			continue;
+
+		// Make sure nothing can travel off of the universe during the jump
+		while((nodes[root].level < k + 3) || !isContained())
+			expand();
+
+		stack.clear();
+		root = step(root, k);
+		stack.clear();
+	}
+}
+
+uint32_t HashLife::build(const BoardLayout& layout, const uint64_t* board, const int level,
+						 const int64_t row, const int64_t col)
+{
+	const int64_t size = (int64_t)1 << level;
+	if((row >= layout.rows) || (col >= layout.cols) || (row + size <= 0) || (col + size <= 0))
+		return emptyNode(level);
+	if(level == 0)
+		return leaf[(board[row * layout.stride + (col >> 6)] >> (col & 63)) & 1];
+	if(level <= 6)
+	{
+		// Nodes this small lie within a single word of each row, so empty ones are quick to spot
+		const int64_t firstCol = (col > 0) ? col : 0;
+		const int64_t lastCol = ((col + size < layout.cols) ? col + size : layout.cols) - 1;
+		const uint64_t mask = (~(uint64_t)0 << (firstCol & 63)) &
+							  (~(uint64_t)0 >> (63 - (lastCol & 63)));
+		const int64_t firstRow = (row > 0) ? row : 0;
+		const int64_t lastRow = (row + size < layout.rows) ? row + size : layout.rows;
+		uint64_t any = 0;
+		for(int64_t i = firstRow; i < lastRow; i++)
+			any |= board[i * layout.stride + (firstCol >> 6)] & mask;
+		if(any == 0)
+			return emptyNode(level);
+	}
+
+	const int64_t half = size / 2;
+	const size_t mark = stack.size();
+	const uint32_t nw = keep(build(layout, board, level - 1, row, col));
+	const uint32_t ne = keep(build(layout, board, level - 1, row, col + half));
+	const uint32_t sw = keep(build(layout, board, level - 1, row + half, col));
+	const uint32_t se = keep(build(layout, board, level - 1, row + half, col + half));
+	const uint32_t node = join(nw, ne, sw, se);
+	stack.resize(mark);
+	return node;
+}
+
+void HashLife::load(const BoardLayout& layout, const uint64_t* board)
+{
+	// The smallest universe centered on (0, 0) that holds the board
+	const int64_t width = (layout.rows > layout.cols) ? layout.rows : layout.cols;
+	int level = 3;
+	while(((int64_t)1 << (level - 1)) < width)
+		level++;
+	const int64_t corner = -((int64_t)1 << (level - 1));
+	stack.clear();
+	root = build(layout, board, level, corner, corner);
+	stack.clear();
+}
+
+void HashLife::extract(const BoardLayout& layout, uint64_t* board, const uint32_t node,
+					   const int64_t row, const int64_t col) const
+{
+	const Node& n = nodes[node];
+	const int64_t size = (int64_t)1 << n.level;
+	if((n.population == 0) || (row >= layout.rows) || (col >= layout.cols) || (row + size <= 0) ||
+	   (col + size <= 0))
+		return;
+	if(n.level == 0)
+	{
+		board[row * layout.stride + (col >> 6)] |= (uint64_t)1 << (col & 63);
+		return;
+	}
+	const int64_t half = size / 2;
+	extract(layout, board, n.nw, row, col);
+	extract(layout, board, n.ne, row, col + half);
+	extract(layout, board, n.sw, row + half, col);
+	extract(layout, board, n.se, row + half, col + half);
+}
+
+void HashLife::store(const BoardLayout& layout, uint64_t* board) const
+{
+	const Node& r = nodes[root];
+	if(r.level <= 40)
+	{
+		const int64_t corner = -((int64_t)1 << (r.level - 1));
+		extract(layout, board, root, corner, corner);
+		return;
+	}
+
+	// Coordinates would overflow on a universe this big, but the board is always in the top left
+	// corner of its bottom right quadrant
+	uint32_t node = r.se;
+	while(nodes[node].level > 33)
+		node = nodes[node].nw;
+	extract(layout, board, node, 0, 0);
+}
+
+uint64_t HashLife::getPopulation() const
+{
+	return nodes[root].population;
+}
+
+size_t HashLife::getMemory() const
+{
+	return (nodes.size() - freeList.size()) * sizeof(Node) + buckets.size() * sizeof(uint32_t);
+}
+
+void HashLife::setMaxMemory(const size_t maxBytes)
+{
+	maxMemory = (maxBytes > MIN_MEMORY) ? maxBytes : MIN_MEMORY;
+	threshold = maxMemory;
+}
+
+int HashLife::getCollections() const
+{
+	return collections;
+}
+
+void HashLife::rehash(const size_t size)
+{
+	buckets.assign(size, NONE);
+	for(size_t i = 0; i < nodes.size(); i++)
+	{
+		Node& node = nodes[i];
+		if((node.level == FREE) || (node.level == 0))
+			continue;
+		const size_t bucket = hashNode(node.nw, node.ne, node.sw, node.se) & (size - 1);
+		node.chain = buckets[bucket];
+		buckets[bucket] = (uint32_t)i;
+	}
+}
+
+void HashLife::sweep()
+{
+	// Mark everything reachable from the roots
+	std::vector<uint32_t> pending(stack);
+	pending.push_back(root);
+	pending.insert(pending.end(), empty.begin(), empty.end());
+	pending.push_back(leaf[1]);
+	while(!pending.empty())
+	{
+		const uint32_t i = pending.back();
+		pending.pop_back();
+		Node& node = nodes[i];
+		if(node.marked)
+			continue;
+		node.marked = 1;
+		if(node.level > 0)
+		{
+			pending.push_back(node.nw);
+			pending.push_back(node.ne);
+			pending.push_back(node.sw);
+			pending.push_back(node.se);
+		}
+	}
+
+	// Free the rest and forget the results that pointed at it
+	count = 0;
+	for(size_t i = 0; i < nodes.size(); i++)
+	{
+		Node& node = nodes[i];
+		if(node.level == FREE)
+			continue;
+		if(!node.marked)
+		{
+			node.level = FREE;
+			freeList.push_back((uint32_t)i);
+		}
+		else if(node.level > 0)
+			count++;
+	}
+	for(size_t i = 0; i < nodes.size(); i++)
+	{
+		Node& node = nodes[i];
+		if((node.level != FREE) && (node.result != NONE) && !nodes[node.result].marked)
+			node.result = NONE;
+	}
+	for(size_t i = 0; i < nodes.size(); i++)
+		nodes[i].marked = 0;
+	rehash(buckets.size());
+}
+
+void HashLife::collect()
+{
+	collections++;
+	sweep();
+	if(getMemory() > maxMemory / 4 * 3)
+	{
+		// The cached results hold on to too much: drop them all
+		for(size_t i = 0; i < nodes.size(); i++)
+			nodes[i].result = NONE;
+		sweep();
+	}
+
+	// If the pattern alone needs more than the cap, let the cache grow a little past it
+	threshold = maxMemory;
+	if(getMemory() > maxMemory / 4 * 3)
+		threshold = getMemory() + maxMemory / 4;
+}
@@ -0,0 +1,459 @@
+/***************************************************************************************************
+ File Name:
+	hashlife.h
+
+ Purpose:
+	Specification file for the HashLife engine of the game. Defines a class called HashLife that
+	evolves a pattern on the unbounded plane with a hash-consed quadtree whose nodes remember their
+	own future, so it can jump ahead by huge powers of two generations at once.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "kernel.h"
+
+/***************************************************************************************************
+ Class:
+	HashLife
+
+ Description:
+	A universe for the HashLife algorithm. Space is a quadtree: a node of level L is a square of
+	2^L by 2^L cells made of four nodes of level L - 1, and a node of level 0 is a single cell.
+	Identical nodes are shared (hash consing), so repetitive patterns take little memory. A node of
+	level L also caches its center square of level L - 1 advanced by 2^k generations, so any
+	pattern that has been seen before is never computed again.
+
+	The universe is centered on (0, 0) and grows as the pattern does. Cells are addressed by row
+	and column like the world's board, and may be negative.
+
+ Remarks:
+	Nodes are referred to by their index in the node pool. When the pool grows past the memory cap
+	the unreachable nodes and cached results are garbage collected.
+***************************************************************************************************/
+
+class HashLife
+{
+
+private:
+
+	/* A node of the quadtree. For a leaf (level 0) nw holds the health of the cell and the other
+	children are unused. */
+	struct Node
+	{
+		uint32_t nw;
+		uint32_t ne;
+		uint32_t sw;
+		uint32_t se;
+
+		/* The next node in the same bucket of the hash table, or NONE. */
+		uint32_t chain;
+
+		/* The cached center square advanced by 2^resultStep generations, or NONE. */
+		uint32_t result;
+
+		/* The number of living cells in the node. */
+		uint64_t population;
+
+		/* The level of the node, or FREE if the node is unused. */
+		uint8_t level;
+		uint8_t resultStep;
+		uint8_t marked;
+	};
+
+	/* The index used for no node at all. */
+	static const uint32_t NONE = 0xffffffffu;
+
+	/* The level of a node in the free list. */
+	static const uint8_t FREE = 0xff;
+
+	/* The pool of nodes. */
+	std::vector<Node> nodes;
+
+	/* The unused nodes of the pool. */
+	std::vector<uint32_t> freeList;
+
+	/* The hash table of nodes, chained through Node::chain. Its size is a power of two. */
+	std::vector<uint32_t> buckets;
+
+	/* The number of nodes in the hash table. */
+	size_t count;
+
+	/* The canonical empty node of every level. */
+	std::vector<uint32_t> empty;
+
+	/* The dead and living leaves. */
+	uint32_t leaf[2];
+
+	/* The whole universe. */
+	uint32_t root;
+
+	/* The nodes in use by the step in progress. They are kept by the garbage collector. */
+	std::vector<uint32_t> stack;
+
+	/* For every 4x4 block of cells (bit 4 * row + col), the 2x2 block at its center one generation
+	later (bit 2 * row + col). */
+	std::vector<uint8_t> base;
+
+	/* The memory cap in bytes and the number of garbage collections so far. */
+	size_t maxMemory;
+	int collections;
+
+	/* The size of the cache that triggers the next garbage collection. It is the memory cap,
+	unless the nodes the pattern itself needs take more than that. */
+	size_t threshold;
+
+	/* Universes own their node pools and cannot be copied. */
+	HashLife(const HashLife&);
+	HashLife& operator=(const HashLife&);
+
+/***************************************************************************************************
+ Method:
+	uint32_t join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se)
+
+ Scope:
+	Private.
+
+ Description:
+	Finds or creates the node made of four nodes of the same level. May garbage collect.
+
+ Returns:
+	This method returns the index of the canonical node.
+***************************************************************************************************/
+
+	uint32_t join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+
+/***************************************************************************************************
+ Method:
+	uint32_t allocate()
+
+ Scope:
+	Private.
+
+ Description:
+	Takes an unused node from the free list, or adds one to the pool.
+
+ Returns:
+	This method returns the index of the new node.
+***************************************************************************************************/
+
+	uint32_t allocate();
+
+/***************************************************************************************************
+ Method:
+	uint32_t emptyNode(int level)
+
+ Scope:
+	Private.
+
+ Description:
+	Finds or creates the canonical empty node of a level.
+
+ Returns:
+	This method returns the index of the empty node.
+***************************************************************************************************/
+
+	uint32_t emptyNode(int level);
+
+/***************************************************************************************************
+ Method:
+	uint32_t centre(uint32_t node)
+
+ Scope:
+	Private.
+
+ Description:
+	Finds or creates the center square (half the width) of a node of level 2 or more.
+
+ Returns:
+	This method returns the index of the center node.
+***************************************************************************************************/
+
+	uint32_t centre(uint32_t node);
+
+/***************************************************************************************************
+ Method:
+	uint32_t step(uint32_t node, int k)
+
+ Scope:
+	Private.
+
+ Description:
+	Advances the center square of a node by 2^k generations. The center square is all that can be
+	known after 2^(level - 2) generations without looking outside of the node, so k must be at most
+	level - 2. Results are cached in the node.
+
+ Returns:
+	This method returns the index of the advanced center node.
+***************************************************************************************************/
+
+	uint32_t step(uint32_t node, int k);
+
+/***************************************************************************************************
+ Method:
+	uint32_t keep(uint32_t node)
+
+ Scope:
+	Private.
+
+ Description:
+	Protects a node from the garbage collector until the step in progress unwinds.
+
+ Returns:
+	This method returns the node.
+***************************************************************************************************/
+
+	uint32_t keep(uint32_t node);
+
+/***************************************************************************************************
+ Method:
+	void expand()
+
+ Scope:
+	Private.
+
+ Description:
+	Doubles the width of the universe, keeping the current universe in its center.
+***************************************************************************************************/
+
+	void expand();
+
+/***************************************************************************************************
+ Method:
+	bool isContained() const
+
+ Scope:
+	Private.
+
+ Description:
+	Determines whether every living cell lies in the middle half (in width) of the universe, which
+	is what guarantees that a step cannot push any of them off of the universe.
+
+ Returns:
+	This method returns TRUE if the pattern is well inside of the universe.
+***************************************************************************************************/
+
+	bool isContained() const;
+
+/***************************************************************************************************
+ Method:
+	uint32_t build(const BoardLayout& layout, const uint64_t* board, int level, int64_t row,
+				   int64_t col)
+
+ Scope:
+	Private.
+
+ Description:
+	Builds the node of a level with its top left cell at (row, col) from a bit-packed board. Cells
+	off of the board are dead.
+***************************************************************************************************/
+
+	uint32_t build(const BoardLayout& layout, const uint64_t* board, int level, int64_t row,
+				   int64_t col);
+
+/***************************************************************************************************
+ Method:
+	void extract(const BoardLayout& layout, uint64_t* board, uint32_t node, int64_t row,
+				 int64_t col) const
+
+ Scope:
+	Private.
+
+ Description:
+	Writes the living cells of a node with its top left cell at (row, col) into a bit-packed board.
+	Cells off of the board are ignored.
+***************************************************************************************************/
+
+	void extract(const BoardLayout& layout, uint64_t* board, uint32_t node, int64_t row,
+				 int64_t col) const;
+
+/***************************************************************************************************
+ Method:
+	void collect()
+
+ Scope:
+	Private.
+
+ Description:
+	Garbage collects the nodes unreachable from the universe, the canonical nodes and the step in
+	progress, and forgets the cached results that point at them. If that is not enough to get well
+	below the memory cap, every cached result is forgotten and the collection is repeated.
+***************************************************************************************************/
+
+	void collect();
+
+/***************************************************************************************************
+ Method:
+	void sweep()
+
+ Scope:
+	Private.
+
+ Description:
+	One mark and sweep pass of the garbage collector. See collect().
+***************************************************************************************************/
+
+	void sweep();
+
+/***************************************************************************************************
+ Method:
+	void rehash(size_t size)
+
+ Scope:
+	Private.
+
+ Description:
+	Rebuilds the hash table with the specified number of buckets (a power of two).
+***************************************************************************************************/
+
+	void rehash(size_t size);
+
+public:
+
+	/* The smallest memory cap, in bytes. The hash table the universe starts with takes a quarter
+	of it, and a cap any smaller would leave no room for the nodes. */
+	static const size_t MIN_MEMORY = (size_t)1 << 20;
+
+/***************************************************************************************************
+ Method:
+	HashLife(const KernelRule& rule, size_t maxBytes)
+
+ Scope:
+	Public.
+
+ Description:
+	A constructor. Creates an empty universe.
+
+ Parameters:
+	1.	const KernelRule& rule - The rule of the game.
+	2.	size_t maxBytes - The memory cap of the node cache in bytes, at least MIN_MEMORY.
+***************************************************************************************************/
+
+	HashLife(const KernelRule& rule, size_t maxBytes);
+
+/***************************************************************************************************
+ Method:
+	void load(const BoardLayout& layout, const uint64_t* board)
+
+ Scope:
+	Public.
+
+ Description:
+	Replaces the universe with the cells of a bit-packed board. Cell (row, col) of the board
+	becomes cell (row, col) of the universe and every other cell of the universe is dead.
+
+ Parameters:
+	1.	const BoardLayout& layout - The layout of the board.
+	2.	const uint64_t* board - Row 0 of the board.
+***************************************************************************************************/
+
+	void load(const BoardLayout& layout, const uint64_t* board);
+
+/***************************************************************************************************
+ Method:
+	void store(const BoardLayout& layout, uint64_t* board) const
+
+ Scope:
+	Public.
+
+ Description:
+	Copies the cells of the universe that lie on a bit-packed board into the board. The cells of
+	the universe off of the board are left out but are not lost.
+
+ Parameters:
+	1.	const BoardLayout& layout - The layout of the board.
+	2.	uint64_t* board - Row 0 of the board.
+***************************************************************************************************/
+
+	void store(const BoardLayout& layout, uint64_t* board) const;
+
+/***************************************************************************************************
+ Method:
+	void run(uint64_t generations)
+
+ Scope:
+	Public.
+
+ Description:
+	Advances the universe. The number of generations is split into powers of two, and each of them
+	is done as a single jump.
+
+ Parameters:
+	1.	uint64_t generations - The number of generations to advance.
+***************************************************************************************************/
+
+	void run(uint64_t generations);
+
+/***************************************************************************************************
+ Method:
+	uint64_t getPopulation() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of living cells in the universe.
+
+ Returns:
+	This method returns the population of the universe.
+***************************************************************************************************/
+
+	uint64_t getPopulation() const;
+
+/***************************************************************************************************
+ Method:
+	size_t getMemory() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the memory taken by the nodes in use and the hash table.
+
+ Returns:
+	This method returns the size of the node cache in bytes.
+***************************************************************************************************/
+
+	size_t getMemory() const;
+
+/***************************************************************************************************
+ Method:
+	void setMaxMemory(size_t maxBytes)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the memory cap of the node cache. Once the cache grows past it, it is garbage collected.
+
+ Parameters:
+	1.	size_t maxBytes - The memory cap in bytes. A cap below MIN_MEMORY is raised to it.
+***************************************************************************************************/
+
+	void setMaxMemory(size_t maxBytes);
+
+/***************************************************************************************************
+ Method:
+	int getCollections() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of garbage collections done so far.
+
+ Returns:
+	This method returns the number of garbage collections.
+***************************************************************************************************/
+
+	int getCollections() const;
+
+};
+
+#endif
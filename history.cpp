@@ -0,0 +1,639 @@
+/***************************************************************************************************
+ File Name:
+	history.cpp
+
+ Purpose:
+	Implementation file for the generation history of the game engine. The writer encodes on a
+	thread of its own; the reader indexes the stream by its record headers and decodes on demand.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "history.h"
+#include "kernel.h"
+#include "world.h"
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+
+const char MAGIC[8] = {'L', 'I', 'F', 'E', 'H', 'I', 'S', 'T'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+/* The number of words encoded together, one bit of a mask each. */
+const size_t GROUP_WORDS = 64;
+
+/* The position of a reader that has not decoded a generation. */
+const size_t NO_FRAME = (size_t)-1;
+
+/* Writes a count, seven bits to a byte, and returns the byte past it. */
+unsigned char* putCount(unsigned char* out, uint64_t count)
+{
+	while(count >= 0x80)
+	{
+		*out++ = (unsigned char)(count | 0x80);
+		count >>= 7;
+	}
+	*out++ = (unsigned char)count;
+	return out;
+}
+
+/* Reads a count written by putCount(), moving past it. Returns FALSE if it runs off the end. */
+bool getCount(const unsigned char*& in, const unsigned char* end, uint64_t& count)
+{
+	count = 0;
+	for(int shift = 0; (in < end) && (shift < 64); shift += 7)
+	{
+		const unsigned char byte = *in++;
+		count |= (uint64_t)(byte & 0x7f) << shift;
+		if((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+/* Encodes words a group of GROUP_WORDS at a time, and returns the number of bytes written. With
+previous, the exclusive or of the two is encoded instead, without ever being stored. out is only
+ever grown, to the most the encoding can take, so it is reused without being cleared. */
+size_t encodeWords(const uint64_t* cells, const uint64_t* previous, const size_t count,
+				   std::vector<unsigned char>& out)
+{
+	const size_t groups = (count + GROUP_WORDS - 1) / GROUP_WORDS;
+	const size_t most = count * sizeof(uint64_t) + (groups + 1) * (sizeof(uint64_t) + 10);
+	if(out.size() < most)
+		out.resize(most);
+	unsigned char* const start = &out[0];
+	unsigned char* next = start;
+	uint64_t empty = 0;
+	for(size_t group = 0; group < groups; group++)
+	{
+		const size_t first = group * GROUP_WORDS;
+		const int length = (int)std::min(count - first, (size_t)GROUP_WORDS);
+		const uint64_t* now = cells + first;
+		const uint64_t* before = (previous != 0) ? previous + first : 0;
+
+		// The mask is found first, without branches, since most groups of a sparse board are empty
+		uint64_t mask = 0;
+		if(before != 0)
+			for(int k = 0; k < length; k++)
+				mask |= (uint64_t)(now[k] != before[k]) << k;
+		else
+			for(int k = 0; k < length; k++)
+				mask |= (uint64_t)(now[k] != 0) << k;
+		if(mask == 0)
+		{
+			empty++;
+			continue;
+		}
+
+		next = putCount(next, empty);
+		empty = 0;
+		memcpy(next, &mask, sizeof(mask));
+		next += sizeof(mask);
+		for(int k = 0; k < length; k++)
+		{
+			// Every word is stored, but only the nonzero ones are kept
+			const uint64_t word = (before != 0) ? (now[k] ^ before[k]) : now[k];
+			memcpy(next, &word, sizeof(word));
+			next += (word != 0) ? sizeof(word) : 0;
+		}
+	}
+	if(empty > 0)
+		next = putCount(next, empty);
+	return next - start;
+}
+
+/* Decodes words encoded by encodeWords() into cells: replacing them for a keyframe, combining them
+by exclusive or for a delta. Returns FALSE if the encoding does not cover exactly count words. */
+bool decodeWords(const unsigned char* in, const unsigned char* end, const bool delta,
+				 uint64_t* cells, const size_t count)
+{
+	const size_t groups = (count + GROUP_WORDS - 1) / GROUP_WORDS;
+	size_t group = 0;
+	while(in < end)
+	{
+		uint64_t empty;
+		if(!getCount(in, end, empty) || (empty > groups - group))
+			return false;
+		if(!delta)
+			memset(cells + group * GROUP_WORDS, 0,
+				   (std::min(count, (group + empty) * GROUP_WORDS) - group * GROUP_WORDS) *
+				   sizeof(uint64_t));
+		group += empty;
+		if(in == end)
+			break;
+
+		uint64_t mask;
+		if((group == groups) || ((size_t)(end - in) < sizeof(mask)))
+			return false;
+		memcpy(&mask, in, sizeof(mask));
+		in += sizeof(mask);
+		const size_t first = group * GROUP_WORDS;
+		const size_t length = std::min(count - first, (size_t)GROUP_WORDS);
+		if((mask == 0) || ((length < GROUP_WORDS) && ((mask >> length) != 0)) ||
+		   ((size_t)(end - in) < __builtin_popcountll(mask) * sizeof(uint64_t)))
+			return false;
+		uint64_t* words = cells + first;
+		if(!delta)
+			memset(words, 0, length * sizeof(uint64_t));
+		for(; mask != 0; mask &= mask - 1, in += sizeof(uint64_t))
+		{
+			uint64_t word;
+			memcpy(&word, in, sizeof(word));
+			words[__builtin_ctzll(mask)] ^= word;
+		}
+		group++;
+	}
+	return group == groups;
+}
+
+/* Copies the current generation of a world into packed rows, clearing the cells past the last
+column. */
+void packBoard(const World& world, std::vector<uint64_t>& cells)
+{
+	const BoardLayout layout = world.getLayout();
+	cells.resize((size_t)layout.rows * layout.words);
+	const uint64_t* board = world.getBoard();
+	for(int i = 0; i < layout.rows; i++)
+	{
+		uint64_t* row = &cells[(size_t)i * layout.words];
+		memcpy(row, board + (int64_t)i * layout.stride, layout.words * sizeof(uint64_t));
+		row[layout.words - 1] &= layout.lastMask;
+	}
+}
+
+}
+
+HistoryWriter::HistoryWriter(std::ostream& out, const int keyframeInterval, const int maxPending):
+	out(out), keyframeInterval((keyframeInterval > 0) ? keyframeInterval : 1),
+	maxPending((maxPending > 0) ? maxPending : 1), started(false), lastTurn(0), busy(false),
+	quit(false), failed(false), frames(0), bytes(0), sinceKeyframe(0), encodedBytes(0)
+{
+	memset(&header, 0, sizeof(header));
+	encoder = std::thread(&HistoryWriter::encode, this);
+}
+
+HistoryWriter::~HistoryWriter()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	ready.notify_one();
+	encoder.join();
+	out.flush();
+}
+
+bool HistoryWriter::record(const World& world)
+{
+	const BoardLayout layout = world.getLayout();
+	std::vector<uint64_t> cells;
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		if(failed)
+			return false;
+		if(!started)
+		{
+			KernelRule rule;
+			parseRule(world.getRule().c_str(), rule);
+			header.rows = layout.rows;
+			header.cols = layout.cols;
+			header.words = layout.words;
+			header.birth = rule.birth;
+			header.survival = rule.survival;
+			header.keyframeInterval = keyframeInterval;
+		}
+		else if((layout.rows != header.rows) || (layout.cols != header.cols) ||
+				(world.getTurn() <= lastTurn))
+			return false;
+		started = true;
+		lastTurn = world.getTurn();
+		while(pending.size() >= maxPending)
+			room.wait(guard);
+		if(!spare.empty())
+		{
+			cells.swap(spare.back());
+			spare.pop_back();
+		}
+	}
+
+	// The copy is the only work done on the caller's thread
+	packBoard(world, cells);
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending.push_back(Frame());
+		pending.back().turn = lastTurn;
+		pending.back().cells.swap(cells);
+	}
+	ready.notify_one();
+	return true;
+}
+
+bool HistoryWriter::flush()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while(busy || !pending.empty())
+		room.wait(guard);
+	if(!failed && !out.flush())
+		failed = true;
+	return !failed;
+}
+
+int64_t HistoryWriter::getFrames()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return frames;
+}
+
+uint64_t HistoryWriter::getBytes()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return bytes;
+}
+
+void HistoryWriter::encode()
+{
+	Frame frame;
+	for(;;)
+	{
+		bool stored;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while(!quit && pending.empty())
+				ready.wait(guard);
+			if(pending.empty())
+				return;
+			frame.turn = pending.front().turn;
+			frame.cells.swap(pending.front().cells);
+			pending.pop_front();
+			busy = true;
+			stored = !failed;
+		}
+		room.notify_all();
+
+		// Only this thread changes frames, so it can read it unlocked
+		const uint64_t headerBytes = (frames == 0) ? sizeof(HistoryHeader) : 0;
+		if(stored)
+			stored = write(frame);
+
+		// The generation becomes the one the next is compared with, and the oldest buffer is reused
+		frame.cells.swap(previous);
+		std::lock_guard<std::mutex> guard(lock);
+		if(stored)
+		{
+			frames++;
+			bytes += headerBytes + sizeof(HistoryRecord) + encodedBytes;
+		}
+		else
+			failed = true;
+		spare.push_back(std::vector<uint64_t>());
+		spare.back().swap(frame.cells);
+		busy = false;
+		room.notify_all();
+	}
+}
+
+bool HistoryWriter::write(const Frame& frame)
+{
+	if(frames == 0)
+	{
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = HISTORY_VERSION;
+		header.byteOrder = BYTE_ORDER_MARK;
+		header.headerBytes = sizeof(HistoryHeader);
+		out.write((const char*)&header, sizeof(header));
+	}
+
+	HistoryRecord record;
+	memset(&record, 0, sizeof(record));
+	const bool keyframe = previous.empty() || (sinceKeyframe + 1 >= keyframeInterval);
+	record.kind = keyframe ? HISTORY_KEYFRAME : HISTORY_DELTA;
+	record.turn = frame.turn;
+	encodedBytes = encodeWords(&frame.cells[0], keyframe ? 0 : &previous[0], frame.cells.size(),
+							   encoded);
+	record.bytes = encodedBytes;
+	sinceKeyframe = keyframe ? 0 : sinceKeyframe + 1;
+
+	out.write((const char*)&record, sizeof(record));
+	if(encodedBytes > 0)
+		out.write((const char*)&encoded[0], encodedBytes);
+	return (bool)out;
+}
+
+HistoryReader::HistoryReader(std::istream& in):
+	in(in), valid(false), end(sizeof(HistoryHeader)), position(NO_FRAME)
+{
+	memset(&header, 0, sizeof(header));
+	in.seekg(0);
+	valid = in.read((char*)&header, sizeof(header)) &&
+			(memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0) &&
+			(header.version == HISTORY_VERSION) && (header.byteOrder == BYTE_ORDER_MARK) &&
+			(header.headerBytes == sizeof(HistoryHeader)) && (header.rows > 0) &&
+			(header.cols > 0) && (header.words == (header.cols + 63) / 64);
+	if(valid)
+		refresh();
+}
+
+bool HistoryReader::isValid() const
+{
+	return valid;
+}
+
+size_t HistoryReader::refresh()
+{
+	if(!valid)
+		return 0;
+	in.clear();
+	in.seekg(0, std::ios::end);
+	const uint64_t length = (uint64_t)in.tellg();
+	for(;;)
+	{
+		HistoryRecord record;
+		if(length < end + sizeof(record))
+			break;
+		in.seekg((std::streamoff)end);
+		if(!in.read((char*)&record, sizeof(record)) || (length - end - sizeof(record) < record.bytes))
+			break;
+		if(((record.kind != HISTORY_KEYFRAME) && (record.kind != HISTORY_DELTA)) ||
+		   (index.empty() && (record.kind != HISTORY_KEYFRAME)) ||
+		   (!index.empty() && (record.turn <= index.back().turn)))
+			break;
+		Entry entry;
+		entry.turn = record.turn;
+		entry.kind = record.kind;
+		entry.offset = end + sizeof(record);
+		entry.bytes = record.bytes;
+		index.push_back(entry);
+		end = entry.offset + entry.bytes;
+	}
+	in.clear();
+	return index.size();
+}
+
+int HistoryReader::getRows() const
+{
+	return header.rows;
+}
+
+int HistoryReader::getCols() const
+{
+	return header.cols;
+}
+
+std::string HistoryReader::getRule() const
+{
+	KernelRule rule;
+	rule.birth = header.birth;
+	rule.survival = header.survival;
+	return formatRule(rule);
+}
+
+size_t HistoryReader::getFrames() const
+{
+	return index.size();
+}
+
+int64_t HistoryReader::getFirstTurn() const
+{
+	return index.empty() ? 0 : index.front().turn;
+}
+
+int64_t HistoryReader::getLastTurn() const
+{
+	return index.empty() ? 0 : index.back().turn;
+}
+
+bool HistoryReader::decode(const size_t entry)
+{
+	const Entry& frame = index[entry];
+	encoded.resize(frame.bytes);
+	in.clear();
+	in.seekg((std::streamoff)frame.offset);
+	if(frame.bytes > 0 && !in.read((char*)&encoded[0], frame.bytes))
+	{
+		in.clear();
+		return false;
+	}
+	cells.resize((size_t)header.rows * header.words);
+	const unsigned char* data = encoded.empty() ? 0 : &encoded[0];
+	return decodeWords(data, data + encoded.size(), frame.kind == HISTORY_DELTA, &cells[0],
+					   cells.size());
+}
+
+bool HistoryReader::seek(const int64_t turn)
+{
+	Entry key;
+	key.turn = turn;
+	const std::vector<Entry>::iterator after = std::upper_bound(index.begin(), index.end(), key,
+		[](const Entry& a, const Entry& b) { return a.turn < b.turn; });
+	if(after == index.begin())
+	{
+		position = NO_FRAME;
+		return false;
+	}
+	const size_t target = (size_t)(after - index.begin()) - 1;
+
+	// Replay from the keyframe before the target, or from the generation decoded if it is closer
+	size_t first = target;
+	while(index[first].kind != HISTORY_KEYFRAME)
+		first--;
+	if((position != NO_FRAME) && (position >= first) && (position <= target))
+		first = position + 1;
+	for(size_t i = first; i <= target; i++)
+	{
+		if(!decode(i))
+		{
+			position = NO_FRAME;
+			return false;
+		}
+	}
+	position = target;
+	return true;
+}
+
+bool HistoryReader::next()
+{
+	const size_t target = (position != NO_FRAME) ? position + 1 : 0;
+	if(target >= index.size())
+		return false;
+	if(!decode(target))
+	{
+		position = NO_FRAME;
+		return false;
+	}
+	position = target;
+	return true;
+}
+
+int64_t HistoryReader::getTurn() const
+{
+	return (position != NO_FRAME) ? index[position].turn : -1;
+}
+
+const uint64_t* HistoryReader::getCells() const
+{
+	return (position != NO_FRAME) ? &cells[0] : 0;
+}
+
+bool HistoryReader::restore(World& world) const
+{
+	if((position == NO_FRAME) || (world.getRows() != header.rows) ||
+	   (world.getCols() != header.cols))
+		return false;
+	world.setCells(&cells[0], index[position].turn);
+	return true;
+}
+
+HistoryRing::HistoryRing(const size_t maxBytes, const int keyframeInterval):
+	bytes(0), maxBytes(maxBytes), keyframeInterval((keyframeInterval > 0) ? keyframeInterval : 1),
+	sinceKeyframe(0), rows(0), cols(0), position(NO_FRAME)
+{
+}
+
+void HistoryRing::record(const World& world)
+{
+	if(!entries.empty() && ((world.getRows() != rows) || (world.getCols() != cols)))
+		clear();
+	rows = world.getRows();
+	cols = world.getCols();
+
+	// Recording over the past drops the generations after it
+	while(!entries.empty() && (entries.back().turn >= world.getTurn()))
+	{
+		bytes -= sizeof(Entry) + entries.back().data.size();
+		entries.pop_back();
+		latest.clear();
+	}
+	if(position >= entries.size())
+		position = NO_FRAME;
+
+	packBoard(world, current);
+	const bool keyframe = latest.empty() || (sinceKeyframe + 1 >= keyframeInterval);
+	const size_t size = encodeWords(&current[0], keyframe ? 0 : &latest[0], current.size(),
+									encoded);
+	sinceKeyframe = keyframe ? 0 : sinceKeyframe + 1;
+	entries.push_back(Entry());
+	entries.back().turn = world.getTurn();
+	entries.back().keyframe = keyframe;
+	entries.back().data.assign(encoded.begin(), encoded.begin() + size);
+	bytes += sizeof(Entry) + size;
+	latest.swap(current);
+	trim();
+}
+
+void HistoryRing::trim()
+{
+	while(bytes > maxBytes)
+	{
+		size_t next = 1;
+		while((next < entries.size()) && !entries[next].keyframe)
+			next++;
+		if(next == entries.size())
+		{
+			// Only the newest keyframe is left, so make another one to drop it by
+			sinceKeyframe = keyframeInterval;
+			return;
+		}
+		for(size_t i = 0; i < next; i++)
+		{
+			bytes -= sizeof(Entry) + entries.front().data.size();
+			entries.pop_front();
+		}
+		if(position != NO_FRAME)
+			position = (position >= next) ? position - next : NO_FRAME;
+	}
+}
+
+void HistoryRing::clear()
+{
+	entries.clear();
+	bytes = 0;
+	sinceKeyframe = 0;
+	latest.clear();
+	position = NO_FRAME;
+}
+
+size_t HistoryRing::getBytes() const
+{
+	return bytes;
+}
+
+size_t HistoryRing::getMaxBytes() const
+{
+	return maxBytes;
+}
+
+void HistoryRing::setMaxBytes(const size_t newMaxBytes)
+{
+	maxBytes = newMaxBytes;
+	trim();
+}
+
+size_t HistoryRing::getFrames() const
+{
+	return entries.size();
+}
+
+int64_t HistoryRing::getFirstTurn() const
+{
+	return entries.empty() ? 0 : entries.front().turn;
+}
+
+int64_t HistoryRing::getLastTurn() const
+{
+	return entries.empty() ? 0 : entries.back().turn;
+}
+
+bool HistoryRing::seek(const int64_t turn)
+{
+	Entry key;
+	key.turn = turn;
+	const std::deque<Entry>::iterator after = std::upper_bound(entries.begin(), entries.end(), key,
+		[](const Entry& a, const Entry& b) { return a.turn < b.turn; });
+	if(after == entries.begin())
+	{
+		position = NO_FRAME;
+		return false;
+	}
+	const size_t target = (size_t)(after - entries.begin()) - 1;
+
+	// Replay from the keyframe before the target, or from the generation decoded if it is closer
+	size_t first = target;
+	while(!entries[first].keyframe)
+		first--;
+	if((position != NO_FRAME) && (position >= first) && (position <= target))
+		first = position + 1;
+	cells.resize((size_t)rows * ((cols + 63) / 64));
+	for(size_t i = first; i <= target; i++)
+	{
+		const std::vector<unsigned char>& data = entries[i].data;
+		const unsigned char* begin = data.empty() ? 0 : &data[0];
+		decodeWords(begin, begin + data.size(), !entries[i].keyframe, &cells[0], cells.size());
+	}
+	position = target;
+	return true;
+}
+
+int64_t HistoryRing::getTurn() const
+{
+	return (position != NO_FRAME) ? entries[position].turn : -1;
+}
+
+bool HistoryRing::restore(World& world) const
+{
+	if((position == NO_FRAME) || (world.getRows() != rows) || (world.getCols() != cols))
+		return false;
+	world.setCells(&cells[0], entries[position].turn);
+	return true;
+}
+
+bool isHistory(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	char magic[sizeof(MAGIC)];
+	return file.read(magic, sizeof(magic)) && (memcmp(magic, MAGIC, sizeof(MAGIC)) == 0);
+}
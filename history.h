@@ -0,0 +1,779 @@
+/***************************************************************************************************
+ File Name:
+	history.h
+
+ Purpose:
+	Specification file for the generation history of the game engine. A history is an append-only
+	stream holding every recorded generation of a world: a keyframe of the whole board every so
+	often, and between keyframes only the cells that changed, as the exclusive or of consecutive
+	generations with its runs of unchanged words squeezed out. A generation is read back by decoding
+	the keyframe before it and replaying the changes up to it.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class World;
+
+/* The version of the history format written by this build. Histories of any other version are
+refused. */
+const uint32_t HISTORY_VERSION = 1;
+
+/***************************************************************************************************
+ Struct:
+	HistoryHeader
+
+ Description:
+	The header at the start of a history stream. Its fields are stored in the byte order of the
+	machine that wrote it; byteOrder tells whether the reader shares that order.
+		1.	magic - "LIFEHIST".
+		2.	version - HISTORY_VERSION.
+		3.	byteOrder - 0x01020304 as written.
+		4.	headerBytes - The size of this header.
+		5.	rows, cols and words - The size of the board, and the number of words of each row.
+		6.	birth and survival - The rule (see KernelRule).
+		7.	keyframeInterval - The number of generations from one keyframe to the next.
+***************************************************************************************************/
+
+struct HistoryHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t headerBytes;
+	int32_t rows;
+	int32_t cols;
+	int32_t words;
+	uint32_t birth;
+	uint32_t survival;
+	uint32_t keyframeInterval;
+	uint32_t reserved;
+};
+
+static_assert(sizeof(HistoryHeader) == 48, "the history header must not depend on the compiler");
+
+/***************************************************************************************************
+ Struct:
+	HistoryRecord
+
+ Description:
+	The header of every generation of a history stream, followed by its encoded cells.
+		1.	kind - HISTORY_KEYFRAME for a whole board, HISTORY_DELTA for the exclusive or of the
+			board with the generation recorded before it.
+		2.	turn - The turn number of the generation. Turns only increase along a stream, but need
+			not be consecutive: engines that leap over generations record the ones they land on.
+		3.	bytes - The size of the encoded cells that follow.
+
+ Remarks:
+	The cells are rows * words words, row after row, taken 64 words at a time. They are encoded as
+	a count of groups of words that are all zero, then, unless the count reaches the end, a group
+	that is not: a 64-bit mask with bit k set if word k of the group is nonzero, then the nonzero
+	words in order; and so on. Counts are written seven bits to a byte, lowest first, with the top
+	bit set on every byte but the last. An empty board or an unchanged generation takes a few
+	bytes, and a busy one at most a sixty-fourth more than the raw board.
+***************************************************************************************************/
+
+enum HistoryKind {HISTORY_KEYFRAME = 1, HISTORY_DELTA = 2};
+
+struct HistoryRecord
+{
+	uint32_t kind;
+	uint32_t reserved;
+	int64_t turn;
+	uint64_t bytes;
+};
+
+static_assert(sizeof(HistoryRecord) == 24, "the history record must not depend on the compiler");
+
+/***************************************************************************************************
+ Class:
+	HistoryWriter
+
+ Description:
+	Writes the generations of a world to a history stream. record() only copies the board and
+	queues it; a thread of the writer computes the changes, encodes them and writes them, so the
+	world keeps stepping while the previous generations are encoded. Attach a writer to a world
+	with World::setHistory() to record every generation the world is played through.
+
+ Remarks:
+	A writer only records boards of the size of the first one it is given. The stream belongs to
+	the writer's thread until flush() returns or the writer is destroyed.
+***************************************************************************************************/
+
+class HistoryWriter
+{
+
+private:
+
+	/* A generation waiting to be encoded: its turn and its packed rows. */
+	struct Frame
+	{
+		int64_t turn;
+		std::vector<uint64_t> cells;
+	};
+
+	/* The stream being written. */
+	std::ostream& out;
+
+	/* The number of generations from one keyframe to the next. */
+	int keyframeInterval;
+
+	/* The most generations that may wait to be encoded before record() waits for the encoder. */
+	size_t maxPending;
+
+	/* The size and rule of the recorded boards, set by the first call to record(). */
+	HistoryHeader header;
+	bool started;
+
+	/* The turn of the last generation queued. */
+	int64_t lastTurn;
+
+	/* Protects everything below and signals the encoder and the callers waiting for it. */
+	std::mutex lock;
+	std::condition_variable ready;
+	std::condition_variable room;
+
+	/* The generations waiting to be encoded, and buffers of encoded ones to reuse. */
+	std::deque<Frame> pending;
+	std::vector<std::vector<uint64_t> > spare;
+
+	/* Set while the encoder works on a generation it took off of the queue. */
+	bool busy;
+
+	/* Set when the writer is destroyed. */
+	bool quit;
+
+	/* Set once the stream has failed; nothing more is written to it. */
+	bool failed;
+
+	/* The number of generations and bytes written so far. */
+	int64_t frames;
+	uint64_t bytes;
+
+	/* The state of the encoder thread: the last generation it wrote, the number of generations
+	since the last keyframe, and the encoded cells of the current one and their size. */
+	std::vector<uint64_t> previous;
+	int sinceKeyframe;
+	std::vector<unsigned char> encoded;
+	size_t encodedBytes;
+
+	/* The encoder thread, started last so that everything above is ready for it. */
+	std::thread encoder;
+
+/***************************************************************************************************
+ Method:
+	void encode()
+
+ Scope:
+	Private.
+
+ Description:
+	The loop run by the encoder thread. Takes generations off of the queue and writes them until
+	the writer is destroyed and the queue is empty.
+***************************************************************************************************/
+
+	void encode();
+
+/***************************************************************************************************
+ Method:
+	bool write(const Frame& frame)
+
+ Scope:
+	Private.
+
+ Description:
+	Encodes a generation, as a keyframe or as the changes since the previous one, and writes it to
+	the stream, writing the header of the stream first if it is the first generation.
+
+ Parameters:
+	1.	const Frame& frame - The generation.
+
+ Returns:
+	This method returns TRUE if the generation was written and FALSE if the stream failed.
+***************************************************************************************************/
+
+	bool write(const Frame& frame);
+
+	/* Writers own their thread and cannot be copied. */
+	HistoryWriter(const HistoryWriter&);
+	HistoryWriter& operator=(const HistoryWriter&);
+
+public:
+
+/***************************************************************************************************
+ Method:
+	HistoryWriter(std::ostream& out, int keyframeInterval = 64, int maxPending = 4)
+
+ Scope:
+	Public.
+
+ Description:
+	A constructor. Starts the encoder thread. The header of the stream is written along with the
+	first generation.
+
+ Parameters:
+	1.	std::ostream& out - The stream to write, opened in binary mode. It must outlive the writer.
+	2.	int keyframeInterval - The number of generations from one keyframe to the next. Shorter
+		intervals make seeking faster and the stream larger. Values below 1 are taken as 1.
+	3.	int maxPending - The most generations that may wait to be encoded, each a copy of the
+		board. Values below 1 are taken as 1.
+***************************************************************************************************/
+
+	explicit HistoryWriter(std::ostream& out, int keyframeInterval = 64, int maxPending = 4);
+
+/***************************************************************************************************
+ Method:
+	~HistoryWriter()
+
+ Scope:
+	Public.
+
+ Description:
+	The destructor. Writes the generations still waiting, then stops and joins the encoder thread.
+	The stream is flushed but not closed.
+***************************************************************************************************/
+
+	~HistoryWriter();
+
+/***************************************************************************************************
+ Method:
+	bool record(const World& world)
+
+ Scope:
+	Public.
+
+ Description:
+	Queues the current generation of a world to be written. The board is copied, so the world may
+	be played on as soon as this returns. If the encoder is maxPending generations behind, waits
+	for it to catch up first.
+
+ Parameters:
+	1.	const World& world - The world to record.
+
+ Returns:
+	This method returns TRUE if the generation was queued, and FALSE if the board is not the size
+	of the first one recorded, if its turn is not past the last one recorded or if the stream has
+	failed.
+***************************************************************************************************/
+
+	bool record(const World& world);
+
+/***************************************************************************************************
+ Method:
+	bool flush()
+
+ Scope:
+	Public.
+
+ Description:
+	Waits until every queued generation is written, then flushes the stream, so that a reader sees
+	all of them.
+
+ Returns:
+	This method returns TRUE if every generation recorded so far was written.
+***************************************************************************************************/
+
+	bool flush();
+
+/***************************************************************************************************
+ Method:
+	int64_t getFrames() and uint64_t getBytes()
+
+ Scope:
+	Public.
+
+ Description:
+	Get the number of generations written so far, and the number of bytes they took, the header
+	of the stream included.
+***************************************************************************************************/
+
+	int64_t getFrames();
+	uint64_t getBytes();
+};
+
+/***************************************************************************************************
+ Class:
+	HistoryReader
+
+ Description:
+	Reads generations back from a history stream. The stream is indexed by skipping from record
+	header to record header, so opening it does not decode anything. seek() decodes the keyframe at
+	or before a turn and replays the changes recorded after it, or replays on from the generation
+	already decoded if no keyframe lies between.
+***************************************************************************************************/
+
+class HistoryReader
+{
+
+private:
+
+	/* Where a generation is in the stream. */
+	struct Entry
+	{
+		int64_t turn;
+		uint32_t kind;
+		uint64_t offset;
+		uint64_t bytes;
+	};
+
+	/* The stream being read. */
+	std::istream& in;
+
+	/* The header of the stream, and whether it is one this build can read. */
+	HistoryHeader header;
+	bool valid;
+
+	/* The generations indexed so far, and where the next record header is expected. */
+	std::vector<Entry> index;
+	uint64_t end;
+
+	/* The generation decoded last, as an index into index, and its packed rows. */
+	size_t position;
+	std::vector<uint64_t> cells;
+
+	/* The encoded cells of the generation being decoded. */
+	std::vector<unsigned char> encoded;
+
+/***************************************************************************************************
+ Method:
+	bool decode(size_t entry)
+
+ Scope:
+	Private.
+
+ Description:
+	Reads a generation from the stream and applies it to cells: a keyframe replaces them, a delta
+	is combined with them by exclusive or.
+
+ Parameters:
+	1.	size_t entry - The generation, as an index into index.
+
+ Returns:
+	This method returns TRUE if the generation was decoded and FALSE if the stream is damaged.
+***************************************************************************************************/
+
+	bool decode(size_t entry);
+
+	/* Readers hold a reference to their stream and cannot be copied. */
+	HistoryReader(const HistoryReader&);
+	HistoryReader& operator=(const HistoryReader&);
+
+public:
+
+/***************************************************************************************************
+ Method:
+	HistoryReader(std::istream& in)
+
+ Scope:
+	Public.
+
+ Description:
+	A constructor. Reads the header of the stream and indexes the generations written so far.
+
+ Parameters:
+	1.	std::istream& in - The stream to read, opened in binary mode. It must be seekable and
+		outlive the reader.
+***************************************************************************************************/
+
+	explicit HistoryReader(std::istream& in);
+
+/***************************************************************************************************
+ Method:
+	bool isValid() const
+
+ Scope:
+	Public.
+
+ Description:
+	Determines whether the stream is a history of the version and byte order of this build.
+
+ Returns:
+	This method returns TRUE if the stream can be read.
+***************************************************************************************************/
+
+	bool isValid() const;
+
+/***************************************************************************************************
+ Method:
+	size_t refresh()
+
+ Scope:
+	Public.
+
+ Description:
+	Indexes the generations appended to the stream since it was last indexed, so a history can be
+	read while it is still being written. A generation whose cells are not all written yet is left
+	for a later call.
+
+ Returns:
+	This method returns the number of generations indexed.
+***************************************************************************************************/
+
+	size_t refresh();
+
+/***************************************************************************************************
+ Method:
+	int getRows() const, int getCols() const and std::string getRule() const
+
+ Scope:
+	Public.
+
+ Description:
+	Get the size of the recorded board and the rule it was played with, as a rulestring.
+***************************************************************************************************/
+
+	int getRows() const;
+	int getCols() const;
+	std::string getRule() const;
+
+/***************************************************************************************************
+ Method:
+	size_t getFrames() const, int64_t getFirstTurn() const and int64_t getLastTurn() const
+
+ Scope:
+	Public.
+
+ Description:
+	Get the number of generations indexed, and the turns of the first and last of them (0 if there
+	are none).
+***************************************************************************************************/
+
+	size_t getFrames() const;
+	int64_t getFirstTurn() const;
+	int64_t getLastTurn() const;
+
+/***************************************************************************************************
+ Method:
+	bool seek(int64_t turn)
+
+ Scope:
+	Public.
+
+ Description:
+	Decodes the last generation recorded at or before a turn.
+
+ Parameters:
+	1.	int64_t turn - The turn to seek to.
+
+ Returns:
+	This method returns TRUE if a generation was decoded, and FALSE if the turn is before the first
+	one recorded or the stream is damaged, in which case no generation is decoded.
+***************************************************************************************************/
+
+	bool seek(int64_t turn);
+
+/***************************************************************************************************
+ Method:
+	bool next()
+
+ Scope:
+	Public.
+
+ Description:
+	Decodes the generation recorded after the one decoded, or the first one if none is.
+
+ Returns:
+	This method returns TRUE if a generation was decoded, and FALSE at the end of the index or if
+	the stream is damaged.
+***************************************************************************************************/
+
+	bool next();
+
+/***************************************************************************************************
+ Method:
+	int64_t getTurn() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the turn of the generation decoded.
+
+ Returns:
+	This method returns the turn number, or -1 if no generation is decoded.
+***************************************************************************************************/
+
+	int64_t getTurn() const;
+
+/***************************************************************************************************
+ Method:
+	const uint64_t* getCells() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the cells of the generation decoded: rows * words words, row after row, with bit col % 64
+	of word col / 64 of a row for each cell.
+
+ Returns:
+	This method returns the packed rows, or NULL if no generation is decoded.
+***************************************************************************************************/
+
+	const uint64_t* getCells() const;
+
+/***************************************************************************************************
+ Method:
+	bool restore(World& world) const
+
+ Scope:
+	Public.
+
+ Description:
+	Puts the generation decoded on the board of a world and sets its turn, with World::setCells().
+
+ Parameters:
+	1.	World& world - The world. It must be the size of the recorded board.
+
+ Returns:
+	This method returns TRUE if the world was restored and FALSE if no generation is decoded or
+	the world is of another size.
+***************************************************************************************************/
+
+	bool restore(World& world) const;
+};
+
+/***************************************************************************************************
+ Class:
+	HistoryRing
+
+ Description:
+	Keeps the recent generations of a world in memory, encoded like a history stream: a keyframe
+	every so often and the changes in between. Once the generations take more than a budget, the
+	oldest are dropped a keyframe at a time, so the ring always holds the latest stretch of the
+	game that fits. Seeking decodes at most one keyframe and the changes after it, so going back
+	any number of generations takes about as long as decoding keyframeInterval of them.
+
+ Remarks:
+	Recording a generation at or before the newest one held drops the generations from there on,
+	as an undo history does once an earlier state is changed. Besides the budget, the ring keeps
+	three decoded boards: the newest generation, the one seeked to and one being recorded.
+***************************************************************************************************/
+
+class HistoryRing
+{
+
+private:
+
+	/* A generation held by the ring: its turn, whether it is a keyframe, and its encoded cells. */
+	struct Entry
+	{
+		int64_t turn;
+		bool keyframe;
+		std::vector<unsigned char> data;
+	};
+
+	/* The generations held, oldest first. The first one is always a keyframe. */
+	std::deque<Entry> entries;
+
+	/* The size and budget of the encoded generations, in bytes. */
+	size_t bytes;
+	size_t maxBytes;
+
+	/* The number of generations from one keyframe to the next. */
+	int keyframeInterval;
+	int sinceKeyframe;
+
+	/* The size of the recorded boards. */
+	int rows;
+	int cols;
+
+	/* The newest generation, decoded, which the next one is compared with, and the buffer the
+	generation being recorded is copied into. */
+	std::vector<uint64_t> latest;
+	std::vector<uint64_t> current;
+
+	/* The generation seeked to, as an index into entries, and its cells. */
+	size_t position;
+	std::vector<uint64_t> cells;
+
+	/* Scratch space for encoding. */
+	std::vector<unsigned char> encoded;
+
+/***************************************************************************************************
+ Method:
+	void trim()
+
+ Scope:
+	Private.
+
+ Description:
+	Drops the oldest generations, from a keyframe up to the next one, until the ring fits its
+	budget or holds a single keyframe and the generations after it. In the latter case the next
+	generation recorded is made a keyframe, so that the ring can be trimmed again.
+***************************************************************************************************/
+
+	void trim();
+
+public:
+
+/***************************************************************************************************
+ Method:
+	HistoryRing(size_t maxBytes = 64 << 20, int keyframeInterval = 32)
+
+ Scope:
+	Public.
+
+ Description:
+	A constructor. The ring starts empty.
+
+ Parameters:
+	1.	size_t maxBytes - The budget for the encoded generations, in bytes.
+	2.	int keyframeInterval - The number of generations from one keyframe to the next. Values
+		below 1 are taken as 1.
+***************************************************************************************************/
+
+	explicit HistoryRing(size_t maxBytes = (size_t)64 << 20, int keyframeInterval = 32);
+
+/***************************************************************************************************
+ Method:
+	void record(const World& world)
+
+ Scope:
+	Public.
+
+ Description:
+	Encodes the current generation of a world into the ring. A board of another size than the
+	generations held empties the ring first.
+
+ Parameters:
+	1.	const World& world - The world to record.
+***************************************************************************************************/
+
+	void record(const World& world);
+
+/***************************************************************************************************
+ Method:
+	void clear()
+
+ Scope:
+	Public.
+
+ Description:
+	Drops every generation.
+***************************************************************************************************/
+
+	void clear();
+
+/***************************************************************************************************
+ Method:
+	size_t getBytes() const, size_t getMaxBytes() const and void setMaxBytes(size_t newMaxBytes)
+
+ Scope:
+	Public.
+
+ Description:
+	Get the size of the encoded generations and the budget, and set the budget, dropping old
+	generations right away if they no longer fit.
+***************************************************************************************************/
+
+	size_t getBytes() const;
+	size_t getMaxBytes() const;
+	void setMaxBytes(size_t newMaxBytes);
+
+/***************************************************************************************************
+ Method:
+	size_t getFrames() const, int64_t getFirstTurn() const and int64_t getLastTurn() const
+
+ Scope:
+	Public.
+
+ Description:
+	Get the number of generations held, and the turns of the oldest and newest of them (0 if there
+	are none).
+***************************************************************************************************/
+
+	size_t getFrames() const;
+	int64_t getFirstTurn() const;
+	int64_t getLastTurn() const;
+
+/***************************************************************************************************
+ Method:
+	bool seek(int64_t turn)
+
+ Scope:
+	Public.
+
+ Description:
+	Decodes the last generation held at or before a turn.
+
+ Parameters:
+	1.	int64_t turn - The turn to seek to.
+
+ Returns:
+	This method returns TRUE if a generation was decoded and FALSE if the turn is before the oldest
+	generation held.
+***************************************************************************************************/
+
+	bool seek(int64_t turn);
+
+/***************************************************************************************************
+ Method:
+	int64_t getTurn() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the turn of the generation seeked to.
+
+ Returns:
+	This method returns the turn number, or -1 if no generation is decoded.
+***************************************************************************************************/
+
+	int64_t getTurn() const;
+
+/***************************************************************************************************
+ Method:
+	bool restore(World& world) const
+
+ Scope:
+	Public.
+
+ Description:
+	Puts the generation seeked to on the board of a world and sets its turn, with
+	World::setCells().
+
+ Parameters:
+	1.	World& world - The world. It must be the size of the recorded boards.
+
+ Returns:
+	This method returns TRUE if the world was restored and FALSE if no generation is decoded or
+	the world is of another size.
+***************************************************************************************************/
+
+	bool restore(World& world) const;
+};
+
+/***************************************************************************************************
+ Function:
+	bool isHistory(const char* path)
+
+ Description:
+	Determines whether a file starts like a history, to tell histories apart from patterns and
+	snapshots.
+
+ Parameters:
+	1.	const char* path - The file to check.
+
+ Returns:
+	This function returns TRUE if the file starts with the history magic.
+***************************************************************************************************/
+
+bool isHistory(const char* path);
+
+#endif
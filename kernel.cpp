@@ -0,0 +1,319 @@
+/***************************************************************************************************
+ File Name:
+	kernel.cpp
+
+ Purpose:
+	Implementation file for the stepping kernels of the game. The kernels evolve a bit-packed board
+	by one generation, many cells at a time.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "kernel.h"
+
+namespace
+{
+
+/* Adds every cell of a word to its west and east neighbors. The two-bit sums are returned in lo
+(weight 1) and hi (weight 2). The neighbors of the edge bits come from the adjacent words. */
+inline void addRow(const uint64_t prev, const uint64_t cur, const uint64_t next, uint64_t& lo,
+				   uint64_t& hi)
+{
+	const uint64_t west = (cur << 1) | (prev >> 63);
+	const uint64_t east = (cur >> 1) | (next << 63);
+	const uint64_t odd = west ^ east;
+	lo = odd ^ cur;
+	hi = (west & east) | (odd & cur);
+}
+
+/* Adds the row sums of three consecutive rows into the 3x3 totals (0 to 9), returned bit-sliced in
+s0 (weight 1) to s3 (weight 8). */
+inline void addRows(const uint64_t lo0, const uint64_t hi0, const uint64_t lo1, const uint64_t hi1,
+					const uint64_t lo2, const uint64_t hi2, uint64_t& s0, uint64_t& s1,
+					uint64_t& s2, uint64_t& s3)
+{
+	const uint64_t loOdd = lo0 ^ lo1;
+	const uint64_t carry = (lo0 & lo1) | (loOdd & lo2);
+	s0 = loOdd ^ lo2;
+	const uint64_t hiOdd = hi0 ^ hi1;
+	const uint64_t hiSum = hiOdd ^ hi2;
+	const uint64_t hiCarry = (hi0 & hi1) | (hiOdd & hi2);
+	s1 = hiSum ^ carry;
+	const uint64_t fours = hiSum & carry;
+	s2 = hiCarry ^ fours;
+	s3 = hiCarry & fours;
+}
+
+/* Counts the living cells of a word. Written out rather than relying on a POPCNT instruction, which
+the portable kernel cannot assume. */
+inline uint64_t countBits(uint64_t word)
+{
+	word -= (word >> 1) & 0x5555555555555555ull;
+	word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+	word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return (word * 0x0101010101010101ull) >> 56;
+}
+
+/* Applies any compiled rule: a cell is alive next generation if its total matches an entry of the
+table that keeps a cell of its health alive. */
+struct TableRule
+{
+	const RuleTable& table;
+
+	explicit TableRule(const RuleTable& rule) : table(rule)
+	{
+	}
+
+	uint64_t apply(const uint64_t alive, const uint64_t s0, const uint64_t s1, const uint64_t s2,
+				   const uint64_t s3) const
+	{
+		uint64_t next = 0;
+		for(int i = 0; i < table.count; i++)
+		{
+			const uint64_t match = ~((s0 ^ table.plane[i][0]) | (s1 ^ table.plane[i][1]) |
+									 (s2 ^ table.plane[i][2]) | (s3 ^ table.plane[i][3]));
+			next |= match & ((alive & table.live[i]) | (~alive & table.dead[i]));
+		}
+		return next;
+	}
+};
+
+/* B3/S23 built in. Counting the cell itself, a cell is alive next generation if its total is 3, or
+if it is alive and its total is 4. */
+struct ConwayRule
+{
+	explicit ConwayRule(const RuleTable&)
+	{
+	}
+
+	uint64_t apply(const uint64_t alive, const uint64_t s0, const uint64_t s1, const uint64_t s2,
+				   const uint64_t s3) const
+	{
+		return ~s3 & ((s0 & s1 & ~s2) | (alive & ~s0 & ~s1 & s2));
+	}
+};
+
+/* The birth and survival sets of B3/S23. */
+const unsigned CONWAY_BIRTH = 1u << 3;
+const unsigned CONWAY_SURVIVAL = (1u << 2) | (1u << 3);
+
+template<class Rule>
+bool step(const BoardLayout& layout, const uint64_t* src, uint64_t* dst, const int rowBegin,
+		  const int rowEnd, const int wordBegin, const int wordEnd, const Rule& rule,
+		  TileCounts& counts)
+{
+	const int lastWord = (wordEnd == layout.words) ? wordEnd - 1 : -1;
+	uint64_t born = 0, died = 0;
+	for(int row = rowBegin; row < rowEnd; row++)
+	{
+		const uint64_t* up = src + (int64_t)(row - 1) * layout.stride;
+		const uint64_t* mid = up + layout.stride;
+		const uint64_t* down = mid + layout.stride;
+		uint64_t* out = dst + (int64_t)row * layout.stride;
+
+		// Slide a window of three words along the three rows; word -1 and word (words) are padding
+		uint64_t up0 = up[wordBegin - 1], up1 = up[wordBegin];
+		uint64_t mid0 = mid[wordBegin - 1], mid1 = mid[wordBegin];
+		uint64_t down0 = down[wordBegin - 1], down1 = down[wordBegin];
+		for(int w = wordBegin; w < wordEnd; w++)
+		{
+			const uint64_t up2 = up[w + 1], mid2 = mid[w + 1], down2 = down[w + 1];
+			uint64_t lo0, hi0, lo1, hi1, lo2, hi2, s0, s1, s2, s3;
+			addRow(up0, up1, up2, lo0, hi0);
+			addRow(mid0, mid1, mid2, lo1, hi1);
+			addRow(down0, down1, down2, lo2, hi2);
+			addRows(lo0, hi0, lo1, hi1, lo2, hi2, s0, s1, s2, s3);
+			uint64_t next = rule.apply(mid1, s0, s1, s2, s3);
+			if(w == lastWord)
+			{
+				// The bits past the last cell may hold a wrapped ghost cell (see edges.h)
+				next &= layout.lastMask;
+				mid1 &= layout.lastMask;
+			}
+			out[w] = next;
+			const uint64_t diff = next ^ mid1;
+			if(diff != 0)
+			{
+				born += countBits(diff & next);
+				died += countBits(diff & mid1);
+			}
+			up0 = up1; up1 = up2;
+			mid0 = mid1; mid1 = mid2;
+			down0 = down1; down1 = down2;
+		}
+	}
+	counts.born = born;
+	counts.died = died;
+	return (born | died) != 0;
+}
+
+}
+
+void compileRule(const KernelRule& rule, RuleTable& table)
+{
+	table.conway = (rule.birth == CONWAY_BIRTH) && (rule.survival == CONWAY_SURVIVAL);
+	table.count = 0;
+	for(int total = 0; total <= 9; total++)
+	{
+		const bool live = (total >= 1) && ((rule.survival >> (total - 1)) & 1);
+		const bool dead = (total <= 8) && ((rule.birth >> total) & 1);
+		if(!live && !dead)
+			continue;
+		const int i = table.count++;
+		for(int b = 0; b < 4; b++)
+			table.plane[i][b] = ((total >> b) & 1) ? ~(uint64_t)0 : 0;
+		table.live[i] = live ? ~(uint64_t)0 : 0;
+		table.dead[i] = dead ? ~(uint64_t)0 : 0;
+	}
+}
+
+bool parseRule(const char* text, KernelRule& rule)
+{
+	unsigned birth = 0, survival = 0;
+	if(((*text >= '0') && (*text <= '8')) || (*text == '/'))
+	{
+		// S/B notation: survival counts, a slash, then birth counts
+		unsigned* counts = &survival;
+		for(; *text != '\0'; text++)
+		{
+			if((*text == '/') && (counts == &survival))
+				counts = &birth;
+			else if((*text >= '0') && (*text <= '8'))
+				*counts |= 1u << (*text - '0');
+			else
+				return false;
+		}
+		if(counts != &birth)
+			return false;
+	}
+	else
+	{
+		// B/S notation: each set of counts follows its letter
+		unsigned* counts = 0;
+		bool seenBirth = false, seenSurvival = false, slash = false;
+		for(; *text != '\0'; text++)
+		{
+			const char c = *text;
+			if(((c == 'B') || (c == 'b')) && !seenBirth)
+			{
+				counts = &birth;
+				seenBirth = true;
+			}
+			else if(((c == 'S') || (c == 's')) && !seenSurvival)
+			{
+				counts = &survival;
+				seenSurvival = true;
+			}
+			else if((c == '/') && !slash && (counts != 0))
+				slash = true;
+			else if((c >= '0') && (c <= '8') && (counts != 0))
+				*counts |= 1u << (c - '0');
+			else
+				return false;
+		}
+		if(!seenBirth || !seenSurvival)
+			return false;
+	}
+	rule.birth = birth;
+	rule.survival = survival;
+	return true;
+}
+
+std::string formatRule(const KernelRule& rule)
+{
+	std::string text = "B";
+	for(int i = 0; i <= 8; i++)
+	{
+		if((rule.birth >> i) & 1)
+			text += (char)('0' + i);
+	}
+	text += "/S";
+	for(int i = 0; i <= 8; i++)
+	{
+		if((rule.survival >> i) & 1)
+			text += (char)('0' + i);
+	}
+	return text;
+}
+
+bool stepSwar(const BoardLayout& layout, const uint64_t* src, uint64_t* dst, const int rowBegin,
+			  const int rowEnd, const int wordBegin, const int wordEnd, const RuleTable& rule,
+			  TileCounts& counts)
+{
+	if(rule.conway)
+	{
+		return step(layout, src, dst, rowBegin, rowEnd, wordBegin, wordEnd, ConwayRule(rule),
+					counts);
+	}
+	return step(layout, src, dst, rowBegin, rowEnd, wordBegin, wordEnd, TableRule(rule), counts);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+namespace
+{
+
+/* Asks the CPU for the widest kernel it supports. */
+KernelType probeKernel()
+{
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		return KERNEL_AVX512;
+	if(__builtin_cpu_supports("avx2"))
+		return KERNEL_AVX2;
+	return KERNEL_SWAR;
+}
+
+}
+
+KernelType detectKernel()
+{
+	// Worlds may be built on many threads at once, so the CPU is probed in a thread-safe static
+	static const KernelType detected = probeKernel();
+	return detected;
+}
+
+bool stepKernel(const KernelType kernel, const BoardLayout& layout, const uint64_t* src,
+				uint64_t* dst, const int rowBegin, const int rowEnd, const int wordBegin,
+				const int wordEnd, const RuleTable& rule, TileCounts& counts)
+{
+	switch(kernel)
+	{
+		case KERNEL_AVX512:
+			return stepAvx512(layout, src, dst, rowBegin, rowEnd, wordBegin, wordEnd, rule, counts);
+		case KERNEL_AVX2:
+			return stepAvx2(layout, src, dst, rowBegin, rowEnd, wordBegin, wordEnd, rule, counts);
+		default:
+			return stepSwar(layout, src, dst, rowBegin, rowEnd, wordBegin, wordEnd, rule, counts);
+	}
+}
+
+#else
+
+KernelType detectKernel()
+{
+	return KERNEL_SWAR;
+}
+
+bool stepKernel(const KernelType, const BoardLayout& layout, const uint64_t* src, uint64_t* dst,
+				const int rowBegin, const int rowEnd, const int wordBegin, const int wordEnd,
+				const RuleTable& rule, TileCounts& counts)
+{
+	return stepSwar(layout, src, dst, rowBegin, rowEnd, wordBegin, wordEnd, rule, counts);
+}
+
+#endif
+
+const char* kernelName(const KernelType kernel)
+{
+	switch(kernel)
+	{
+		case KERNEL_AVX512:
+			return "avx512";
+		case KERNEL_AVX2:
+			return "avx2";
+		default:
+			return "swar";
+	}
+}
@@ -0,0 +1,252 @@
+/***************************************************************************************************
+ File Name:
+	kernel.h
+
+ Purpose:
+	Specification file for the stepping kernels of the game. The kernels evolve a bit-packed board
+	by one generation, many cells at a time. This file does not depend on the World class so the
+	kernels can be reused on any board with the same layout.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <stdint.h>
+#include <string>
+
+/***************************************************************************************************
+ Struct:
+	BoardLayout
+
+ Description:
+	Describes how a board is laid out in memory. Bit (col % 64) of word (row * stride + col / 64)
+	holds the cell at (row, col). The rows -1 and rows are dead halo rows, and every row is followed
+	by at least two dead words of padding, so the kernels can read one word and one row past every
+	edge of the board. A row is a whole number of cache lines (a multiple of 8 words) and the block
+	ends with one more cache line, so the vector kernels may read and write whole vectors past the
+	last word of a row; they only ever write dead cells there.
+***************************************************************************************************/
+
+struct BoardLayout
+{
+	/* The number of rows of the board. */
+	int rows;
+
+	/* The number of columns of the board. */
+	int cols;
+
+	/* The number of words holding the cells of one row. */
+	int words;
+
+	/* The distance in words between the starts of two consecutive rows. */
+	int stride;
+
+	/* The bits of the last word of a row that hold cells. The rest of the word must stay dead. */
+	uint64_t lastMask;
+};
+
+/***************************************************************************************************
+ Struct:
+	KernelRule
+
+ Description:
+	The rule of the game in the form the kernels understand. Bit n of birth is set if a dead cell
+	with n living neighbors comes alive, and bit n of survival is set if a living cell with n living
+	neighbors stays alive.
+***************************************************************************************************/
+
+struct KernelRule
+{
+	unsigned birth;
+	unsigned survival;
+};
+
+/***************************************************************************************************
+ Struct:
+	RuleTable
+
+ Description:
+	The rule expanded into whole-word masks, built once per call to play(). The kernels count the
+	full 3x3 block (the cell plus its 8 neighbors), so a total t means t - 1 neighbors for a living
+	cell and t neighbors for a dead one. Entry i describes one total that can leave a cell alive:
+	plane[i][b] is all ones if bit b of the total is set, and live[i] and dead[i] are all ones if a
+	living or dead cell with that total is alive in the next generation.
+
+	conway is TRUE if the rule is B3/S23. The kernels are templates on the rule, and pick an
+	instance with B3/S23 built in for it, which needs no table at all.
+***************************************************************************************************/
+
+struct RuleTable
+{
+	bool conway;
+	int count;
+	uint64_t plane[10][4];
+	uint64_t live[10];
+	uint64_t dead[10];
+};
+
+/***************************************************************************************************
+ Function:
+	void compileRule(const KernelRule& rule, RuleTable& table)
+
+ Description:
+	Expands a rule into the table used by the kernels.
+
+ Parameters:
+	1.	const KernelRule& rule - The rule of the game.
+	2.	RuleTable& table - The table that receives the expanded rule.
+***************************************************************************************************/
+
+void compileRule(const KernelRule& rule, RuleTable& table);
+
+/***************************************************************************************************
+ Function:
+	bool parseRule(const char* text, KernelRule& rule)
+
+ Description:
+	Reads a rule written as a rulestring. Both the B/S notation ("B3/S23", "B36/S23", case and
+	order free, the slash optional) and the older S/B notation ("23/3") are accepted.
+
+ Parameters:
+	1.	const char* text - The rulestring.
+	2.	KernelRule& rule - The rule read. Left unchanged if the rulestring is invalid.
+
+ Returns:
+	This function returns TRUE if the rulestring is valid.
+***************************************************************************************************/
+
+bool parseRule(const char* text, KernelRule& rule);
+
+/***************************************************************************************************
+ Function:
+	std::string formatRule(const KernelRule& rule)
+
+ Description:
+	Writes a rule as a rulestring in B/S notation, such as "B3/S23".
+
+ Parameters:
+	1.	const KernelRule& rule - The rule to write.
+
+ Returns:
+	This function returns the rulestring.
+***************************************************************************************************/
+
+std::string formatRule(const KernelRule& rule);
+
+/* The vectorized implementations of the kernel. Every one of them produces bit-identical results.
+	1.	KERNEL_SWAR - Portable C++, 64 cells per instruction.
+	2.	KERNEL_AVX2 - 256 cells per instruction.
+	3.	KERNEL_AVX512 - 512 cells per instruction. */
+enum KernelType {KERNEL_SWAR, KERNEL_AVX2, KERNEL_AVX512};
+
+/***************************************************************************************************
+ Struct:
+	TileCounts
+
+ Description:
+	The number of cells of a tile that were born and that died in one generation, as counted by the
+	kernels while they write the tile:
+		1.	born - The cells that are alive in the next generation but were dead.
+		2.	died - The cells that were alive but are dead in the next generation.
+***************************************************************************************************/
+
+struct TileCounts
+{
+	uint64_t born;
+	uint64_t died;
+};
+
+/***************************************************************************************************
+ Function:
+	bool stepSwar(const BoardLayout& layout, const uint64_t* src, uint64_t* dst, int rowBegin,
+				  int rowEnd, int wordBegin, int wordEnd, const RuleTable& rule,
+				  TileCounts& counts)
+
+ Description:
+	Computes the next generation of a tile of a board: the words [wordBegin, wordEnd) of the rows
+	[rowBegin, rowEnd). Works on 64 cells at a
+	time: the 3x3 neighborhood of every bit of a word is added up with bitwise full adders and the
+	rule is applied to the resulting bit-sliced counts. stepAvx2 and stepAvx512 do the same 256 and
+	512 cells at a time and may only be called if the CPU supports them.
+
+ Parameters:
+	1.	const BoardLayout& layout - The layout of both boards.
+	2.	const uint64_t* src - Row 0 of the current generation.
+	3.	uint64_t* dst - Row 0 of the board receiving the next generation.
+	4.	int rowBegin - The first row to compute.
+	5.	int rowEnd - One past the last row to compute.
+	6.	int wordBegin - The first word of each row to compute.
+	7.	int wordEnd - One past the last word of each row to compute.
+	8.	const RuleTable& rule - The compiled rule of the game.
+	9.	TileCounts& counts - Receives the number of cells of the tile that were born and died.
+
+ Returns:
+	This function returns TRUE if any cell of the tile changed and FALSE if the tile is the same in
+	both generations.
+
+ Remarks:
+	Only the tile of dst is written, so tiles can be computed concurrently. Padding bits are left
+	dead (the vector kernels write whole vectors of dead padding past the end of a row). Unless
+	wordEnd is the end of the row, wordBegin and wordEnd must be multiples of 8 so the vector
+	kernels never cross into another tile.
+***************************************************************************************************/
+
+bool stepSwar(const BoardLayout& layout, const uint64_t* src, uint64_t* dst, int rowBegin,
+			  int rowEnd, int wordBegin, int wordEnd, const RuleTable& rule, TileCounts& counts);
+bool stepAvx2(const BoardLayout& layout, const uint64_t* src, uint64_t* dst, int rowBegin,
+			  int rowEnd, int wordBegin, int wordEnd, const RuleTable& rule, TileCounts& counts);
+bool stepAvx512(const BoardLayout& layout, const uint64_t* src, uint64_t* dst, int rowBegin,
+				int rowEnd, int wordBegin, int wordEnd, const RuleTable& rule, TileCounts& counts);
+
+/***************************************************************************************************
+ Function:
+	KernelType detectKernel()
+
+ Description:
+	Determines the widest kernel the CPU supports. The CPU is only queried on the first call, and
+	any number of threads may call it at once.
+
+ Returns:
+	This function returns the widest supported kernel, or KERNEL_SWAR if the CPU has no supported
+	vector extensions.
+***************************************************************************************************/
+
+KernelType detectKernel();
+
+/***************************************************************************************************
+ Function:
+	const char* kernelName(KernelType kernel)
+
+ Description:
+	Names a kernel for logs and reports.
+
+ Parameters:
+	1.	KernelType kernel - The kernel to name.
+
+ Returns:
+	This function returns "swar", "avx2" or "avx512".
+***************************************************************************************************/
+
+const char* kernelName(KernelType kernel);
+
+/***************************************************************************************************
+ Function:
+	bool stepKernel(KernelType kernel, const BoardLayout& layout, const uint64_t* src,
+					uint64_t* dst, int rowBegin, int rowEnd, int wordBegin, int wordEnd,
+					const RuleTable& rule, TileCounts& counts)
+
+ Description:
+	Computes the next generation of a tile of a board with the specified kernel. See stepSwar().
+
+ Remarks:
+	The kernel must be supported by the CPU (no wider than detectKernel()).
+***************************************************************************************************/
+
+bool stepKernel(KernelType kernel, const BoardLayout& layout, const uint64_t* src, uint64_t* dst,
+				int rowBegin, int rowEnd, int wordBegin, int wordEnd, const RuleTable& rule,
+				TileCounts& counts);
+
+#endif
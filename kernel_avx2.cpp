@@ -0,0 +1,201 @@
+/***************************************************************************************************
+ File Name:
+	kernel_avx2.cpp
+
+ Purpose:
+	Implementation file for the AVX2 stepping kernel. Does the same work as stepSwar() on 4 words
+	(256 cells) per instruction. The file is compiled for AVX2 regardless of the compiler flags, so
+	the kernel may only be called once detectKernel() has found AVX2 support.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#pragma GCC target("avx2")
+
+#include <immintrin.h>
+#include "kernel.h"
+
+namespace
+{
+
+typedef __m256i Vec;
+
+/* The number of words in a vector. */
+const int VEC_WORDS = 4;
+
+inline Vec load(const uint64_t* p)
+{
+	return _mm256_load_si256((const Vec*)p);
+}
+
+inline Vec loadUnaligned(const uint64_t* p)
+{
+	return _mm256_loadu_si256((const Vec*)p);
+}
+
+/* Adds every cell of the vector starting at word w of a row to its west and east neighbors. See
+addRow() in kernel.cpp. */
+inline void addRow(const uint64_t* row, const int w, Vec& lo, Vec& hi)
+{
+	const Vec prev = loadUnaligned(row + w - 1);
+	const Vec cur = load(row + w);
+	const Vec next = loadUnaligned(row + w + 1);
+	const Vec west = _mm256_or_si256(_mm256_slli_epi64(cur, 1), _mm256_srli_epi64(prev, 63));
+	const Vec east = _mm256_or_si256(_mm256_srli_epi64(cur, 1), _mm256_slli_epi64(next, 63));
+	const Vec odd = _mm256_xor_si256(west, east);
+	lo = _mm256_xor_si256(odd, cur);
+	hi = _mm256_or_si256(_mm256_and_si256(west, east), _mm256_and_si256(odd, cur));
+}
+
+/* Counts the living cells of every word of a vector: each nibble is looked up in a table of bit
+counts, then the bytes of each word are summed. */
+inline Vec countBits(const Vec v)
+{
+	const Vec table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+									   0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const Vec nibble = _mm256_set1_epi8(0x0f);
+	const Vec low = _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble));
+	const Vec high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+	return _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256());
+}
+
+/* Applies any compiled rule, as TableRule in kernel.cpp. The table is broadcast once per tile. */
+struct TableRule
+{
+	int count;
+	Vec plane[10][4], live[10], dead[10];
+
+	explicit TableRule(const RuleTable& rule)
+	{
+		count = rule.count;
+		for(int i = 0; i < count; i++)
+		{
+			for(int b = 0; b < 4; b++)
+				plane[i][b] = _mm256_set1_epi64x((long long)rule.plane[i][b]);
+			live[i] = _mm256_set1_epi64x((long long)rule.live[i]);
+			dead[i] = _mm256_set1_epi64x((long long)rule.dead[i]);
+		}
+	}
+
+	Vec apply(const Vec alive, const Vec s0, const Vec s1, const Vec s2, const Vec s3) const
+	{
+		Vec next = _mm256_setzero_si256();
+		for(int i = 0; i < count; i++)
+		{
+			const Vec differ = _mm256_or_si256(
+				_mm256_or_si256(_mm256_xor_si256(s0, plane[i][0]), _mm256_xor_si256(s1, plane[i][1])),
+				_mm256_or_si256(_mm256_xor_si256(s2, plane[i][2]), _mm256_xor_si256(s3, plane[i][3])));
+			const Vec result = _mm256_or_si256(_mm256_and_si256(alive, live[i]),
+											   _mm256_andnot_si256(alive, dead[i]));
+			next = _mm256_or_si256(next, _mm256_andnot_si256(differ, result));
+		}
+		return next;
+	}
+};
+
+/* B3/S23 built in, as ConwayRule in kernel.cpp. */
+struct ConwayRule
+{
+	explicit ConwayRule(const RuleTable&)
+	{
+	}
+
+	Vec apply(const Vec alive, const Vec s0, const Vec s1, const Vec s2, const Vec s3) const
+	{
+		const Vec three = _mm256_andnot_si256(s2, _mm256_and_si256(s0, s1));
+		const Vec four = _mm256_and_si256(alive, _mm256_andnot_si256(_mm256_or_si256(s0, s1), s2));
+		return _mm256_andnot_si256(s3, _mm256_or_si256(three, four));
+	}
+};
+
+template<class Rule>
+bool step(const BoardLayout& layout, const uint64_t* src, uint64_t* dst, const int rowBegin,
+		  const int rowEnd, const int wordBegin, const int wordEnd, const Rule& rule,
+		  TileCounts& counts)
+{
+	// A tile at the end of a row may run whole vectors past its last word into the padding (see
+	// BoardLayout), so its last vector is masked to keep the padding dead. Every other tile is a
+	// whole number of vectors wide.
+	const bool lastTile = (wordEnd == layout.words);
+	const int vectorEnd = wordBegin +
+						  (wordEnd - wordBegin + VEC_WORDS - 1) / VEC_WORDS * VEC_WORDS;
+	uint64_t lanes[VEC_WORDS];
+	for(int i = 0; i < VEC_WORDS; i++)
+	{
+		const int w = vectorEnd - VEC_WORDS + i;
+		lanes[i] = (w < wordEnd - 1) ? ~(uint64_t)0 : (w == wordEnd - 1) ? layout.lastMask : 0;
+	}
+	const Vec tailMask = loadUnaligned(lanes);
+	Vec born = _mm256_setzero_si256(), died = _mm256_setzero_si256();
+	for(int row = rowBegin; row < rowEnd; row++)
+	{
+		const uint64_t* up = src + (int64_t)(row - 1) * layout.stride;
+		const uint64_t* mid = up + layout.stride;
+		const uint64_t* down = mid + layout.stride;
+		uint64_t* out = dst + (int64_t)row * layout.stride;
+		for(int w = wordBegin; w < vectorEnd; w += VEC_WORDS)
+		{
+			Vec lo0, hi0, lo1, hi1, lo2, hi2;
+			addRow(up, w, lo0, hi0);
+			addRow(mid, w, lo1, hi1);
+			addRow(down, w, lo2, hi2);
+
+			// Add the row sums into the bit-sliced 3x3 totals, as addRows() in kernel.cpp
+			const Vec loOdd = _mm256_xor_si256(lo0, lo1);
+			const Vec carry = _mm256_or_si256(_mm256_and_si256(lo0, lo1), _mm256_and_si256(loOdd, lo2));
+			const Vec s0 = _mm256_xor_si256(loOdd, lo2);
+			const Vec hiOdd = _mm256_xor_si256(hi0, hi1);
+			const Vec hiSum = _mm256_xor_si256(hiOdd, hi2);
+			const Vec hiCarry = _mm256_or_si256(_mm256_and_si256(hi0, hi1), _mm256_and_si256(hiOdd, hi2));
+			const Vec s1 = _mm256_xor_si256(hiSum, carry);
+			const Vec fours = _mm256_and_si256(hiSum, carry);
+			const Vec s2 = _mm256_xor_si256(hiCarry, fours);
+			const Vec s3 = _mm256_and_si256(hiCarry, fours);
+
+			Vec alive = load(mid + w);
+			Vec next = rule.apply(alive, s0, s1, s2, s3);
+			if(lastTile && (w + VEC_WORDS == vectorEnd))
+			{
+				// Past the last cell lie padding and possibly a wrapped ghost cell (see edges.h)
+				next = _mm256_and_si256(next, tailMask);
+				alive = _mm256_and_si256(alive, tailMask);
+			}
+			_mm256_store_si256((Vec*)(out + w), next);
+			const Vec diff = _mm256_xor_si256(next, alive);
+			if(!_mm256_testz_si256(diff, diff))
+			{
+				born = _mm256_add_epi64(born, countBits(_mm256_and_si256(diff, next)));
+				died = _mm256_add_epi64(died, countBits(_mm256_and_si256(diff, alive)));
+			}
+		}
+	}
+	uint64_t bornLanes[VEC_WORDS], diedLanes[VEC_WORDS];
+	_mm256_storeu_si256((Vec*)bornLanes, born);
+	_mm256_storeu_si256((Vec*)diedLanes, died);
+	counts.born = counts.died = 0;
+	for(int i = 0; i < VEC_WORDS; i++)
+	{
+		counts.born += bornLanes[i];
+		counts.died += diedLanes[i];
+	}
+	return (counts.born | counts.died) != 0;
+}
+
+}
+
+bool stepAvx2(const BoardLayout& layout, const uint64_t* src, uint64_t* dst, const int rowBegin,
+			  const int rowEnd, const int wordBegin, const int wordEnd, const RuleTable& rule,
+			  TileCounts& counts)
+{
+	if(rule.conway)
+	{
+		return step(layout, src, dst, rowBegin, rowEnd, wordBegin, wordEnd, ConwayRule(rule),
+					counts);
+	}
+	return step(layout, src, dst, rowBegin, rowEnd, wordBegin, wordEnd, TableRule(rule), counts);
+}
+
+#endif
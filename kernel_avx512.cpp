@@ -0,0 +1,199 @@
+/***************************************************************************************************
+ File Name:
+	kernel_avx512.cpp
+
+ Purpose:
+	Implementation file for the AVX-512 stepping kernel. Does the same work as stepSwar() on 8 words
+	(512 cells) per instruction. The file is compiled for AVX-512 (F and BW) regardless of the
+	compiler flags, so the kernel may only be called once detectKernel() has found AVX-512 support.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#pragma GCC target("avx512f,avx512bw")
+
+/* GCC 12 takes the undefined vectors the AVX-512 intrinsics pass as unused merge sources for
+uninitialized reads (a false positive), so the warning is off inside the header. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#include "kernel.h"
+
+namespace
+{
+
+typedef __m512i Vec;
+
+/* The number of words in a vector. */
+const int VEC_WORDS = 8;
+
+inline Vec load(const uint64_t* p)
+{
+	return _mm512_load_si512((const Vec*)p);
+}
+
+inline Vec loadUnaligned(const uint64_t* p)
+{
+	return _mm512_loadu_si512((const Vec*)p);
+}
+
+/* Adds every cell of the vector starting at word w of a row to its west and east neighbors. See
+addRow() in kernel.cpp. */
+inline void addRow(const uint64_t* row, const int w, Vec& lo, Vec& hi)
+{
+	const Vec prev = loadUnaligned(row + w - 1);
+	const Vec cur = load(row + w);
+	const Vec next = loadUnaligned(row + w + 1);
+	const Vec west = _mm512_or_si512(_mm512_slli_epi64(cur, 1), _mm512_srli_epi64(prev, 63));
+	const Vec east = _mm512_or_si512(_mm512_srli_epi64(cur, 1), _mm512_slli_epi64(next, 63));
+	const Vec odd = _mm512_xor_si512(west, east);
+	lo = _mm512_xor_si512(odd, cur);
+	hi = _mm512_or_si512(_mm512_and_si512(west, east), _mm512_and_si512(odd, cur));
+}
+
+/* Counts the living cells of every word of a vector: each nibble is looked up in a table of bit
+counts, then the bytes of each word are summed. */
+inline Vec countBits(const Vec v)
+{
+	const Vec table = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+														   1, 2, 2, 3, 2, 3, 3, 4));
+	const Vec nibble = _mm512_set1_epi8(0x0f);
+	const Vec low = _mm512_shuffle_epi8(table, _mm512_and_si512(v, nibble));
+	const Vec high = _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble));
+	return _mm512_sad_epu8(_mm512_add_epi8(low, high), _mm512_setzero_si512());
+}
+
+/* Applies any compiled rule, as TableRule in kernel.cpp. The table is broadcast once per tile. */
+struct TableRule
+{
+	int count;
+	Vec plane[10][4], live[10], dead[10];
+
+	explicit TableRule(const RuleTable& rule)
+	{
+		count = rule.count;
+		for(int i = 0; i < count; i++)
+		{
+			for(int b = 0; b < 4; b++)
+				plane[i][b] = _mm512_set1_epi64((long long)rule.plane[i][b]);
+			live[i] = _mm512_set1_epi64((long long)rule.live[i]);
+			dead[i] = _mm512_set1_epi64((long long)rule.dead[i]);
+		}
+	}
+
+	Vec apply(const Vec alive, const Vec s0, const Vec s1, const Vec s2, const Vec s3) const
+	{
+		Vec next = _mm512_setzero_si512();
+		for(int i = 0; i < count; i++)
+		{
+			const Vec differ = _mm512_or_si512(
+				_mm512_or_si512(_mm512_xor_si512(s0, plane[i][0]), _mm512_xor_si512(s1, plane[i][1])),
+				_mm512_or_si512(_mm512_xor_si512(s2, plane[i][2]), _mm512_xor_si512(s3, plane[i][3])));
+			const Vec result = _mm512_or_si512(_mm512_and_si512(alive, live[i]),
+											   _mm512_andnot_si512(alive, dead[i]));
+			next = _mm512_or_si512(next, _mm512_andnot_si512(differ, result));
+		}
+		return next;
+	}
+};
+
+/* B3/S23 built in, as ConwayRule in kernel.cpp. */
+struct ConwayRule
+{
+	explicit ConwayRule(const RuleTable&)
+	{
+	}
+
+	Vec apply(const Vec alive, const Vec s0, const Vec s1, const Vec s2, const Vec s3) const
+	{
+		const Vec three = _mm512_andnot_si512(s2, _mm512_and_si512(s0, s1));
+		const Vec four = _mm512_and_si512(alive, _mm512_andnot_si512(_mm512_or_si512(s0, s1), s2));
+		return _mm512_andnot_si512(s3, _mm512_or_si512(three, four));
+	}
+};
+
+template<class Rule>
+bool step(const BoardLayout& layout, const uint64_t* src, uint64_t* dst, const int rowBegin,
+		  const int rowEnd, const int wordBegin, const int wordEnd, const Rule& rule,
+		  TileCounts& counts)
+{
+	// A tile at the end of a row may run whole vectors past its last word into the padding (see
+	// BoardLayout), so its last vector is masked to keep the padding dead. Every other tile is a
+	// whole number of vectors wide.
+	const bool lastTile = (wordEnd == layout.words);
+	const int vectorEnd = wordBegin +
+						  (wordEnd - wordBegin + VEC_WORDS - 1) / VEC_WORDS * VEC_WORDS;
+	uint64_t lanes[VEC_WORDS];
+	for(int i = 0; i < VEC_WORDS; i++)
+	{
+		const int w = vectorEnd - VEC_WORDS + i;
+		lanes[i] = (w < wordEnd - 1) ? ~(uint64_t)0 : (w == wordEnd - 1) ? layout.lastMask : 0;
+	}
+	const Vec tailMask = loadUnaligned(lanes);
+	Vec born = _mm512_setzero_si512(), died = _mm512_setzero_si512();
+	for(int row = rowBegin; row < rowEnd; row++)
+	{
+		const uint64_t* up = src + (int64_t)(row - 1) * layout.stride;
+		const uint64_t* mid = up + layout.stride;
+		const uint64_t* down = mid + layout.stride;
+		uint64_t* out = dst + (int64_t)row * layout.stride;
+		for(int w = wordBegin; w < vectorEnd; w += VEC_WORDS)
+		{
+			Vec lo0, hi0, lo1, hi1, lo2, hi2;
+			addRow(up, w, lo0, hi0);
+			addRow(mid, w, lo1, hi1);
+			addRow(down, w, lo2, hi2);
+
+			// Add the row sums into the bit-sliced 3x3 totals, as addRows() in kernel.cpp
+			const Vec loOdd = _mm512_xor_si512(lo0, lo1);
+			const Vec carry = _mm512_or_si512(_mm512_and_si512(lo0, lo1), _mm512_and_si512(loOdd, lo2));
+			const Vec s0 = _mm512_xor_si512(loOdd, lo2);
+			const Vec hiOdd = _mm512_xor_si512(hi0, hi1);
+			const Vec hiSum = _mm512_xor_si512(hiOdd, hi2);
+			const Vec hiCarry = _mm512_or_si512(_mm512_and_si512(hi0, hi1), _mm512_and_si512(hiOdd, hi2));
+			const Vec s1 = _mm512_xor_si512(hiSum, carry);
+			const Vec fours = _mm512_and_si512(hiSum, carry);
+			const Vec s2 = _mm512_xor_si512(hiCarry, fours);
+			const Vec s3 = _mm512_and_si512(hiCarry, fours);
+
+			Vec alive = load(mid + w);
+			Vec next = rule.apply(alive, s0, s1, s2, s3);
+			if(lastTile && (w + VEC_WORDS == vectorEnd))
+			{
+				// Past the last cell lie padding and possibly a wrapped ghost cell (see edges.h)
+				next = _mm512_and_si512(next, tailMask);
+				alive = _mm512_and_si512(alive, tailMask);
+			}
+			_mm512_store_si512((Vec*)(out + w), next);
+			const Vec diff = _mm512_xor_si512(next, alive);
+			if(_mm512_test_epi64_mask(diff, diff) != 0)
+			{
+				born = _mm512_add_epi64(born, countBits(_mm512_and_si512(diff, next)));
+				died = _mm512_add_epi64(died, countBits(_mm512_and_si512(diff, alive)));
+			}
+		}
+	}
+	counts.born = (uint64_t)_mm512_reduce_add_epi64(born);
+	counts.died = (uint64_t)_mm512_reduce_add_epi64(died);
+	return (counts.born | counts.died) != 0;
+}
+
+}
+
+bool stepAvx512(const BoardLayout& layout, const uint64_t* src, uint64_t* dst, const int rowBegin,
+				const int rowEnd, const int wordBegin, const int wordEnd, const RuleTable& rule,
+				TileCounts& counts)
+{
+	if(rule.conway)
+	{
+		return step(layout, src, dst, rowBegin, rowEnd, wordBegin, wordEnd, ConwayRule(rule),
+					counts);
+	}
+	return step(layout, src, dst, rowBegin, rowEnd, wordBegin, wordEnd, TableRule(rule), counts);
+}
+
+#endif
@@ -0,0 +1,454 @@
+// Main file for the headless batch runner: evolves a pattern without any GUI and reports the speed.
+// Usage: lifebatch [options] input [output]
+// The summary goes to stderr so the final pattern can be written to stdout.
+#include "world.h"
+#include "patternio.h"
+#include "snapshot.h"
+#include "history.h"
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+// Exit codes, for batch schedulers.
+enum ExitCode
+{
+    EXIT_OK = 0,                // The run finished and the output was written.
+    EXIT_USAGE = 1,             // Bad command line.
+    EXIT_INPUT = 2,             // The input pattern could not be read or parsed.
+    EXIT_OUTPUT = 3,            // The output pattern could not be written.
+    EXIT_RUNTIME = 4            // The run itself failed (out of memory).
+};
+
+int Usage(const char *name);                                            // Prints the options and exit codes.
+bool ParseCount(const char *arg, long long &value);                     // Reads a non-negative count from the command line.
+bool ParseSize(const char *arg, int &rows, int &cols);                  // Reads a board size written ROWSxCOLS.
+bool EndsWith(const string &text, const string &suffix);                // Tells output formats apart by extension.
+int LoadPattern(const char *name, const char *input, int rows, int cols, const string &rule,
+                bool ruleGiven, World::Topology topology, World *&world);      // Creates the world from a pattern file.
+
+int main(int argc, char *argv[])
+{
+    long long generations = -1;                     // The number of generations to run (required).
+    int rows = 0, cols = 0;                         // The board size; 0 means the size of the pattern.
+    long long threads = 0;                          // The number of threads; 0 means every core.
+    string rule = "B3/S23";
+    bool ruleGiven = false;                         // Whether -r overrides the rule of the pattern.
+    World::Engine engine = World::SWAR;
+    World::Topology topology = World::BOUNDED;
+    bool topologyGiven = false;                     // Whether -t overrides the topology of a snapshot.
+    const char *checkpoint = NULL;                  // The snapshot file to checkpoint to, if any.
+    long long interval = 0;                         // The generations between checkpoints; 0 means only at the end.
+    const char *historyFile = NULL;                 // The history file to record every generation to, if any.
+    long long startTurn = -1;                       // The recorded turn to start a history input from; -1 is the last.
+    long long periodWindow = 0;                     // The generations to look back for a repeat; 0 means never stop early.
+    const char *input = NULL, *output = NULL;
+
+    for(int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if(arg == "-n" && hasValue)
+        {
+            if(!ParseCount(argv[++i], generations))
+                return Usage(argv[0]);
+        }
+        else if(arg == "-s" && hasValue)
+        {
+            if(!ParseSize(argv[++i], rows, cols))
+                return Usage(argv[0]);
+        }
+        else if(arg == "-r" && hasValue)
+        {
+            rule = argv[++i];
+            ruleGiven = true;
+        }
+        else if(arg == "-j" && hasValue)
+        {
+            if(!ParseCount(argv[++i], threads) || threads > INT_MAX)
+                return Usage(argv[0]);
+        }
+        else if(arg == "-e" && hasValue)
+        {
+            string name = argv[++i];
+            if(name == "scalar")
+                engine = World::SCALAR;
+            else if(name == "swar")
+                engine = World::SWAR;
+            else if(name == "hashlife")
+                engine = World::HASHLIFE;
+            else
+                return Usage(argv[0]);
+        }
+        else if(arg == "-c" && hasValue)
+            checkpoint = argv[++i];
+        else if(arg == "-k" && hasValue)
+        {
+            if(!ParseCount(argv[++i], interval))
+                return Usage(argv[0]);
+        }
+        else if(arg == "-p" && hasValue)
+        {
+            if(!ParseCount(argv[++i], periodWindow) || periodWindow > INT_MAX)
+                return Usage(argv[0]);
+        }
+        else if(arg == "-H" && hasValue)
+            historyFile = argv[++i];
+        else if(arg == "-g" && hasValue)
+        {
+            if(!ParseCount(argv[++i], startTurn))
+                return Usage(argv[0]);
+        }
+        else if(arg == "-t" && hasValue)
+        {
+            topologyGiven = true;
+            string name = argv[++i];
+            if(name == "bounded")
+                topology = World::BOUNDED;
+            else if(name == "unbounded")
+                topology = World::UNBOUNDED;
+            else if(name == "torus")
+                topology = World::TOROIDAL;
+            else if(name == "klein")
+                topology = World::KLEIN;
+            else
+                return Usage(argv[0]);
+        }
+        else if(arg.size() > 1 && arg[0] == '-')
+            return Usage(argv[0]);
+        else if(input == NULL)
+            input = argv[i];
+        else if(output == NULL)
+            output = argv[i];
+        else
+            return Usage(argv[0]);
+    }
+    if(input == NULL || generations < 0 || (interval > 0 && checkpoint == NULL))
+        return Usage(argv[0]);
+
+    World *world = NULL;
+    ofstream historyOut;
+    HistoryWriter *history = NULL;
+    double seconds = 0;
+    long long played = 0;                           // The generations actually run, fewer than asked if stopped early.
+    int checkpoints = 0;
+    try
+    {
+        if(strcmp(input, "-") != 0 && isHistory(input))
+        {
+            // Start from a recorded generation, the last one unless -g picks another.
+            ifstream in(input, ios::binary);
+            HistoryReader reader(in);
+            if(!reader.isValid() || reader.getFrames() == 0 ||
+               !reader.seek(startTurn < 0 ? reader.getLastTurn() : startTurn))
+            {
+                cerr << argv[0] << ": cannot read a generation from the history " << input << endl;
+                return EXIT_INPUT;
+            }
+            world = new World(reader.getRows(), reader.getCols());
+            reader.restore(*world);
+            if(!world->setRule(ruleGiven ? rule : reader.getRule()))
+            {
+                cerr << argv[0] << ": invalid rule " << (ruleGiven ? rule : reader.getRule()) << endl;
+                delete world;
+                return ruleGiven ? EXIT_USAGE : EXIT_INPUT;     // A bad -r, or a bad rule in the file.
+            }
+            world->setTopology(topology);
+        }
+        else if(strcmp(input, "-") != 0 && isSnapshot(input))
+        {
+            // Restart from a checkpoint. The rule and topology it saved hold unless given again.
+            world = new World(1, 1);
+            if(!world->loadSnapshot(input))
+            {
+                cerr << argv[0] << ": cannot restore the snapshot " << input << endl;
+                delete world;
+                return EXIT_INPUT;
+            }
+            if(ruleGiven && !world->setRule(rule))
+            {
+                cerr << argv[0] << ": invalid rule " << rule << endl;
+                delete world;
+                return EXIT_USAGE;
+            }
+            if(topologyGiven)
+                world->setTopology(topology);
+        }
+        else
+        {
+            int status = LoadPattern(argv[0], input, rows, cols, rule, ruleGiven, topology, world);
+            if(status != EXIT_OK)
+                return status;
+        }
+        // HashLife runs on the unbounded plane and cannot wrap the board, so it is refused rather
+        // than quietly stepping a torus or a Klein bottle some other way.
+        if(engine == World::HASHLIFE &&
+           (world->getTopology() == World::TOROIDAL || world->getTopology() == World::KLEIN))
+        {
+            cerr << argv[0] << ": the hashlife engine cannot run on a torus or a Klein bottle" << endl;
+            delete world;
+            return EXIT_USAGE;
+        }
+        world->setEngine(engine);
+        world->setThreads((int)threads);
+        if(periodWindow > 0)
+        {
+            world->setPeriodWindow((int)periodWindow);
+            world->setStopOnPeriod(true);
+        }
+        if(historyFile != NULL)
+        {
+            historyOut.open(historyFile, ios::binary | ios::trunc);
+            if(!historyOut)
+            {
+                cerr << argv[0] << ": cannot write the history " << historyFile << endl;
+                delete world;
+                return EXIT_OUTPUT;
+            }
+            history = new HistoryWriter(historyOut);
+            world->setHistory(history);
+        }
+
+        // Run in batches of one checkpoint interval, saving a snapshot after each batch.
+        long long done = 0;
+        do
+        {
+            long long batch = generations - done;
+            if(interval > 0 && interval < batch)
+                batch = interval;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            int64_t before = world->getTurn();
+            world->play(batch);
+            seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            played += world->getTurn() - before;
+            done += batch;
+            if(checkpoint != NULL)
+            {
+                if(!world->saveSnapshot(checkpoint))
+                {
+                    cerr << argv[0] << ": cannot write the checkpoint " << checkpoint << endl;
+                    delete world;
+                    delete history;
+                    return EXIT_OUTPUT;
+                }
+                checkpoints++;
+            }
+        }
+        while(done < generations && world->getPeriod() == 0);     // A board that repeats has nothing new to show.
+    }
+    catch(const bad_alloc &)
+    {
+        cerr << argv[0] << ": out of memory" << endl;
+        delete world;
+        delete history;
+        return EXIT_RUNTIME;
+    }
+
+    // Wait for the history to be written out.
+    if(history != NULL)
+    {
+        world->setHistory(NULL);
+        if(!history->flush())
+        {
+            cerr << argv[0] << ": cannot write the history " << historyFile << endl;
+            delete world;
+            delete history;
+            return EXIT_OUTPUT;
+        }
+    }
+
+    // Write the final state ("-" or nothing is stdout), as RLE for .rle files and plaintext otherwise.
+    bool saved;
+    if(output == NULL || strcmp(output, "-") == 0)
+        saved = writePlaintext(cout, *world);
+    else
+    {
+        ofstream out(output);
+        if(EndsWith(output, ".rle"))
+            saved = out && writeRle(out, *world);
+        else
+            saved = out && writePlaintext(out, *world);
+    }
+    if(!saved)
+    {
+        cerr << argv[0] << ": cannot write " << output << endl;
+        delete world;
+        delete history;
+        return EXIT_OUTPUT;
+    }
+
+    // The throughput summary.
+    double perSecond = (seconds > 0) ? played / seconds : 0;
+    cerr << "board:       " << world->getRows() << "x" << world->getCols() << endl;
+    cerr << "rule:        " << world->getRule() << endl;
+    cerr << "generations: " << played << endl;
+    cerr << "seconds:     " << seconds << endl;
+    cerr << "gens/sec:    " << perSecond << endl;
+    cerr << "cells/sec:   " << perSecond * (double)world->getSize() << endl;
+    cerr << "population:  " << world->getPopulation() << endl;
+    cerr << "born:        " << world->getBorn() << endl;
+    cerr << "died:        " << world->getDied() << endl;
+    if(checkpoint != NULL)
+        cerr << "checkpoints: " << checkpoints << endl;
+    if(periodWindow > 0)
+    {
+        if(world->getPeriod() == 1)
+            cerr << "period:      still life since turn " << world->getPeriodStart() << endl;
+        else if(world->getPeriod() > 1)
+            cerr << "period:      period " << world->getPeriod() << " oscillator since turn " << world->getPeriodStart() << endl;
+        else
+            cerr << "period:      none found" << endl;
+    }
+    if(history != NULL)
+        cerr << "history:     " << history->getFrames() << " generations, " << history->getBytes() << " bytes" << endl;
+    delete world;
+    delete history;
+    return EXIT_OK;
+}
+
+// Usage Function: Prints the command line options and the exit codes, and returns EXIT_USAGE.
+int Usage(const char *name)
+{
+    cerr << "Usage: " << name << " [options] input [output]" << endl;
+    cerr << "  input is an RLE, Life 1.06 or plaintext pattern; output is RLE if it ends in .rle and" << endl;
+    cerr << "  plaintext otherwise. \"-\" is stdin or stdout." << endl;
+    cerr << "  -n GENS       number of generations to run (required)" << endl;
+    cerr << "  -s ROWSxCOLS  board size (default: the size of the pattern, which is centered)" << endl;
+    cerr << "  -r RULE       rulestring such as B3/S23 or B36/S23 (default: the pattern's, or B3/S23)" << endl;
+    cerr << "  -e ENGINE     scalar, swar (default) or hashlife" << endl;
+    cerr << "  -t TOPOLOGY   bounded (default), unbounded, torus or klein" << endl;
+    cerr << "  -j THREADS    threads to step with (default 0, every core)" << endl;
+    cerr << "  -c FILE       write a snapshot of the world to FILE at the end and at every checkpoint" << endl;
+    cerr << "  -k GENS       generations between checkpoints (default 0, only at the end; needs -c)" << endl;
+    cerr << "  -p GENS       stop once the board repeats a generation of the last GENS (default 0, never)" << endl;
+    cerr << "  -H FILE       record every generation to the history FILE" << endl;
+    cerr << "  -g TURN       the recorded turn to start a history input from (default: the last)" << endl;
+    cerr << "  An input that is a snapshot restarts the run it was taken from, and one that is a history" << endl;
+    cerr << "  starts from one of its generations; -s is then ignored." << endl;
+    cerr << "Exit codes: 0 success, 1 bad usage or rule, 2 bad input, 3 output failed, 4 out of memory." << endl;
+    return EXIT_USAGE;
+}
+
+// ParseCount Function: Converts a command line argument to a non-negative count.
+bool ParseCount(const char *arg, long long &value)
+{
+    char *end = NULL;
+    long long parsed = strtoll(arg, &end, 10);
+    if(end == arg || *end != '\0' || parsed < 0)
+        return false;
+    value = parsed;
+    return true;
+}
+
+// ParseSize Function: Converts a command line argument written ROWSxCOLS to a board size.
+bool ParseSize(const char *arg, int &rows, int &cols)
+{
+    char *end = NULL;
+    long parsedRows = strtol(arg, &end, 10);
+    if(end == arg || *end != 'x' || parsedRows <= 0 || parsedRows > INT_MAX)
+        return false;
+    const char *second = end + 1;
+    long parsedCols = strtol(second, &end, 10);
+    if(end == second || *end != '\0' || parsedCols <= 0 || parsedCols > INT_MAX)
+        return false;
+    rows = (int)parsedRows;
+    cols = (int)parsedCols;
+    return true;
+}
+
+// LoadPattern Function: Creates the world from a pattern file and centers the pattern on it. The pattern
+// is read twice, once to measure it and once into the world, so files are streamed and never held in
+// memory. stdin cannot be read twice, so it is kept in memory ("-" is stdin). Returns an exit code.
+int LoadPattern(const char *name, const char *input, int rows, int cols, const string &rule, bool ruleGiven,
+                World::Topology topology, World *&world)
+{
+    ifstream file;
+    stringstream buffer;
+    istream *in = &file;
+    if(strcmp(input, "-") == 0)
+    {
+        buffer << cin.rdbuf();
+        in = &buffer;
+    }
+    else
+        file.open(input, ios::binary);
+    PatternHeader header;
+    PatternBounds bounds;
+    if(!*in || !readPattern(*in, bounds, header))
+    {
+        cerr << name << ": cannot read a pattern from " << input << endl;
+        return EXIT_INPUT;
+    }
+    string patternRule = rule;
+    if(!ruleGiven && !header.rule.empty())
+        patternRule = header.rule;
+
+    // The pattern is centered by the frame its file gives it, or else by its living cells
+    int64_t top = bounds.getTop(), left = bounds.getLeft();
+    int64_t height = bounds.getHeight(), width = bounds.getWidth();
+    if(header.sized && (bounds.isEmpty() || (top >= 0 && left >= 0 && top + height <= header.height &&
+                                             left + width <= header.width)))
+    {
+        top = left = 0;
+        height = header.height;
+        width = header.width;
+    }
+    if(rows == 0)
+    {
+        if(height > INT_MAX || width > INT_MAX)
+        {
+            cerr << name << ": the pattern is too large for a board; give its size with -s" << endl;
+            return EXIT_INPUT;
+        }
+        rows = (height == 0) ? 1 : (int)height;
+        cols = (width == 0) ? 1 : (int)width;
+    }
+    // The unbounded plane keeps the cells off of the board
+    if((height > rows || width > cols) && topology != World::UNBOUNDED)
+    {
+        cerr << name << ": the pattern does not fit on a " << rows << "x" << cols << " board" << endl;
+        return EXIT_INPUT;
+    }
+
+    world = new World(rows, cols);
+    if(!world->setRule(patternRule))
+    {
+        cerr << name << ": invalid rule " << patternRule << endl;
+        delete world;
+        world = NULL;
+        return ruleGiven ? EXIT_USAGE : EXIT_INPUT;     // A bad -r, or a bad rule in the file.
+    }
+    world->setTopology(topology);
+
+    // Center the pattern on the board.
+    in->clear();
+    in->seekg(0);
+    WorldSink sink(*world, (rows - height) / 2 - top, (cols - width) / 2 - left);
+    if(!readPattern(*in, sink, header))
+    {
+        cerr << name << ": cannot read a pattern from " << input << endl;
+        delete world;
+        world = NULL;
+        return EXIT_INPUT;
+    }
+    return EXIT_OK;
+}
+
+// EndsWith Function: Checks the end of a string, ignoring case.
+bool EndsWith(const string &text, const string &suffix)
+{
+    if(suffix.size() > text.size())
+        return false;
+    for(size_t i = 0; i < suffix.size(); i++)
+        if(tolower((unsigned char)text[text.size() - suffix.size() + i]) != tolower((unsigned char)suffix[i]))
+            return false;
+    return true;
+}
@@ -0,0 +1,31 @@
+# qmake project file for the headless batch runner. It does not use Qt, so it builds on machines
+# without a display: qmake -o Makefile.lifebatch lifebatch.pro && make -f Makefile.lifebatch
+TEMPLATE = app
+TARGET = lifebatch
+CONFIG -= qt
+CONFIG += console thread release
+QMAKE_CXXFLAGS += -std=c++11
+LIBS += -pthread
+
+HEADERS += edges.h \
+           hashlife.h \
+           history.h \
+           kernel.h \
+           patternio.h \
+           snapshot.h \
+           sparseplane.h \
+           threadpool.h \
+           world.h
+
+SOURCES += edges.cpp \
+           hashlife.cpp \
+           history.cpp \
+           kernel.cpp \
+           kernel_avx2.cpp \
+           kernel_avx512.cpp \
+           lifebatch.cpp \
+           patternio.cpp \
+           snapshot.cpp \
+           sparseplane.cpp \
+           threadpool.cpp \
+           world.cpp
@@ -0,0 +1,499 @@
+// Main file for the benchmark suite: times World::play() with every engine over a sweep of board
+// sizes, densities, patterns, rules and thread counts, times random soup censuses on ensembles of
+// small boards, and prints the results as JSON.
+// Usage: lifebench [-quick] [-max SIDE] [-o FILE]
+// Progress goes to stderr so the JSON can be redirected.
+#include "world.h"
+#include "ensemble.h"
+#include "patternio.h"
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+using namespace std;
+
+// What one benchmark run measures.
+struct Result
+{
+    string group;               // The sweep the run belongs to (size, pattern, rule or threads).
+    string engine;              // scalar, swar, hashlife, plane (SWAR on the unbounded plane) or ensemble.
+    string kernel;              // The SWAR kernel (swar, avx2 or avx512).
+    string pattern;             // "random" or the name of the pattern.
+    string rule;
+    int rows, cols;
+    double density;             // The fill density of random boards.
+    int threads;
+    long long generations;      // Summed over the boards of an ensemble.
+    long long boards;           // The soups played to the end by an ensemble, 1 for a world.
+    double seconds;
+    long long population;       // The living cells on the board after the run.
+    long maxRssKb;              // The memory high-water mark of the run, in kilobytes.
+};
+
+// A benchmark case: how to set up a world and how far to run it.
+struct Case
+{
+    string group, pattern, rule;
+    World::Engine engine;
+    World::Topology topology;
+    KernelType kernel;
+    int rows, cols, threads;
+    double density;
+    long long generations;      // For an ensemble, the turn at which unsettled soups stop.
+    long long boards;           // For an ensemble, the number of soups; 0 for a world.
+};
+
+// Well-known patterns in RLE form.
+const char *R_PENTOMINO = "x = 3, y = 3\nb2o$2o$bo!";
+const char *ACORN = "x = 7, y = 3\nbo$3bo$2o2b3o!";
+const char *GOSPER_GUN = "x = 36, y = 9\n"
+    "24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$2o8bo3bob2o4bobo$10bo5bo7bo$11bo3bo$12b2o!";
+
+int Usage(const char *name);                                    // Prints the options.
+const char *FindPattern(const string &name);                    // Looks up an embedded pattern.
+void FillRandom(World &world, double density, unsigned seed);   // Fills the board at random.
+void RandomCells(vector<uint64_t> &cells, int rows, int cols,   // Packs a random board.
+                 double density, unsigned seed);
+void PlacePattern(World &world, const char *pattern);           // Centers a pattern on the board.
+void ResetPeakMemory();                                         // Starts a new memory high-water mark.
+long PeakMemoryKb();                                            // Reads the memory high-water mark.
+bool Run(const Case &c, Result &result);                        // Runs one benchmark case.
+bool RunCensus(const Case &c, Result &result);                  // Runs one ensemble case.
+void WriteJson(ostream &out, const vector<Result> &results);    // Prints the results.
+string EngineName(const Case &c);                               // Names the engine of a case.
+
+int main(int argc, char *argv[])
+{
+    int maxSide = 65536;                // The largest board side of the size sweep.
+    double budget = 4e9;                // The cell updates each SWAR run aims for.
+    const char *output = NULL;
+    for(int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if(arg == "-quick")
+        {
+            maxSide = 2048;
+            budget = 2e8;
+        }
+        else if(arg == "-max" && i + 1 < argc)
+        {
+            char *end = NULL;
+            long parsed = strtol(argv[++i], &end, 10);
+            if(*end != '\0' || parsed < 32 || parsed > 65536)
+                return Usage(argv[0]);
+            maxSide = (int)parsed;
+        }
+        else if(arg == "-o" && i + 1 < argc)
+            output = argv[++i];
+        else
+            return Usage(argv[0]);
+    }
+
+    vector<Case> cases;
+    const KernelType widest = detectKernel();
+    const int hardware = (int)thread::hardware_concurrency() > 0 ? (int)thread::hardware_concurrency() : 1;
+    Case base;
+    base.pattern = "random";
+    base.rule = "B3/S23";
+    base.engine = World::SWAR;
+    base.topology = World::BOUNDED;
+    base.kernel = widest;
+    base.threads = 1;
+    base.density = 0.35;
+    base.boards = 0;
+
+    // Board sizes and densities, with every engine. The slow engines stop at smaller boards.
+    const int sides[] = {32, 256, 2048, 16384, 65536};
+    for(int s = 0; s < 5 && sides[s] <= maxSide; s++)
+    {
+        const int side = sides[s];
+        const double cells = (double)side * side;
+        const double densities[] = {0.1, 0.35, 0.5};
+        for(int d = 0; d < 3; d++)
+        {
+            Case c = base;
+            c.group = "size";
+            c.rows = c.cols = side;
+            c.density = densities[d];
+            for(int k = 0; k <= (int)widest; k++)
+            {
+                c.kernel = (KernelType)k;
+                c.generations = max(1LL, min(100000LL, (long long)(budget / cells)));
+                cases.push_back(c);
+            }
+            c.kernel = widest;
+            if(side <= 2048)
+            {
+                c.engine = World::SCALAR;
+                c.generations = max(1LL, (long long)(budget / 100 / cells));
+                cases.push_back(c);
+            }
+            if(side <= 256)
+            {
+                c.engine = World::HASHLIFE;
+                c.generations = 1024;
+                cases.push_back(c);
+            }
+        }
+    }
+
+    // Well-known patterns on a bounded board, on the unbounded plane and with HashLife.
+    const char *patterns[] = {"r-pentomino", "acorn", "gosper-gun"};
+    for(int p = 0; p < 3; p++)
+    {
+        Case c = base;
+        c.group = "pattern";
+        c.pattern = patterns[p];
+        c.rows = c.cols = 1024;
+        c.generations = 5000;
+        cases.push_back(c);
+        c.topology = World::UNBOUNDED;
+        cases.push_back(c);
+        c.engine = World::HASHLIFE;
+        c.generations = 1LL << 20;
+        cases.push_back(c);
+    }
+
+    // Rules, on a board big enough for the rule to matter more than the setup.
+    const char *rules[] = {"B3/S23", "B36/S23", "B3678/S34678", "B2/S"};
+    for(int r = 0; r < 4; r++)
+    {
+        Case c = base;
+        c.group = "rule";
+        c.rule = rules[r];
+        c.rows = c.cols = min(2048, maxSide);
+        c.generations = max(1LL, (long long)(budget / ((double)c.rows * c.cols)));
+        cases.push_back(c);
+    }
+
+    // Thread counts, doubling up to the number of hardware threads.
+    for(int t = 1; ; t *= 2)
+    {
+        Case c = base;
+        c.group = "threads";
+        c.threads = min(t, hardware);
+        c.rows = c.cols = min(8192, maxSide);
+        c.generations = max(1LL, (long long)(budget / ((double)c.rows * c.cols)));
+        cases.push_back(c);
+        if(t >= hardware)
+            break;
+    }
+
+    // Random soup censuses: many small boards, each played until it settles, on every thread.
+    const int censusSides[] = {64, 128, 256};
+    for(int s = 0; s < 3 && censusSides[s] <= maxSide; s++)
+    {
+        Case c = base;
+        c.group = "census";
+        c.rows = c.cols = censusSides[s];
+        c.threads = hardware;
+        c.generations = 10000;
+        c.boards = max(64LL, (long long)(budget / ((double)c.rows * c.cols) / 1000));
+        cases.push_back(c);
+    }
+
+    vector<Result> results;
+    for(size_t i = 0; i < cases.size(); i++)
+    {
+        const Case &c = cases[i];
+        cerr << "[" << i + 1 << "/" << cases.size() << "] " << c.group << " " << EngineName(c) << " "
+             << kernelName(c.kernel) << " " << c.pattern << " " << c.rule << " " << c.rows << "x"
+             << c.cols << " density " << c.density << " threads " << c.threads << endl;
+        Result result;
+        if(c.boards > 0 ? RunCensus(c, result) : Run(c, result))
+            results.push_back(result);
+        else
+            cerr << "  skipped: out of memory" << endl;
+    }
+
+    if(output == NULL)
+        WriteJson(cout, results);
+    else
+    {
+        ofstream file(output);
+        WriteJson(file, results);
+        if(!file)
+        {
+            cerr << argv[0] << ": cannot write " << output << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Usage Function: Prints the command line options and returns the exit code for bad usage.
+int Usage(const char *name)
+{
+    cerr << "Usage: " << name << " [-quick] [-max SIDE] [-o FILE]" << endl;
+    cerr << "  -quick     small boards and short runs, for a smoke test" << endl;
+    cerr << "  -max SIDE  largest board side of the size and census sweeps, 32 to 65536" << endl;
+    cerr << "             (default 65536)" << endl;
+    cerr << "  -o FILE    write the JSON to FILE instead of stdout" << endl;
+    return 1;
+}
+
+// FindPattern Function: Returns the embedded pattern of a name, or NULL.
+const char *FindPattern(const string &name)
+{
+    if(name == "r-pentomino")
+        return R_PENTOMINO;
+    if(name == "acorn")
+        return ACORN;
+    if(name == "gosper-gun")
+        return GOSPER_GUN;
+    return NULL;
+}
+
+// FillRandom Function: Brings each cell to life with the given probability. Uses a fixed seed so
+// every build sees the same boards.
+void FillRandom(World &world, double density, unsigned seed)
+{
+    uint64_t state = 0x9e3779b97f4a7c15ull ^ seed;
+    const uint64_t threshold = (uint64_t)(density * 4294967296.0);
+    for(int i = 0; i < world.getRows(); i++)
+        for(int j = 0; j < world.getCols(); j++)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            if((state >> 32) < threshold)
+                world.setHealth(i, j, true);
+        }
+}
+
+// RandomCells Function: Packs a random board for Ensemble::setCells(), with the same generator as
+// FillRandom.
+void RandomCells(vector<uint64_t> &cells, int rows, int cols, double density, unsigned seed)
+{
+    const int words = (cols + 63) / 64;
+    cells.assign((size_t)rows * words, 0);
+    uint64_t state = 0x9e3779b97f4a7c15ull ^ seed;
+    const uint64_t threshold = (uint64_t)(density * 4294967296.0);
+    for(int i = 0; i < rows; i++)
+        for(int j = 0; j < cols; j++)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            if((state >> 32) < threshold)
+                cells[(size_t)i * words + j / 64] |= (uint64_t)1 << (j % 64);
+        }
+}
+
+// PlacePattern Function: Centers an RLE pattern on the board.
+void PlacePattern(World &world, const char *pattern)
+{
+    istringstream in(pattern);
+    PatternHeader header;
+    PatternBounds bounds;
+    readPattern(in, bounds, header);
+    in.clear();
+    in.seekg(0);
+    WorldSink sink(world, (world.getRows() - bounds.getHeight()) / 2 - bounds.getTop(),
+                   (world.getCols() - bounds.getWidth()) / 2 - bounds.getLeft());
+    readPattern(in, sink, header);
+}
+
+// ResetPeakMemory Function: On Linux, resets the peak resident set size of the process so that
+// every run gets its own high-water mark. Elsewhere the mark only ever grows.
+void ResetPeakMemory()
+{
+    FILE *file = fopen("/proc/self/clear_refs", "w");
+    if(file != NULL)
+    {
+        fputs("5", file);
+        fclose(file);
+    }
+}
+
+// PeakMemoryKb Function: Returns the peak resident set size in kilobytes.
+long PeakMemoryKb()
+{
+    FILE *file = fopen("/proc/self/status", "r");
+    if(file != NULL)
+    {
+        char line[256];
+        long peak = -1;
+        while(fgets(line, sizeof(line), file) != NULL)
+            if(strncmp(line, "VmHWM:", 6) == 0)
+                peak = strtol(line + 6, NULL, 10);
+        fclose(file);
+        if(peak >= 0)
+            return peak;
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// EngineName Function: Names the engine of a case, counting SWAR on the unbounded plane apart.
+string EngineName(const Case &c)
+{
+    if(c.boards > 0)
+        return "ensemble";
+    if(c.engine == World::SCALAR)
+        return "scalar";
+    if(c.engine == World::HASHLIFE)
+        return "hashlife";
+    return (c.topology == World::UNBOUNDED) ? "plane" : "swar";
+}
+
+// Run Function: Sets up a world for a case, times the run and fills in the result. Returns false if
+// the board does not fit in memory.
+bool Run(const Case &c, Result &result)
+{
+    ResetPeakMemory();
+    World *world = NULL;
+    try
+    {
+        world = new World(c.rows, c.cols);
+        world->setRule(c.rule);
+        world->setEngine(c.engine);
+        world->setTopology(c.topology);
+        world->setKernel(c.kernel);
+        world->setThreads(c.threads);
+        if(c.pattern == "random")
+            FillRandom(*world, c.density, (unsigned)c.rows);
+        else
+            PlacePattern(*world, FindPattern(c.pattern));
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        world->play(c.generations);
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    catch(const bad_alloc &)
+    {
+        delete world;
+        return false;
+    }
+
+    result.group = c.group;
+    result.engine = EngineName(c);
+    result.kernel = kernelName(world->getKernel());
+    result.pattern = c.pattern;
+    result.rule = world->getRule();
+    result.rows = c.rows;
+    result.cols = c.cols;
+    result.density = (c.pattern == "random") ? c.density : 0;
+    result.threads = world->getThreads();
+    result.generations = c.generations;
+    result.boards = 1;
+    result.population = world->getPopulation();
+    result.maxRssKb = PeakMemoryKb();
+    delete world;
+    return true;
+}
+
+// RunCensus Function: Plays c.boards random soups on an ensemble of small boards, refilling each
+// board with the next soup as soon as the last one settles, and fills in the result. The population
+// is summed over the final boards of the soups. Returns false if the ensemble does not fit in memory.
+bool RunCensus(const Case &c, Result &result)
+{
+    ResetPeakMemory();
+    Ensemble *ensemble = NULL;
+    long long population = 0;
+    long long generations = 0;
+    try
+    {
+        // Enough boards to keep every thread busy until the last soups
+        const int numBoards = (int)min(c.boards, 256LL * c.threads);
+        ensemble = new Ensemble(numBoards, c.rows, c.cols);
+        ensemble->setRule(c.rule);
+        ensemble->setKernel(c.kernel);
+        ensemble->setThreads(c.threads);
+        vector<uint64_t> cells;
+        for(int b = 0; b < numBoards; b++)
+        {
+            RandomCells(cells, c.rows, c.cols, c.density, (unsigned)b);
+            ensemble->setCells(b, &cells[0]);
+        }
+
+        // The boards finish on the threads of the ensemble, so the soup counter is shared
+        mutex lock;
+        long long next = numBoards;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        generations = ensemble->play(c.generations, [&](int board)
+        {
+            long long soup;
+            {
+                lock_guard<mutex> guard(lock);
+                population += ensemble->getPopulation(board);
+                if(next >= c.boards)
+                    return false;
+                soup = next++;
+            }
+            vector<uint64_t> soupCells;
+            RandomCells(soupCells, c.rows, c.cols, c.density, (unsigned)soup);
+            ensemble->setCells(board, &soupCells[0]);
+            return true;
+        });
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    catch(const bad_alloc &)
+    {
+        delete ensemble;
+        return false;
+    }
+
+    result.group = c.group;
+    result.engine = EngineName(c);
+    result.kernel = kernelName(ensemble->getKernel());
+    result.pattern = c.pattern;
+    result.rule = ensemble->getRule();
+    result.rows = c.rows;
+    result.cols = c.cols;
+    result.density = c.density;
+    result.threads = ensemble->getThreads();
+    result.generations = generations;
+    result.boards = c.boards;
+    result.population = population;
+    result.maxRssKb = PeakMemoryKb();
+    delete ensemble;
+    return true;
+}
+
+// WriteJson Function: Prints the build and the results as a JSON document.
+void WriteJson(ostream &out, const vector<Result> &results)
+{
+    out << "{\n";
+    out << "  \"build\": {\"compiler\": \"" <<
+#ifdef __VERSION__
+        __VERSION__
+#else
+        "unknown"
+#endif
+        << "\", \"widest_kernel\": \"" << kernelName(detectKernel()) << "\", \"hardware_threads\": "
+        << thread::hardware_concurrency() << "},\n";
+    out << "  \"results\": [\n";
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        double cellsPerSec = (r.seconds > 0) ? (double)r.rows * r.cols * r.generations / r.seconds : 0;
+        double gensPerSec = (r.seconds > 0) ? r.generations / r.seconds : 0;
+        double boardsPerSec = (r.seconds > 0) ? r.boards / r.seconds : 0;
+        ostringstream line;
+        line.precision(6);
+        line << "    {\"group\": \"" << r.group << "\", \"engine\": \"" << r.engine
+             << "\", \"kernel\": \"" << r.kernel << "\", \"pattern\": \"" << r.pattern
+             << "\", \"rule\": \"" << r.rule << "\", \"rows\": " << r.rows << ", \"cols\": " << r.cols
+             << ", \"density\": " << r.density << ", \"threads\": " << r.threads
+             << ", \"generations\": " << r.generations << ", \"boards\": " << r.boards
+             << ", \"seconds\": " << r.seconds << ", \"gens_per_sec\": " << gensPerSec
+             << ", \"cells_per_sec\": " << cellsPerSec << ", \"boards_per_sec\": " << boardsPerSec
+             << ", \"population\": " << r.population << ", \"max_rss_kb\": " << r.maxRssKb << "}";
+        out << line.str() << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
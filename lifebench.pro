@@ -0,0 +1,33 @@
+# qmake project file for the benchmark suite. Like the batch runner it does not use Qt, so it builds on machines
+# without a display: qmake -o Makefile.lifebench lifebench.pro && make -f Makefile.lifebench
+TEMPLATE = app
+TARGET = lifebench
+CONFIG -= qt
+CONFIG += console thread release
+QMAKE_CXXFLAGS += -std=c++11
+LIBS += -pthread
+
+HEADERS += edges.h \
+           ensemble.h \
+           hashlife.h \
+           history.h \
+           kernel.h \
+           patternio.h \
+           snapshot.h \
+           sparseplane.h \
+           threadpool.h \
+           world.h
+
+SOURCES += edges.cpp \
+           ensemble.cpp \
+           hashlife.cpp \
+           history.cpp \
+           kernel.cpp \
+           kernel_avx2.cpp \
+           kernel_avx512.cpp \
+           lifebench.cpp \
+           patternio.cpp \
+           snapshot.cpp \
+           sparseplane.cpp \
+           threadpool.cpp \
+           world.cpp
@@ -1,31 +1,103 @@
 // Main file for running the grid window application.
 #include <QApplication>
 #include "gridwindow.h"
+#include "patternio.h"
 //#include "timerwindow.h"
 #include <stdexcept>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstdlib>
+#include <climits>
 
 void Welcome();             // Welcome Function - Prints upon running program; outputs program name, student name/id, class section.
 void Rules();               // Rules Function: Prints the rules for Conway's Game of Life.
+bool ParseSize(const char *arg, int &value);     // Reads a positive number (a board dimension or megabytes) from the command line.
+bool LoadPattern(World &world, const char *path);   // Centers a pattern file on the board.
 
 using namespace std;
 
 // A simple main method to create the window class  and then pop it up on the screen.
+// Usage: Game-of-Life [-m MEGABYTES] [rows cols] [pattern]  (defaults to an empty 25x35 board).
 int main(int argc, char *argv[])
 {
-	World * A = new World();						// Create the master world.
+    QApplication app(argc, argv);                   // Creates the overall windowed application (strips Qt's own arguments).
+    int rows = 25, cols = 35;                       // The number of rows & columns in the game grid.
+    const char *pattern = NULL;                     // An RLE, Life 1.06 or plaintext file to start from.
+    int rewindMegabytes = 64;                       // The memory kept for scrubbing back through the game.
+    int first = 1;                                  // The first argument after the options.
+    if(argc >= 3 && string(argv[1]) == "-m")
+    {
+        if(!ParseSize(argv[2], rewindMegabytes))
+        {
+            cerr << "Usage: " << argv[0] << " [-m MEGABYTES] [rows cols] [pattern]" << endl;
+            return 1;
+        }
+        first = 3;
+    }
+    int left = argc - first;                        // The number of positional arguments.
+    if(left == 2 || left == 3)
+    {
+        if(!ParseSize(argv[first], rows) || !ParseSize(argv[first + 1], cols))
+        {
+            cerr << "Usage: " << argv[0] << " [-m MEGABYTES] [rows cols] [pattern]" << endl;
+            return 1;
+        }
+        if(left == 3)
+            pattern = argv[first + 2];
+    }
+    else if(left == 1)
+        pattern = argv[first];
+    else if(left != 0)
+    {
+        cerr << "Usage: " << argv[0] << " [-m MEGABYTES] [rows cols] [pattern]" << endl;
+        return 1;
+    }
+    World * A = new World(rows, cols);              // Create the master world.
+    A->setThreads(0);                               // Step the world on every core.
+    if(pattern != NULL && !LoadPattern(*A, pattern))
+    {
+        cerr << argv[0] << ": cannot read a pattern from " << pattern << endl;
+        return 1;
+    }
     Welcome();                                      // Calls Welcome function to print student/assignment info.
     Rules();                                        // Prints Conway's Game Rules.
-    QApplication app(argc, argv);                   // Creates the overall windowed application.
-    int rows = 25, cols = 35;                       //The number of rows & columns in the game grid.
     GridWindow widget(NULL,rows,cols, A);           // Creates the actual window (for the grid).
-    widget.showFullScreen();                        			// Shows the window on the screen.
+    widget.setRewindBudget((size_t)rewindMegabytes << 20);      // Bounds the memory of the rewind history.
+    widget.show();                                  			// Shows the window on the screen; the board in it zooms and pans.
     return app.exec();                              // Goes into visual loop; starts executing GUI.
 }    
 
+// ParseSize Function: Converts a command line argument to a positive number, such as a board dimension.
+bool ParseSize(const char *arg, int &value)
+{
+    char *end = NULL;
+    long parsed = strtol(arg, &end, 10);
+    if(end == arg || *end != '\0' || parsed <= 0 || parsed > INT_MAX)
+        return false;
+    value = (int)parsed;
+    return true;
+}
+
+// LoadPattern Function: Reads a pattern file twice, once to measure it and once into the world, so that
+// it lands in the middle of the board. Cells that fall off of the board are dropped.
+bool LoadPattern(World &world, const char *path)
+{
+    ifstream file(path, ios::binary);
+    PatternHeader header;
+    PatternBounds bounds;
+    if(!file || !readPattern(file, bounds, header))
+        return false;
+    if(!header.rule.empty())
+        world.setRule(header.rule);
+    file.clear();
+    file.seekg(0);
+    WorldSink sink(world, (world.getRows() - bounds.getHeight()) / 2 - bounds.getTop(),
+                   (world.getCols() - bounds.getWidth()) / 2 - bounds.getLeft());
+    return readPattern(file, sink, header);
+}
+
 // Welcome Function: Prints my name/id, my class number, the assignment, and the program name.
 void Welcome()                                                              
 {
@@ -0,0 +1,550 @@
+/***************************************************************************************************
+ File Name:
+	patternio.cpp
+
+ Purpose:
+	Implementation file for reading and writing patterns. Parses RLE, Life 1.06 and plaintext
+	patterns one character at a time from a block buffer, and writes boards as RLE or plaintext.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "patternio.h"
+#include "world.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+
+/* The longest run an RLE count may ask for. Anything longer is taken as a corrupt file. */
+const int64_t MAX_COUNT = (int64_t)1 << 40;
+
+/* The longest line of an RLE body written by writeRle(). */
+const size_t RLE_LINE = 70;
+
+/* Reads a stream a block at a time, one character at a time. */
+class Reader
+{
+
+private:
+
+	std::istream& in;
+	char buffer[1 << 16];
+	size_t pos;
+	size_t end;
+
+	bool fill()
+	{
+		if(!in)
+			return false;
+		in.read(buffer, sizeof(buffer));
+		pos = 0;
+		end = (size_t)in.gcount();
+		return end > 0;
+	}
+
+public:
+
+	explicit Reader(std::istream& stream) : in(stream), pos(0), end(0)
+	{
+	}
+
+	/* Returns the next character without taking it, or EOF. */
+	int peek()
+	{
+		if((pos == end) && !fill())
+			return EOF;
+		return (unsigned char)buffer[pos];
+	}
+
+	/* Takes the next character, or returns EOF. */
+	int get()
+	{
+		const int c = peek();
+		if(c != EOF)
+			pos++;
+		return c;
+	}
+
+	/* Determines whether the next characters are prefix, which must fit in the first block. */
+	bool startsWith(const char* prefix)
+	{
+		const size_t length = strlen(prefix);
+		peek();
+		return (end - pos >= length) && (memcmp(buffer + pos, prefix, length) == 0);
+	}
+
+	/* Takes the rest of the line, line feed included. */
+	void skipLine()
+	{
+		for(int c = get(); (c != EOF) && (c != '\n'); c = get())
+		{
+		}
+	}
+
+	/* Takes the rest of the line into line, without the line ending. */
+	void readLine(std::string& line)
+	{
+		line.clear();
+		for(int c = get(); (c != EOF) && (c != '\n'); c = get())
+		{
+			if(c != '\r')
+				line += (char)c;
+		}
+	}
+};
+
+/* Collects consecutive cells of a row into one run before they are handed to the sink. */
+class RunBuilder
+{
+
+private:
+
+	PatternSink& sink;
+	int64_t row;
+	int64_t col;
+	int64_t length;
+
+public:
+
+	explicit RunBuilder(PatternSink& target) : sink(target), row(0), col(0), length(0)
+	{
+	}
+
+	void add(const int64_t cellRow, const int64_t cellCol, const int64_t count)
+	{
+		if((length != 0) && (cellRow == row) && (cellCol == col + length))
+		{
+			length += count;
+			return;
+		}
+		flush();
+		row = cellRow;
+		col = cellCol;
+		length = count;
+	}
+
+	void flush()
+	{
+		if(length != 0)
+			sink.setRun(row, col, length);
+		length = 0;
+	}
+};
+
+inline bool isSpace(const int c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+inline bool isDigit(const int c)
+{
+	return (c >= '0') && (c <= '9');
+}
+
+inline bool isLetter(const int c)
+{
+	return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'));
+}
+
+/* Removes the blanks around a piece of an RLE header. */
+std::string trim(const std::string& text)
+{
+	size_t first = 0, last = text.size();
+	while((first < last) && isSpace(text[first]))
+		first++;
+	while((last > first) && isSpace(text[last - 1]))
+		last--;
+	return text.substr(first, last - first);
+}
+
+/* Reads a size from an RLE header. */
+bool parseSize(const std::string& text, int64_t& value)
+{
+	char* end = 0;
+	const long long parsed = strtoll(text.c_str(), &end, 10);
+	if((end == text.c_str()) || (*end != '\0') || (parsed < 0) || (parsed > MAX_COUNT))
+		return false;
+	value = parsed;
+	return true;
+}
+
+/* Reads the "x = m, y = n, rule = r" header line of an RLE pattern. */
+bool parseRleHeader(const std::string& line, PatternHeader& header)
+{
+	bool seenWidth = false, seenHeight = false;
+	size_t start = 0;
+	while(start <= line.size())
+	{
+		size_t comma = line.find(',', start);
+		if(comma == std::string::npos)
+			comma = line.size();
+		const std::string piece = line.substr(start, comma - start);
+		start = comma + 1;
+
+		// Pieces with no key are the tail of a bounded grid suffix such as ":T100,200"
+		const size_t equals = piece.find('=');
+		if(equals == std::string::npos)
+			continue;
+		const std::string key = trim(piece.substr(0, equals));
+		const std::string value = trim(piece.substr(equals + 1));
+		if(key == "x")
+			seenWidth = parseSize(value, header.width);
+		else if(key == "y")
+			seenHeight = parseSize(value, header.height);
+		else if(key == "rule")
+			header.rule = value.substr(0, value.find(':'));
+	}
+	header.sized = seenWidth && seenHeight;
+	if(!header.sized)
+		header.width = header.height = 0;
+	return seenWidth && seenHeight;
+}
+
+bool readRle(Reader& reader, PatternSink& sink, PatternHeader& header)
+{
+	// Comment lines and blank lines may come before the header
+	for(int c = reader.peek(); ; c = reader.peek())
+	{
+		if(c == '#')
+			reader.skipLine();
+		else if(isSpace(c))
+			reader.get();
+		else
+			break;
+	}
+	if(reader.peek() == 'x')
+	{
+		std::string line;
+		reader.readLine(line);
+		if(!parseRleHeader(line, header))
+			return false;
+	}
+
+	RunBuilder runs(sink);
+	int64_t row = 0, col = 0, count = 0;
+	for(int c = reader.get(); ; c = reader.get())
+	{
+		if(isDigit(c))
+		{
+			count = count * 10 + (c - '0');
+			if(count > MAX_COUNT)
+				return false;
+			continue;
+		}
+		const int64_t n = (count == 0) ? 1 : count;
+		count = 0;
+		if((c == 'b') || (c == '.'))
+			col += n;
+		else if(c == '$')
+		{
+			row += n;
+			col = 0;
+		}
+		else if(isLetter(c))
+		{
+			// Every state but 'b' is alive, as in multi-state files read as two states
+			runs.add(row, col, n);
+			col += n;
+		}
+		else if((c == '!') || (c == EOF))
+		{
+			// Some files stop without the '!'
+			runs.flush();
+			return true;
+		}
+		else if(!isSpace(c))
+			return false;
+	}
+}
+
+/* Reads a signed number of a Life 1.06 line, after any blanks on the same line. */
+bool readNumber(Reader& reader, int64_t& value)
+{
+	while((reader.peek() == ' ') || (reader.peek() == '\t'))
+		reader.get();
+	const bool negative = (reader.peek() == '-');
+	if(negative || (reader.peek() == '+'))
+		reader.get();
+	if(!isDigit(reader.peek()))
+		return false;
+	value = 0;
+	while(isDigit(reader.peek()))
+	{
+		value = value * 10 + (reader.get() - '0');
+		if(value > MAX_COUNT)
+			return false;
+	}
+	if(negative)
+		value = -value;
+	return true;
+}
+
+bool readLife106(Reader& reader, PatternSink& sink)
+{
+	reader.skipLine();
+	RunBuilder runs(sink);
+	for(;;)
+	{
+		const int c = reader.peek();
+		if(c == EOF)
+			break;
+		if(isSpace(c))
+			reader.get();
+		else if(c == '#')
+			reader.skipLine();
+		else
+		{
+			int64_t x, y;
+			if(!readNumber(reader, x) || !readNumber(reader, y))
+				return false;
+			runs.add(y, x, 1);
+		}
+	}
+	runs.flush();
+	return true;
+}
+
+bool readPlaintext(Reader& reader, PatternSink& sink, PatternHeader& header)
+{
+	RunBuilder runs(sink);
+	int64_t row = 0, col = 0;
+	for(int c = reader.get(); c != EOF; c = reader.get())
+	{
+		if((col == 0) && (c == '!'))
+		{
+			reader.skipLine();
+			continue;
+		}
+		if(c == '\n')
+		{
+			row++;
+			col = 0;
+			continue;
+		}
+		if((c == 'O') || (c == '*'))
+			runs.add(row, col, 1);
+		else if(c == '\r')
+			continue;
+		else if(c != '.')
+			return false;
+		col++;
+		if(col > header.width)
+			header.width = col;
+	}
+	runs.flush();
+
+	// A last line with no line feed is a row too
+	header.height = (col > 0) ? row + 1 : row;
+	header.sized = true;
+	return true;
+}
+
+/* Finds the first cell at or after from with the given health in a row of words, or returns
+64 * words if there is none. */
+int findCell(const uint64_t* cells, const int words, const int from, const bool health)
+{
+	int w = from >> 6;
+	if(w >= words)
+		return 64 * words;
+	uint64_t bits = (health ? cells[w] : ~cells[w]) & (~(uint64_t)0 << (from & 63));
+	while(bits == 0)
+	{
+		if(++w == words)
+			return 64 * words;
+		bits = health ? cells[w] : ~cells[w];
+	}
+	return 64 * w + __builtin_ctzll(bits);
+}
+
+/* Appends an RLE token, starting a new line when the current one would get too long. */
+void putToken(std::string& body, size_t& lineStart, const int64_t count, const char tag)
+{
+	char token[32];
+	int length = 0;
+	if(count > 1)
+		length = snprintf(token, sizeof(token) - 1, "%lld", (long long)count);
+	token[length++] = tag;
+	if(body.size() + length - lineStart > RLE_LINE)
+	{
+		body += '\n';
+		lineStart = body.size();
+	}
+	body.append(token, length);
+}
+
+}
+
+PatternSink::~PatternSink()
+{
+}
+
+PatternBounds::PatternBounds()
+{
+	top = left = bottom = right = 0;
+	population = 0;
+}
+
+void PatternBounds::setRun(const int64_t row, const int64_t col, const int64_t length)
+{
+	if(population == 0)
+	{
+		top = bottom = row;
+		left = col;
+		right = col + length - 1;
+	}
+	else
+	{
+		if(row < top)
+			top = row;
+		if(row > bottom)
+			bottom = row;
+		if(col < left)
+			left = col;
+		if(col + length - 1 > right)
+			right = col + length - 1;
+	}
+	population += length;
+}
+
+bool PatternBounds::isEmpty() const
+{
+	return population == 0;
+}
+
+int64_t PatternBounds::getTop() const
+{
+	return top;
+}
+
+int64_t PatternBounds::getLeft() const
+{
+	return left;
+}
+
+int64_t PatternBounds::getHeight() const
+{
+	return (population == 0) ? 0 : bottom - top + 1;
+}
+
+int64_t PatternBounds::getWidth() const
+{
+	return (population == 0) ? 0 : right - left + 1;
+}
+
+int64_t PatternBounds::getPopulation() const
+{
+	return population;
+}
+
+WorldSink::WorldSink(World& target, const int64_t numRowOffset, const int64_t numColOffset)
+	: world(target)
+{
+	rowOffset = numRowOffset;
+	colOffset = numColOffset;
+}
+
+void WorldSink::setRun(const int64_t row, const int64_t col, const int64_t length)
+{
+	world.setRun(row + rowOffset, col + colOffset, length);
+}
+
+bool readPattern(std::istream& in, PatternSink& sink, PatternHeader& header)
+{
+	header.format = PATTERN_UNKNOWN;
+	header.sized = false;
+	header.width = header.height = 0;
+	header.rule.clear();
+
+	// The first character tells the formats apart, but for the Life 1.06 header line
+	Reader reader(in);
+	const int c = reader.peek();
+	if(reader.startsWith("#Life 1.06"))
+	{
+		header.format = PATTERN_LIFE106;
+		return readLife106(reader, sink);
+	}
+	if((c == '#') || (c == 'x'))
+	{
+		if(reader.startsWith("#Life"))
+			return false;
+		header.format = PATTERN_RLE;
+		return readRle(reader, sink, header);
+	}
+	if((c == EOF) || (c == '!') || (c == '.') || (c == 'O') || (c == '*'))
+	{
+		header.format = PATTERN_PLAINTEXT;
+		return readPlaintext(reader, sink, header);
+	}
+	return false;
+}
+
+bool writeRle(std::ostream& out, const World& world)
+{
+	const BoardLayout layout = world.getLayout();
+	const uint64_t* board = world.getBoard();
+	out << "#C Generation " << world.getTurn() << "\n";
+	out << "x = " << layout.cols << ", y = " << layout.rows << ", rule = " << world.getRule()
+		<< "\n";
+
+	// Rows are only ended once a later row has cells, so trailing blank rows are left out
+	std::string body;
+	size_t lineStart = 0;
+	int lastRow = 0;
+	for(int row = 0; row < layout.rows; row++)
+	{
+		const uint64_t* cells = board + (int64_t)row * layout.stride;
+		int col = findCell(cells, layout.words, 0, true);
+		if(col >= layout.cols)
+			continue;
+		if(row > lastRow)
+			putToken(body, lineStart, row - lastRow, '$');
+		lastRow = row;
+		int end = 0;
+		while(col < layout.cols)
+		{
+			if(col > end)
+				putToken(body, lineStart, col - end, 'b');
+			end = findCell(cells, layout.words, col, false);
+			putToken(body, lineStart, end - col, 'o');
+			col = findCell(cells, layout.words, end, true);
+
+			// Hand the body over now and then so it never holds a whole large board
+			if(lineStart > (1 << 16))
+			{
+				out.write(body.data(), lineStart);
+				body.erase(0, lineStart);
+				lineStart = 0;
+			}
+		}
+	}
+	putToken(body, lineStart, 1, '!');
+	out << body << "\n";
+	out.flush();
+	return (bool)out;
+}
+
+bool writePlaintext(std::ostream& out, const World& world)
+{
+	const BoardLayout layout = world.getLayout();
+	const uint64_t* board = world.getBoard();
+	out << "!Generation " << world.getTurn() << ", rule " << world.getRule() << "\n";
+	std::string line;
+	for(int row = 0; row < layout.rows; row++)
+	{
+		const uint64_t* cells = board + (int64_t)row * layout.stride;
+		line.assign(layout.cols, '.');
+		for(int col = findCell(cells, layout.words, 0, true); col < layout.cols; )
+		{
+			const int end = findCell(cells, layout.words, col, false);
+			line.replace(col, end - col, end - col, 'O');
+			col = findCell(cells, layout.words, end, true);
+		}
+		out << line << "\n";
+	}
+	out.flush();
+	return (bool)out;
+}
@@ -0,0 +1,268 @@
+/***************************************************************************************************
+ File Name:
+	patternio.h
+
+ Purpose:
+	Specification file for reading and writing patterns. Reads the RLE, Life 1.06 and plaintext
+	formats as a stream, handing the living cells over a run at a time, so a pattern never has to
+	be held in memory cell by cell. Writes the board of a world as RLE or plaintext.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef PATTERNIO_H
+#define PATTERNIO_H
+
+#include <stdint.h>
+#include <istream>
+#include <ostream>
+#include <string>
+
+class World;
+
+/***************************************************************************************************
+ Enum:
+	PatternFormat
+
+ Description:
+	The pattern formats that can be read:
+		1.	PATTERN_RLE - Run length encoded, as used by most pattern collections.
+		2.	PATTERN_LIFE106 - Life 1.06: one "x y" pair per living cell.
+		3.	PATTERN_PLAINTEXT - Plaintext (.cells): one line per row, 'O' for living cells.
+***************************************************************************************************/
+
+enum PatternFormat {PATTERN_UNKNOWN, PATTERN_RLE, PATTERN_LIFE106, PATTERN_PLAINTEXT};
+
+/***************************************************************************************************
+ Struct:
+	PatternHeader
+
+ Description:
+	What a pattern file says about itself besides its cells:
+		1.	format - The format the file was read as.
+		2.	sized - TRUE if the file gives the size of the pattern: the x and y of an RLE header, or
+			the number of lines and the longest line of a plaintext file.
+		3.	width and height - The size of the pattern if sized is TRUE, and 0 otherwise.
+		4.	rule - The rulestring given by the file, or an empty string if it gives none.
+***************************************************************************************************/
+
+struct PatternHeader
+{
+	PatternFormat format;
+	bool sized;
+	int64_t width;
+	int64_t height;
+	std::string rule;
+};
+
+/***************************************************************************************************
+ Class:
+	PatternSink
+
+ Description:
+	Receives the living cells of a pattern as it is read. Every cell is handed over exactly once,
+	as part of a horizontal run of living cells; runs are not sorted.
+***************************************************************************************************/
+
+class PatternSink
+{
+
+public:
+
+	virtual ~PatternSink();
+
+/***************************************************************************************************
+ Method:
+	virtual void setRun(int64_t row, int64_t col, int64_t length) = 0
+
+ Scope:
+	Public.
+
+ Description:
+	Receives a run of living cells: the cells (row, col) to (row, col + length - 1). The top left
+	corner of an RLE or plaintext pattern is (0, 0), while Life 1.06 coordinates are kept as they
+	are in the file and may be negative.
+
+ Parameters:
+	1.	int64_t row - The row of the run.
+	2.	int64_t col - The first column of the run.
+	3.	int64_t length - The number of cells of the run (at least 1).
+***************************************************************************************************/
+
+	virtual void setRun(int64_t row, int64_t col, int64_t length) = 0;
+};
+
+/***************************************************************************************************
+ Class:
+	PatternBounds
+
+ Description:
+	A sink that only measures a pattern: its bounding box and its population. Reading a pattern into
+	it first gives the size of a board the pattern fits on without storing a single cell.
+***************************************************************************************************/
+
+class PatternBounds : public PatternSink
+{
+
+private:
+
+	/* The rows and columns of the outermost living cells, valid once population is nonzero. */
+	int64_t top;
+	int64_t left;
+	int64_t bottom;
+	int64_t right;
+
+	/* The number of living cells received. */
+	int64_t population;
+
+public:
+
+	PatternBounds();
+	virtual void setRun(int64_t row, int64_t col, int64_t length);
+
+/***************************************************************************************************
+ Method:
+	bool isEmpty() const
+
+ Scope:
+	Public.
+
+ Description:
+	Determines whether the pattern has no living cells, in which case the bounding box is empty and
+	its size is 0.
+
+ Returns:
+	This method returns TRUE if no living cell was received.
+***************************************************************************************************/
+
+	bool isEmpty() const;
+
+/***************************************************************************************************
+ Method:
+	int64_t getTop() const, int64_t getLeft() const, int64_t getHeight() const,
+	int64_t getWidth() const and int64_t getPopulation() const
+
+ Scope:
+	Public.
+
+ Description:
+	Get the top row, the leftmost column and the size of the bounding box of the living cells, and
+	the number of living cells.
+***************************************************************************************************/
+
+	int64_t getTop() const;
+	int64_t getLeft() const;
+	int64_t getHeight() const;
+	int64_t getWidth() const;
+	int64_t getPopulation() const;
+};
+
+/***************************************************************************************************
+ Class:
+	WorldSink
+
+ Description:
+	A sink that revives the cells of a pattern in a world as they are read, moved by an offset. The
+	runs go straight into the bit-packed board with World::setRun(), and on the unbounded plane the
+	parts of the pattern off of the board are kept by the plane.
+***************************************************************************************************/
+
+class WorldSink : public PatternSink
+{
+
+private:
+
+	World& world;
+	int64_t rowOffset;
+	int64_t colOffset;
+
+public:
+
+/***************************************************************************************************
+ Method:
+	WorldSink(World& world, int64_t rowOffset, int64_t colOffset)
+
+ Scope:
+	Public.
+
+ Description:
+	The constructor. Cell (row, col) of the pattern is revived at (row + rowOffset,
+	col + colOffset) of the world.
+
+ Parameters:
+	1.	World& world - The world receiving the pattern. It must outlive the sink.
+	2.	int64_t rowOffset - Added to the row of every cell.
+	3.	int64_t colOffset - Added to the column of every cell.
+***************************************************************************************************/
+
+	WorldSink(World& world, int64_t rowOffset, int64_t colOffset);
+	virtual void setRun(int64_t row, int64_t col, int64_t length);
+};
+
+/***************************************************************************************************
+ Function:
+	bool readPattern(std::istream& in, PatternSink& sink, PatternHeader& header)
+
+ Description:
+	Reads a pattern from a stream, telling its format from its first line, and hands its living
+	cells to a sink as they are read. The stream is read in fixed-size blocks and nothing is kept
+	of the cells already handed over, so patterns larger than memory can be read into a sink that
+	does not store them all (PatternBounds, or a world on the unbounded plane).
+
+ Parameters:
+	1.	std::istream& in - The stream to read. It is read up to the end of the pattern.
+	2.	PatternSink& sink - Receives the living cells.
+	3.	PatternHeader& header - Receives the format, size and rule of the pattern.
+
+ Returns:
+	This function returns TRUE if a whole pattern was read and FALSE if the stream is not in a
+	known format or is malformed. The sink may have received part of the pattern either way. An
+	empty stream is an empty plaintext pattern.
+***************************************************************************************************/
+
+bool readPattern(std::istream& in, PatternSink& sink, PatternHeader& header);
+
+/***************************************************************************************************
+ Function:
+	bool writeRle(std::ostream& out, const World& world)
+
+ Description:
+	Writes the board of a world as an RLE pattern the size of the board, with the generation as a
+	comment and the rule in the header. Lines are wrapped at 70 characters. Reading the pattern
+	back at (0, 0) gives the same board.
+
+ Parameters:
+	1.	std::ostream& out - The stream to write.
+	2.	const World& world - The world to write.
+
+ Returns:
+	This function returns TRUE if the pattern was written and FALSE if the stream failed.
+
+ Remarks:
+	The board is read a word at a time, so the time taken grows with the number of runs rather than
+	with the number of cells. Only the board is written: on the unbounded plane, the cells off of
+	the board are left out.
+***************************************************************************************************/
+
+bool writeRle(std::ostream& out, const World& world);
+
+/***************************************************************************************************
+ Function:
+	bool writePlaintext(std::ostream& out, const World& world)
+
+ Description:
+	Writes the board of a world as a plaintext pattern: a comment with the generation and the rule,
+	then one line of 'O' and '.' per row.
+
+ Parameters:
+	1.	std::ostream& out - The stream to write.
+	2.	const World& world - The world to write.
+
+ Returns:
+	This function returns TRUE if the pattern was written and FALSE if the stream failed.
+***************************************************************************************************/
+
+bool writePlaintext(std::ostream& out, const World& world);
+
+#endif
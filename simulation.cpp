@@ -0,0 +1,277 @@
+/***************************************************************************************************
+ File Name:
+	simulation.cpp
+
+ Purpose:
+	Implementation file for running a world on a thread of its own. Steps the world on a worker
+	thread and publishes its generations through a triple buffer.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "simulation.h"
+#include "world.h"
+#include <string.h>
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+/* Converts a number of seconds to ticks of the clock. */
+inline Clock::duration toClock(const double seconds)
+{
+	return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+}
+
+Simulation::Simulation(World& newWorld)
+{
+	world = &newWorld;
+	for(int i = 0; i < 3; i++)
+	{
+		frames[i].turn = 0;
+		frames[i].population = 0;
+		frames[i].rows = 0;
+		frames[i].cols = 0;
+		frames[i].words = 0;
+		frames[i].tileRows = 1;
+		frames[i].tileCols = 1;
+	}
+	writeIndex = 0;
+	readIndex = 1;
+	latest.store(2);
+	rate = 0;
+	batch = 1;
+	running = false;
+	busy = false;
+	quit = false;
+	publishFrame(true);
+	worker = std::thread(&Simulation::work, this);
+}
+
+Simulation::~Simulation()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+		running = false;
+	}
+	wake.notify_all();
+	worker.join();
+}
+
+void Simulation::work()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	Clock::time_point paced;
+	for(;;)
+	{
+		// Park until started, then owe the first generation at once
+		if(!running)
+		{
+			busy = false;
+			parked.notify_all();
+			while(!running && !quit)
+				wake.wait(guard);
+			paced = Clock::now() - ((rate > 0) ? toClock(1.0 / rate) : Clock::duration::zero());
+		}
+		if(quit)
+			break;
+		busy = true;
+
+		// Flat out a whole batch is played. At a rate the generations due since paced are played,
+		// sleeping until BATCH_TIME's worth of them (or one) is due, and a world too slow for the
+		// rate drops what it owes.
+		int64_t turns = batch;
+		if(rate > 0)
+		{
+			const double paceRate = rate;
+			const Clock::time_point now = Clock::now();
+			const double owed = std::chrono::duration<double>(now - paced).count() * paceRate;
+			double chunk = paceRate * (BATCH_TIME * 1e-6);
+			if(chunk > batch)
+				chunk = batch;
+			if(chunk < 1)
+				chunk = 1;
+			if(owed < chunk)
+			{
+				wake.wait_until(guard, paced + toClock(chunk / paceRate),
+								[&] { return !running || quit || (rate != paceRate); });
+				continue;
+			}
+			if(owed > batch)
+				paced = now;
+			else
+			{
+				turns = (int64_t)owed;
+				paced += toClock(turns / paceRate);
+			}
+		}
+
+		applyEdits();
+		guard.unlock();
+		const Clock::time_point start = Clock::now();
+		world->play(turns);
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if(observer)
+			observer(*world);
+		publishFrame(false);
+		guard.lock();
+		adaptBatch(turns, seconds);
+	}
+	busy = false;
+	parked.notify_all();
+}
+
+void Simulation::adaptBatch(const int64_t turns, const double seconds)
+{
+	double next = (seconds > 0) ? turns * (BATCH_TIME * 1e-6) / seconds : 2.0 * batch;
+	if(next < batch / 2)
+		next = batch / 2;
+	if(next > batch * 2.0)
+		next = batch * 2.0;
+	if(next > MAX_BATCH)
+		next = MAX_BATCH;
+	batch = (next >= 1) ? (int64_t)next : 1;
+}
+
+void Simulation::applyEdits()
+{
+	for(size_t i = 0; i < edits.size(); i++)
+		world->setHealth(edits[i].row, edits[i].col, edits[i].health);
+	edits.clear();
+}
+
+void Simulation::publishFrame(const bool force)
+{
+	// The reader has not caught up, so the next frame will cover this generation too
+	const Clock::time_point now = Clock::now();
+	if(!force && (latest.load(std::memory_order_acquire) & FRESH) &&
+	   (now - published < std::chrono::microseconds(FRAME_AGE)))
+		return;
+	published = now;
+
+	SimulationFrame& frame = frames[writeIndex];
+	const BoardLayout layout = world->getLayout();
+	const uint64_t* board = world->getBoard();
+	frame.turn = world->getTurn();
+	frame.population = world->getPopulation();
+	frame.rows = world->getRows();
+	frame.cols = world->getCols();
+	frame.words = layout.words;
+	frame.cells.resize((size_t)frame.rows * frame.words);
+	for(int row = 0; row < frame.rows; row++)
+		memcpy(&frame.cells[(size_t)row * frame.words], board + (int64_t)row * layout.stride,
+			   frame.words * sizeof(uint64_t));
+	frame.tileRows = world->getTileRows();
+	frame.tileCols = world->getTileCols();
+
+	// Should the reader never take the latest frame, this one must show its tiles too
+	world->takeDirtyTiles(frame.dirty);
+	density.update(board, layout, frame.dirty, frame.tileRows, frame.tileCols);
+	frame.density = density;
+	if((latest.load(std::memory_order_acquire) & FRESH) && (carried.size() == frame.dirty.size()))
+		for(size_t tile = 0; tile < carried.size(); tile++)
+			frame.dirty[tile] |= carried[tile];
+	carried = frame.dirty;
+
+	const int previous = latest.exchange(writeIndex | FRESH, std::memory_order_acq_rel);
+	writeIndex = previous & 3;
+}
+
+void Simulation::start()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		running = true;
+	}
+	wake.notify_all();
+}
+
+void Simulation::stop()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	running = false;
+	wake.notify_all();
+	while(busy)
+		parked.wait(guard);
+	applyEdits();
+	publishFrame(true);
+}
+
+bool Simulation::isRunning() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return running;
+}
+
+double Simulation::getRate() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return rate;
+}
+
+void Simulation::setRate(const double gensPerSecond)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		rate = (gensPerSecond > 0) ? gensPerSecond : 0;
+	}
+	wake.notify_all();
+}
+
+int64_t Simulation::getBatch() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return batch;
+}
+
+void Simulation::step()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if(running || busy)
+		return;
+	applyEdits();
+	world->play(1);
+	if(observer)
+		observer(*world);
+	publishFrame(true);
+}
+
+void Simulation::setObserver(const std::function<void(const World&)>& newObserver)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	observer = newObserver;
+}
+
+void Simulation::edit(const int row, const int col, const bool health)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	Edit change;
+	change.row = row;
+	change.col = col;
+	change.health = health;
+	edits.push_back(change);
+	if(!running && !busy)
+	{
+		applyEdits();
+		publishFrame(true);
+	}
+}
+
+void Simulation::publish()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	publishFrame(true);
+}
+
+const SimulationFrame* Simulation::takeFrame(bool& fresh)
+{
+	fresh = (latest.load(std::memory_order_acquire) & FRESH) != 0;
+	if(fresh)
+		readIndex = latest.exchange(readIndex, std::memory_order_acq_rel) & 3;
+	return &frames[readIndex];
+}
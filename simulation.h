@@ -0,0 +1,436 @@
+/***************************************************************************************************
+ File Name:
+	simulation.h
+
+ Purpose:
+	Specification file for running a world on a thread of its own. Defines a class called
+	Simulation that steps a world continuously on a worker thread, at a set rate or as fast as it
+	goes, and hands the generations it finishes to another thread, such as the thread of a user
+	interface, through a lock-free triple buffer, so that neither thread ever waits for the other.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+#include "density.h"
+
+class World;
+
+/***************************************************************************************************
+ Struct:
+	SimulationFrame
+
+ Description:
+	A generation of a world as published by a simulation:
+		1.	turn and population - The turn number and the number of living cells.
+		2.	rows and cols - The size of the board.
+		3.	words - The number of words of each row of cells.
+		4.	cells - The cells, rows of words words one after the other, packed as World::setCells()
+			takes them.
+		5.	tileRows and tileCols - The shape of the tiles of dirty (see World::getTileRows()).
+		6.	dirty - The tiles that may have changed since the frame published before this one, as
+			World::takeDirtyTiles() gives them. The tiles of a frame the reader never took are
+			carried into the next one, so the reader never misses a change.
+		7.	density - The live counts of the blocks of the board, for drawing it zoomed out.
+***************************************************************************************************/
+
+struct SimulationFrame
+{
+	int64_t turn;
+	int64_t population;
+	int rows;
+	int cols;
+	int words;
+	std::vector<uint64_t> cells;
+	int tileRows;
+	int tileCols;
+	std::vector<unsigned char> dirty;
+	DensityPyramid density;
+};
+
+/***************************************************************************************************
+ Class:
+	Simulation
+
+ Description:
+	Steps a world on a worker thread. While the simulation runs the world belongs to the worker,
+	and other threads only see it through the frames the worker publishes and change it through
+	edit(); once stop() returns, the world may be used directly again.
+
+ Remarks:
+	Frames go through three buffers: the worker fills one while the reader holds another, and the
+	third holds the latest finished frame. Handing a buffer over is a single atomic exchange on
+	both sides. The worker publishes once the reader has taken the latest frame, or once that frame
+	is a few milliseconds old, and otherwise just keeps stepping, so a reader that falls behind
+	skips generations rather than slowing the world down, the frame it takes is never much older
+	than the world, and a fast world is not copied every generation.
+
+	The world is played in batches, a single call to World::play() each, so that what a call costs
+	over its generations (waking the thread pool, the HASHLIFE engine's leaps) is spread over many
+	of them. The batch grows and shrinks with the cost of a generation to take about BATCH_TIME;
+	below that rate it holds the generations the rate has made due. Edits, the observer and
+	publishing happen between batches.
+***************************************************************************************************/
+
+class Simulation
+{
+
+private:
+
+	/* Set in latest when the frame it names has not been taken by the reader yet. */
+	static const int FRESH = 4;
+
+	/* How old, in microseconds, a frame the reader has not taken may get before the worker
+	replaces it with a newer one. */
+	static const int FRAME_AGE = 4000;
+
+	/* How long, in microseconds, a batch of generations should take, and the most generations a
+	batch may hold. */
+	static const int BATCH_TIME = 8000;
+	static const int64_t MAX_BATCH = (int64_t)1 << 30;
+
+	/* A change to a cell requested while the simulation runs. */
+	struct Edit
+	{
+		int row;
+		int col;
+		bool health;
+	};
+
+	/* The world being stepped. Not owned by the simulation. */
+	World* world;
+
+	/* The three frames, the one the worker writes next, the one the reader holds, and the latest
+	finished one (an index, with FRESH set until the reader takes it). */
+	SimulationFrame frames[3];
+	int writeIndex;
+	int readIndex;
+	std::atomic<int> latest;
+
+	/* The dirty tiles of the latest frame, kept by the worker so that they can be carried into the
+	next frame if the reader never takes this one. */
+	std::vector<unsigned char> carried;
+
+	/* The live counts of the blocks of the world, brought up to date from the dirty tiles every
+	time a frame is published and copied into it. */
+	DensityPyramid density;
+
+	/* When the latest frame was published. */
+	std::chrono::steady_clock::time_point published;
+
+	/* The number of generations played per second while running, or 0 to play flat out. */
+	double rate;
+
+	/* The most generations the worker plays in one call, adapted to BATCH_TIME. */
+	int64_t batch;
+
+	/* Called on the worker thread after every generation, if set. */
+	std::function<void(const World&)> observer;
+
+	/* The worker thread, and what it shares with the other threads: whether it should run, whether
+	it is stepping, whether it should exit, and the edits waiting for it. */
+	std::thread worker;
+	mutable std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable parked;
+	bool running;
+	bool busy;
+	bool quit;
+	std::vector<Edit> edits;
+
+	/* Simulations own their thread and cannot be copied. */
+	Simulation(const Simulation&);
+	Simulation& operator=(const Simulation&);
+
+/***************************************************************************************************
+ Method:
+	void work()
+
+ Scope:
+	Private.
+
+ Description:
+	The loop of the worker thread. Waits to be started, then applies the waiting edits and plays
+	a batch of generations at a time, paced by the rate, publishing whenever the reader has caught
+	up.
+***************************************************************************************************/
+
+	void work();
+
+/***************************************************************************************************
+ Method:
+	void adaptBatch(int64_t turns, double seconds)
+
+ Scope:
+	Private.
+
+ Description:
+	Sizes the next batch from what the last one cost: as many generations as take BATCH_TIME at
+	that cost, but no less than half and no more than twice the batch before, so that one slow or
+	fast call does not throw the size off.
+
+ Parameters:
+	1.	int64_t turns - The number of generations the last batch played.
+	2.	double seconds - How long it took.
+***************************************************************************************************/
+
+	void adaptBatch(int64_t turns, double seconds);
+
+/***************************************************************************************************
+ Method:
+	void applyEdits()
+
+ Scope:
+	Private.
+
+ Description:
+	Applies the waiting edits to the world. The lock must be held, and the world not being played.
+***************************************************************************************************/
+
+	void applyEdits();
+
+/***************************************************************************************************
+ Method:
+	void publishFrame(bool force)
+
+ Scope:
+	Private.
+
+ Description:
+	Copies the world into the frame being written and makes it the latest frame.
+
+ Parameters:
+	1.	bool force - TRUE to publish even if the reader has not taken the latest frame yet, which
+		is then skipped. Otherwise nothing is published in that case unless the latest frame is
+		older than FRAME_AGE, and the dirty tiles keep adding up in the world until the next frame.
+***************************************************************************************************/
+
+	void publishFrame(bool force);
+
+public:
+
+/***************************************************************************************************
+ Method:
+	Simulation(World& newWorld)
+
+ Scope:
+	Public.
+
+ Description:
+	A constructor. Starts the worker thread, stopped, and publishes the world as it is.
+
+ Parameters:
+	1.	World& newWorld - The world to step. It must outlive the simulation.
+***************************************************************************************************/
+
+	explicit Simulation(World& newWorld);
+
+/***************************************************************************************************
+ Method:
+	~Simulation()
+
+ Scope:
+	Public.
+
+ Description:
+	The destructor. Stops and joins the worker thread.
+***************************************************************************************************/
+
+	~Simulation();
+
+/***************************************************************************************************
+ Method:
+	void start()
+
+ Scope:
+	Public.
+
+ Description:
+	Starts stepping the world on the worker thread. Does nothing if it is already running.
+***************************************************************************************************/
+
+	void start();
+
+/***************************************************************************************************
+ Method:
+	void stop()
+
+ Scope:
+	Public.
+
+ Description:
+	Stops stepping the world. Returns once the worker has finished the generation it was playing
+	and applied the edits still waiting, so the world can be used directly afterwards. The world
+	as it is then is published.
+***************************************************************************************************/
+
+	void stop();
+
+/***************************************************************************************************
+ Method:
+	bool isRunning() const
+
+ Scope:
+	Public.
+
+ Description:
+	Determines whether the world is being stepped.
+
+ Returns:
+	This method returns TRUE between start() and stop().
+***************************************************************************************************/
+
+	bool isRunning() const;
+
+/***************************************************************************************************
+ Method:
+	double getRate() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of generations played per second while running.
+
+ Returns:
+	This method returns the rate, or 0 if the world is played as fast as it goes.
+***************************************************************************************************/
+
+	double getRate() const;
+
+/***************************************************************************************************
+ Method:
+	void setRate(double gensPerSecond)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the number of generations played per second while running. The worker sleeps until
+	generations are due, and wakes up at once if stopped or given a new rate. A world that cannot
+	keep up plays as fast as it goes.
+
+ Parameters:
+	1.	double gensPerSecond - The rate. A value of 0 or less plays as fast as the world goes.
+***************************************************************************************************/
+
+	void setRate(double gensPerSecond);
+
+/***************************************************************************************************
+ Method:
+	int64_t getBatch() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the most generations the worker plays in one call, as last adapted to how long they take.
+
+ Returns:
+	This method returns the size of a batch, at least 1.
+***************************************************************************************************/
+
+	int64_t getBatch() const;
+
+/***************************************************************************************************
+ Method:
+	void step()
+
+ Scope:
+	Public.
+
+ Description:
+	Plays one generation on the calling thread while stopped, applying the waiting edits before it,
+	telling the observer and publishing it. Does nothing while running.
+***************************************************************************************************/
+
+	void step();
+
+/***************************************************************************************************
+ Method:
+	void setObserver(const std::function<void(const World&)>& newObserver)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets a function called on the worker thread after every generation, for example to record
+	the generations. It may only be set while stopped.
+
+ Parameters:
+	1.	const std::function<void(const World&)>& newObserver - The function, or an empty one.
+***************************************************************************************************/
+
+	void setObserver(const std::function<void(const World&)>& newObserver);
+
+/***************************************************************************************************
+ Method:
+	void edit(int row, int col, bool health)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the health of a cell. While running, the edit waits for the worker to apply it before
+	the next generation; while stopped it is applied at once. Either way it is published with the
+	next frame.
+
+ Parameters:
+	1.	int row - The row of the cell.
+	2.	int col - The column of the cell.
+	3.	bool health - The new health of the cell.
+***************************************************************************************************/
+
+	void edit(int row, int col, bool health);
+
+/***************************************************************************************************
+ Method:
+	void publish()
+
+ Scope:
+	Public.
+
+ Description:
+	Publishes the world as it is, after it was changed directly while stopped, replacing the
+	latest frame even if the reader has not taken it. Only to be called while stopped.
+***************************************************************************************************/
+
+	void publish();
+
+/***************************************************************************************************
+ Method:
+	const SimulationFrame* takeFrame(bool& fresh)
+
+ Scope:
+	Public.
+
+ Description:
+	Takes the latest frame, if there is a newer one than the frame last taken. Never blocks.
+
+ Parameters:
+	1.	bool& fresh - Set to TRUE if a new frame was taken and FALSE if the one last taken is
+		still the latest.
+
+ Returns:
+	This method returns the latest frame taken, which stays valid and unchanged until the next
+	call.
+
+ Remarks:
+	Only one thread may read frames.
+***************************************************************************************************/
+
+	const SimulationFrame* takeFrame(bool& fresh);
+};
+
+#endif
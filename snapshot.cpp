@@ -0,0 +1,138 @@
+/***************************************************************************************************
+ File Name:
+	snapshot.cpp
+
+ Purpose:
+	Implementation file for the snapshot format of the game engine. Writes snapshot files with one
+	gathering write and maps them back into memory with mmap.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "snapshot.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace
+{
+
+const char MAGIC[8] = {'L', 'I', 'F', 'E', 'S', 'N', 'A', 'P'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+/* Writes every byte of a set of buffers, which takes more than one call once they pass 2 GB. */
+bool writeAll(const int fd, iovec* parts, int count)
+{
+	while(count > 0)
+	{
+		const ssize_t written = writev(fd, parts, count);
+		if(written < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			return false;
+		}
+		size_t left = (size_t)written;
+		while((count > 0) && (left >= parts->iov_len))
+		{
+			left -= parts->iov_len;
+			parts++;
+			count--;
+		}
+		if(count > 0)
+		{
+			parts->iov_base = (char*)parts->iov_base + left;
+			parts->iov_len -= left;
+		}
+	}
+	return true;
+}
+
+/* Reads the header of a snapshot file and checks that this build can map it. */
+bool readHeader(const int fd, SnapshotHeader& header)
+{
+	if(pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+		return false;
+	return (memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0) &&
+		   (header.version == SNAPSHOT_VERSION) && (header.byteOrder == BYTE_ORDER_MARK) &&
+		   (header.headerBytes == sizeof(SnapshotHeader)) &&
+		   (header.dataOffset == SNAPSHOT_DATA_OFFSET) && (header.dataBytes > 0);
+}
+
+}
+
+bool writeSnapshot(const char* path, SnapshotHeader& header, const void* data)
+{
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = SNAPSHOT_VERSION;
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.headerBytes = sizeof(SnapshotHeader);
+	header.reserved = 0;
+	header.dataOffset = SNAPSHOT_DATA_OFFSET;
+
+	// The header is padded out to the board so both go out in the same call
+	std::vector<char> page(SNAPSHOT_DATA_OFFSET, 0);
+	memcpy(&page[0], &header, sizeof(header));
+	iovec parts[2];
+	parts[0].iov_base = &page[0];
+	parts[0].iov_len = page.size();
+	parts[1].iov_base = const_cast<void*>(data);
+	parts[1].iov_len = header.dataBytes;
+
+	const std::string temporary = std::string(path) + ".tmp";
+	const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+		return false;
+	bool written = writeAll(fd, parts, 2) && (fsync(fd) == 0);
+	written = (close(fd) == 0) && written;
+	if(written && (rename(temporary.c_str(), path) == 0))
+		return true;
+	unlink(temporary.c_str());
+	return false;
+}
+
+void* mapSnapshot(const char* path, SnapshotHeader& header)
+{
+	const int fd = open(path, O_RDONLY);
+	if(fd < 0)
+		return 0;
+	struct stat status;
+	void* data = MAP_FAILED;
+	if(readHeader(fd, header) && (fstat(fd, &status) == 0) &&
+	   ((uint64_t)status.st_size >= header.dataOffset + header.dataBytes))
+	{
+		data = mmap(0, header.dataBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+					(off_t)header.dataOffset);
+	}
+	close(fd);
+	if(data == MAP_FAILED)
+		return 0;
+	madvise(data, header.dataBytes, MADV_WILLNEED);
+	return data;
+}
+
+void unmapSnapshot(void* data, const size_t bytes)
+{
+	if(data != 0)
+		munmap(data, bytes);
+}
+
+bool isSnapshot(const char* path)
+{
+	const int fd = open(path, O_RDONLY);
+	if(fd < 0)
+		return false;
+	char magic[sizeof(MAGIC)];
+	const bool found = (read(fd, magic, sizeof(magic)) == (ssize_t)sizeof(magic)) &&
+					   (memcmp(magic, MAGIC, sizeof(MAGIC)) == 0);
+	close(fd);
+	return found;
+}
@@ -0,0 +1,150 @@
+/***************************************************************************************************
+ File Name:
+	snapshot.h
+
+ Purpose:
+	Specification file for the snapshot format of the game engine. A snapshot is a checkpoint of a
+	world: a fixed header followed by the raw bit-packed board exactly as the world keeps it in
+	memory, so that it is written with one large write and restored by mapping the file into memory
+	with nothing to parse.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The version of the snapshot format written by this build. Snapshots of any other version are
+refused. */
+const uint32_t SNAPSHOT_VERSION = 1;
+
+/* Where the board starts in a snapshot file. It is a multiple of every common page size (4 KB to
+64 KB), so the board can be mapped straight from the file on any of them. */
+const uint64_t SNAPSHOT_DATA_OFFSET = 65536;
+
+/***************************************************************************************************
+ Struct:
+	SnapshotHeader
+
+ Description:
+	The header at the start of a snapshot file. Its fields are stored in the byte order of the
+	machine that wrote it; byteOrder tells whether the reader shares that order.
+		1.	magic - "LIFESNAP".
+		2.	version - SNAPSHOT_VERSION.
+		3.	byteOrder - 0x01020304 as written.
+		4.	headerBytes - The size of this header.
+		5.	rows, cols, words, stride and halo - The layout of the board buffer (see World).
+		6.	birth and survival - The rule (see KernelRule).
+		7.	topology - The topology of the world (World::Topology).
+		8.	turn - The turn number of the world.
+		9.	population - The number of living cells.
+		10.	dataOffset - Where the board buffer starts in the file (SNAPSHOT_DATA_OFFSET).
+		11.	dataBytes - The size of the board buffer, halos and padding included.
+***************************************************************************************************/
+
+struct SnapshotHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t headerBytes;
+	uint32_t reserved;
+	int32_t rows;
+	int32_t cols;
+	int32_t words;
+	int32_t stride;
+	int32_t halo;
+	uint32_t birth;
+	uint32_t survival;
+	int32_t topology;
+	int64_t turn;
+	int64_t population;
+	uint64_t dataOffset;
+	uint64_t dataBytes;
+};
+
+static_assert(sizeof(SnapshotHeader) == 88, "the snapshot header must not depend on the compiler");
+
+/***************************************************************************************************
+ Function:
+	bool writeSnapshot(const char* path, SnapshotHeader& header, const void* data)
+
+ Description:
+	Writes a snapshot file: the header, padding up to SNAPSHOT_DATA_OFFSET, then the board buffer,
+	all in one gathering write. The file is written under a temporary name, flushed to disk and
+	then renamed over path, so a crash while writing never leaves a torn checkpoint behind and a
+	world still mapping an older snapshot of the same name keeps its own copy.
+
+ Parameters:
+	1.	const char* path - The file to write.
+	2.	SnapshotHeader& header - The header. Every field but magic, version, byteOrder, headerBytes
+		and dataOffset must be filled in; those are filled in here.
+	3.	const void* data - The board buffer, header.dataBytes long.
+
+ Returns:
+	This function returns TRUE if the snapshot was written and FALSE if the file could not be
+	written, in which case path is left as it was.
+***************************************************************************************************/
+
+bool writeSnapshot(const char* path, SnapshotHeader& header, const void* data);
+
+/***************************************************************************************************
+ Function:
+	void* mapSnapshot(const char* path, SnapshotHeader& header)
+
+ Description:
+	Reads the header of a snapshot file and maps its board buffer into memory, privately: pages are
+	read from the file as they are first touched, and written pages become copies that never reach
+	the file. The kernel is asked to start reading the file ahead, so the board is usually in
+	memory by the time it is first stepped.
+
+ Parameters:
+	1.	const char* path - The file to map.
+	2.	SnapshotHeader& header - Receives the header.
+
+ Returns:
+	This function returns the start of the board buffer, header.dataBytes long, or NULL if the file
+	cannot be read, is not a snapshot, is of another version or byte order, or is truncated.
+
+ Remarks:
+	The mapping must be released with unmapSnapshot(). It does not depend on the file staying open,
+	but the file must not be written in place while it is mapped (writeSnapshot() never does).
+***************************************************************************************************/
+
+void* mapSnapshot(const char* path, SnapshotHeader& header);
+
+/***************************************************************************************************
+ Function:
+	void unmapSnapshot(void* data, size_t bytes)
+
+ Description:
+	Releases a board buffer mapped by mapSnapshot().
+
+ Parameters:
+	1.	void* data - The start of the board buffer.
+	2.	size_t bytes - The size of the buffer (dataBytes of its header).
+***************************************************************************************************/
+
+void unmapSnapshot(void* data, size_t bytes);
+
+/***************************************************************************************************
+ Function:
+	bool isSnapshot(const char* path)
+
+ Description:
+	Determines whether a file starts like a snapshot, to tell snapshots apart from pattern files.
+
+ Parameters:
+	1.	const char* path - The file to check.
+
+ Returns:
+	This function returns TRUE if the file starts with the snapshot magic.
+***************************************************************************************************/
+
+bool isSnapshot(const char* path);
+
+#endif
@@ -0,0 +1,233 @@
+/***************************************************************************************************
+ File Name:
+	sparseplane.cpp
+
+ Purpose:
+	Implementation file for the sparse plane of the game engine. Defines a class called SparsePlane
+	that evolves a pattern on the unbounded plane, storing only the parts of the plane that hold
+	living cells.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "sparseplane.h"
+#include "threadpool.h"
+#include <string.h>
+#include <functional>
+#include <vector>
+
+const int SparsePlane::CHUNK;
+
+namespace
+{
+
+/* Divides a coordinate of the plane by the size of a chunk (64 cells), rounding down. */
+inline int64_t chunkOf(const int64_t coordinate)
+{
+	return (coordinate >= 0) ? coordinate / 64 : -((63 - coordinate) / 64);
+}
+
+}
+
+SparsePlane::SparsePlane()
+{
+	current = 0;
+}
+
+uint64_t SparsePlane::key(const int64_t chunkRow, const int64_t chunkCol)
+{
+	return ((uint64_t)(uint32_t)chunkRow << 32) | (uint32_t)chunkCol;
+}
+
+int64_t SparsePlane::keyRow(const uint64_t key)
+{
+	return (int32_t)(uint32_t)(key >> 32);
+}
+
+int64_t SparsePlane::keyCol(const uint64_t key)
+{
+	return (int32_t)(uint32_t)key;
+}
+
+void SparsePlane::load(const BoardLayout& layout, const uint64_t* board)
+{
+	chunks.clear();
+	current = 0;
+
+	// A word of the board is exactly one row of a chunk
+	for(int row = 0; row < layout.rows; row++)
+	{
+		const uint64_t* cells = board + (int64_t)row * layout.stride;
+		for(int w = 0; w < layout.words; w++)
+		{
+			if(cells[w] != 0)
+				chunks[key(row / CHUNK, w)].cells[0][row % CHUNK] = cells[w];
+		}
+	}
+}
+
+void SparsePlane::store(const BoardLayout& layout, uint64_t* board) const
+{
+	for(ChunkMap::const_iterator i = chunks.begin(); i != chunks.end(); ++i)
+	{
+		const int64_t chunkRow = keyRow(i->first), chunkCol = keyCol(i->first);
+		if((chunkCol < 0) || (chunkCol >= layout.words))
+			continue;
+		const uint64_t mask = (chunkCol == layout.words - 1) ? layout.lastMask : ~(uint64_t)0;
+		for(int r = 0; r < CHUNK; r++)
+		{
+			const int64_t row = chunkRow * CHUNK + r;
+			if((row >= 0) && (row < layout.rows))
+				board[row * layout.stride + chunkCol] = i->second.cells[current][r] & mask;
+		}
+	}
+}
+
+void SparsePlane::setRun(const int64_t row, const int64_t col, const int64_t length)
+{
+	const int64_t chunkRow = chunkOf(row);
+	const int r = (int)(row - chunkRow * CHUNK);
+	const int64_t end = col + length;
+	for(int64_t c = col; c < end;)
+	{
+		// The part of the run in one chunk
+		const int64_t chunkCol = chunkOf(c);
+		const int64_t stop = ((chunkCol + 1) * CHUNK < end) ? (chunkCol + 1) * CHUNK : end;
+		const int count = (int)(stop - c);
+		const uint64_t mask = (count == CHUNK) ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+		chunks[key(chunkRow, chunkCol)].cells[current][r] |= mask << (c - chunkCol * CHUNK);
+		c = stop;
+	}
+}
+
+void SparsePlane::spill()
+{
+	std::vector<uint64_t> keys;
+	for(ChunkMap::const_iterator i = chunks.begin(); i != chunks.end(); ++i)
+	{
+		const uint64_t* cells = i->second.cells[current];
+		const int64_t chunkRow = keyRow(i->first), chunkCol = keyCol(i->first);
+		uint64_t west = 0, east = 0;
+		for(int r = 0; r < CHUNK; r++)
+		{
+			west |= cells[r];
+			east |= cells[r];
+		}
+		west &= 1;
+		east >>= CHUNK - 1;
+
+		const uint64_t top = cells[0], bottom = cells[CHUNK - 1];
+		if(top != 0)
+			keys.push_back(key(chunkRow - 1, chunkCol));
+		if(bottom != 0)
+			keys.push_back(key(chunkRow + 1, chunkCol));
+		if(west != 0)
+			keys.push_back(key(chunkRow, chunkCol - 1));
+		if(east != 0)
+			keys.push_back(key(chunkRow, chunkCol + 1));
+		if((top & 1) != 0)
+			keys.push_back(key(chunkRow - 1, chunkCol - 1));
+		if((top >> (CHUNK - 1)) != 0)
+			keys.push_back(key(chunkRow - 1, chunkCol + 1));
+		if((bottom & 1) != 0)
+			keys.push_back(key(chunkRow + 1, chunkCol - 1));
+		if((bottom >> (CHUNK - 1)) != 0)
+			keys.push_back(key(chunkRow + 1, chunkCol + 1));
+	}
+
+	// Inserting value-initializes the missing chunks, which leaves them dead
+	for(size_t i = 0; i < keys.size(); i++)
+		chunks[keys[i]];
+}
+
+void SparsePlane::step(const RuleTable& rule, ThreadPool* pool)
+{
+	spill();
+
+	std::vector<ChunkMap::value_type*> list;
+	list.reserve(chunks.size());
+	for(ChunkMap::iterator i = chunks.begin(); i != chunks.end(); ++i)
+		list.push_back(&*i);
+
+	// Every chunk is stepped as the middle word of a board three words wide, with the rows of its
+	// neighbors around it. Words 0 and 2 and rows -1 and 64 are only read.
+	const int STRIDE = 3;
+	BoardLayout layout;
+	layout.rows = CHUNK;
+	layout.cols = 3 * CHUNK;
+	layout.words = 3;
+	layout.stride = STRIDE;
+	layout.lastMask = ~(uint64_t)0;
+	const int next = current ^ 1;
+	const std::function<void(int)> job = [&](const int index)
+	{
+		uint64_t src[(CHUNK + 2) * STRIDE], dst[(CHUNK + 2) * STRIDE];
+		memset(src, 0, sizeof(src));
+		const int64_t chunkRow = keyRow(list[index]->first), chunkCol = keyCol(list[index]->first);
+		for(int i = -1; i <= 1; i++)
+		{
+			for(int j = -1; j <= 1; j++)
+			{
+				const ChunkMap::const_iterator found = chunks.find(key(chunkRow + i, chunkCol + j));
+				if(found == chunks.end())
+					continue;
+				const uint64_t* cells = found->second.cells[current];
+
+				// Only the row next to the middle chunk is needed from the chunks above and below
+				const int first = (i < 0) ? CHUNK - 1 : 0;
+				const int last = (i > 0) ? 0 : CHUNK - 1;
+				for(int r = first; r <= last; r++)
+					src[(i * CHUNK + r + 1) * STRIDE + j + 1] = cells[r];
+			}
+		}
+		TileCounts counts;
+		stepSwar(layout, src + STRIDE, dst + STRIDE, 0, CHUNK, 1, 2, rule, counts);
+		uint64_t* out = list[index]->second.cells[next];
+		for(int r = 0; r < CHUNK; r++)
+			out[r] = dst[(r + 1) * STRIDE + 1];
+	};
+	if(pool != 0)
+		pool->run((int)list.size(), job);
+	else
+	{
+		for(int index = 0; index < (int)list.size(); index++)
+			job(index);
+	}
+	current = next;
+
+	// Free the chunks that died out
+	for(ChunkMap::iterator i = chunks.begin(); i != chunks.end();)
+	{
+		uint64_t living = 0;
+		for(int r = 0; r < CHUNK; r++)
+			living |= i->second.cells[current][r];
+		if(living == 0)
+			i = chunks.erase(i);
+		else
+			++i;
+	}
+}
+
+uint64_t SparsePlane::getPopulation() const
+{
+	uint64_t population = 0;
+	for(ChunkMap::const_iterator i = chunks.begin(); i != chunks.end(); ++i)
+	{
+		for(int r = 0; r < CHUNK; r++)
+			population += __builtin_popcountll(i->second.cells[current][r]);
+	}
+	return population;
+}
+
+size_t SparsePlane::getChunks() const
+{
+	return chunks.size();
+}
+
+size_t SparsePlane::getMemory() const
+{
+	// Every chunk lives in a node of the map with its key and a link to the next node
+	const size_t node = sizeof(ChunkMap::value_type) + 2 * sizeof(void*);
+	return chunks.size() * node + chunks.bucket_count() * sizeof(void*);
+}
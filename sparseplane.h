@@ -0,0 +1,258 @@
+/***************************************************************************************************
+ File Name:
+	sparseplane.h
+
+ Purpose:
+	Specification file for the sparse plane of the game engine. Defines a class called SparsePlane
+	that evolves a pattern on the unbounded plane, storing only the parts of the plane that hold
+	living cells.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef SPARSEPLANE_H
+#define SPARSEPLANE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include "kernel.h"
+
+class ThreadPool;
+
+/***************************************************************************************************
+ Class:
+	SparsePlane
+
+ Description:
+	The unbounded plane, cut into chunks of 64 by 64 cells. Chunk (i, j) holds the cells of rows
+	64i to 64i + 63 and columns 64j to 64j + 63, one word per row in the same bit order as a board
+	(see BoardLayout), and only the chunks with living cells are stored. Chunks are created when
+	living cells on their edges may give birth inside of them and freed as soon as they are empty,
+	so the memory used grows with the population rather than with the extent of the pattern.
+
+ Remarks:
+	The rule must not give birth to cells with no living neighbors, or the whole plane would come
+	alive.
+***************************************************************************************************/
+
+class SparsePlane
+{
+
+private:
+
+	/* The width and height of a chunk in cells. */
+	static const int CHUNK = 64;
+
+	/* A chunk in both generations. */
+	struct Chunk
+	{
+		uint64_t cells[2][CHUNK];
+	};
+
+	typedef std::unordered_map<uint64_t, Chunk> ChunkMap;
+
+	/* The stored chunks, keyed by key(). */
+	ChunkMap chunks;
+
+	/* The generation of the chunks (0 or 1) that holds the current cells. */
+	int current;
+
+	/* Planes own their chunks and cannot be copied. */
+	SparsePlane(const SparsePlane&);
+	SparsePlane& operator=(const SparsePlane&);
+
+/***************************************************************************************************
+ Method:
+	static uint64_t key(int64_t chunkRow, int64_t chunkCol)
+
+ Scope:
+	Private.
+
+ Description:
+	Packs the coordinates of a chunk into the key of the chunk map.
+
+ Returns:
+	This method returns the key of the chunk.
+***************************************************************************************************/
+
+	static uint64_t key(int64_t chunkRow, int64_t chunkCol);
+
+/***************************************************************************************************
+ Method:
+	static int64_t keyRow(uint64_t key) and static int64_t keyCol(uint64_t key)
+
+ Scope:
+	Private.
+
+ Description:
+	Unpacks the coordinates of a chunk from its key.
+
+ Returns:
+	These methods return the row and column of the chunk.
+***************************************************************************************************/
+
+	static int64_t keyRow(uint64_t key);
+	static int64_t keyCol(uint64_t key);
+
+/***************************************************************************************************
+ Method:
+	void spill()
+
+ Scope:
+	Private.
+
+ Description:
+	Creates the missing dead chunks next to the living cells on the edges of the stored chunks,
+	which are the only places outside of the stored chunks where cells can be born.
+***************************************************************************************************/
+
+	void spill();
+
+public:
+
+/***************************************************************************************************
+ Method:
+	SparsePlane()
+
+ Scope:
+	Public.
+
+ Description:
+	The default constructor. Creates an empty plane.
+***************************************************************************************************/
+
+	SparsePlane();
+
+/***************************************************************************************************
+ Method:
+	void load(const BoardLayout& layout, const uint64_t* board)
+
+ Scope:
+	Public.
+
+ Description:
+	Replaces the plane with the cells of a bit-packed board. Cell (row, col) of the board becomes
+	cell (row, col) of the plane and every other cell of the plane is dead.
+
+ Parameters:
+	1.	const BoardLayout& layout - The layout of the board.
+	2.	const uint64_t* board - Row 0 of the board.
+***************************************************************************************************/
+
+	void load(const BoardLayout& layout, const uint64_t* board);
+
+/***************************************************************************************************
+ Method:
+	void store(const BoardLayout& layout, uint64_t* board) const
+
+ Scope:
+	Public.
+
+ Description:
+	Copies the cells of the plane that lie on a bit-packed board into the board. The cells of the
+	plane off of the board are left out but are not lost.
+
+ Parameters:
+	1.	const BoardLayout& layout - The layout of the board.
+	2.	uint64_t* board - Row 0 of the board.
+
+ Remarks:
+	Only the words covered by stored chunks are written, so the board must be cleared first.
+***************************************************************************************************/
+
+	void store(const BoardLayout& layout, uint64_t* board) const;
+
+/***************************************************************************************************
+ Method:
+	void setRun(int64_t row, int64_t col, int64_t length)
+
+ Scope:
+	Public.
+
+ Description:
+	Revives a run of cells, (row, col) to (row, col + length - 1), creating the chunks it runs
+	through. Lets a pattern be loaded straight into the plane, so the cells off of any board are
+	kept and only the chunks with living cells are ever stored.
+
+ Parameters:
+	1.	int64_t row - The row of the run.
+	2.	int64_t col - The first column of the run.
+	3.	int64_t length - The number of cells of the run.
+
+ Remarks:
+	Chunk coordinates are 32 bits wide, so the cells must lie within 2^37 cells of the origin.
+***************************************************************************************************/
+
+	void setRun(int64_t row, int64_t col, int64_t length);
+
+/***************************************************************************************************
+ Method:
+	void step(const RuleTable& rule, ThreadPool* pool)
+
+ Scope:
+	Public.
+
+ Description:
+	Advances the plane by one generation. Every chunk is computed with stepSwar() from its 3x3 block
+	of chunks, and the chunks left empty are freed.
+
+ Parameters:
+	1.	const RuleTable& rule - The compiled rule of the game.
+	2.	ThreadPool* pool - The pool computing the chunks, or 0 to compute them on this thread.
+***************************************************************************************************/
+
+	void step(const RuleTable& rule, ThreadPool* pool);
+
+/***************************************************************************************************
+ Method:
+	uint64_t getPopulation() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of living cells on the plane.
+
+ Returns:
+	This method returns the population of the plane.
+***************************************************************************************************/
+
+	uint64_t getPopulation() const;
+
+/***************************************************************************************************
+ Method:
+	size_t getChunks() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of stored chunks.
+
+ Returns:
+	This method returns the number of chunks.
+***************************************************************************************************/
+
+	size_t getChunks() const;
+
+/***************************************************************************************************
+ Method:
+	size_t getMemory() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the memory taken by the chunks and the chunk map.
+
+ Returns:
+	This method returns the size of the plane in bytes.
+***************************************************************************************************/
+
+	size_t getMemory() const;
+
+};
+
+#endif
@@ -0,0 +1,104 @@
+/***************************************************************************************************
+ File Name:
+	threadpool.cpp
+
+ Purpose:
+	Implementation file for the thread pool of the game engine. Defines a class called ThreadPool
+	that keeps a set of worker threads alive for the life of a world and hands them batches of
+	independent tasks, such as the tiles of one generation.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(int numThreads)
+{
+	if(numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+	if(numThreads <= 0)
+		numThreads = 1;
+
+	task = 0;
+	numTasks = 0;
+	next = 0;
+	busy = 0;
+	batch = 0;
+	quit = false;
+	for(int i = 1; i < numThreads; i++)
+		workers.push_back(std::thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	wake.notify_all();
+	for(size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+int ThreadPool::getThreads() const
+{
+	return (int)workers.size() + 1;
+}
+
+void ThreadPool::drain()
+{
+	for(int i = next++; i < numTasks; i = next++)
+		(*task)(i);
+}
+
+void ThreadPool::work()
+{
+	unsigned long seen = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while(!quit && (batch == seen))
+				wake.wait(guard);
+			if(quit)
+				return;
+			seen = batch;
+		}
+
+		drain();
+
+		std::lock_guard<std::mutex> guard(lock);
+		if(--busy == 0)
+			done.notify_one();
+	}
+}
+
+void ThreadPool::run(const int count, const std::function<void(int)>& job)
+{
+	if(workers.empty() || (count <= 1))
+	{
+		// Not worth waking anyone up
+		for(int i = 0; i < count; i++)
+			job(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		task = &job;
+		numTasks = count;
+		next = 0;
+		busy = (int)workers.size();
+		batch++;
+	}
+	wake.notify_all();
+
+	drain();
+
+	// Barrier: the batch is only over once every worker has stopped touching it
+	std::unique_lock<std::mutex> guard(lock);
+	while(busy != 0)
+		done.wait(guard);
+	task = 0;
+}
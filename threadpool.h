@@ -0,0 +1,165 @@
+/***************************************************************************************************
+ File Name:
+	threadpool.h
+
+ Purpose:
+	Specification file for the thread pool of the game engine. Defines a class called ThreadPool
+	that keeps a set of worker threads alive for the life of a world and hands them batches of
+	independent tasks, such as the tiles of one generation.
+
+ Authors:
+	Igor Janjic
+***************************************************************************************************/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***************************************************************************************************
+ Class:
+	ThreadPool
+
+ Description:
+	A persistent pool of worker threads. run() hands a batch of tasks to the workers and the calling
+	thread, and only returns once every task of the batch is finished, so consecutive batches are
+	separated by a barrier. Tasks are claimed dynamically, which balances uneven tiles.
+
+ Remarks:
+	Only one thread may call run() at a time.
+***************************************************************************************************/
+
+class ThreadPool
+{
+
+private:
+
+	/* The worker threads. The thread calling run() works as well, so there is one fewer worker
+	than the number of threads of the pool. */
+	std::vector<std::thread> workers;
+
+	/* Protects the batch bookkeeping and signals workers and the caller. */
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	/* The current batch: its tasks, their number and the next one to claim. */
+	const std::function<void(int)>* task;
+	int numTasks;
+	std::atomic<int> next;
+
+	/* The number of workers that have not finished the current batch yet. */
+	int busy;
+
+	/* Incremented for every batch so that workers can tell a new batch from a spurious wake up. */
+	unsigned long batch;
+
+	/* Set when the pool is destroyed. */
+	bool quit;
+
+/***************************************************************************************************
+ Method:
+	void work()
+
+ Scope:
+	Private.
+
+ Description:
+	The loop run by every worker thread. Waits for a batch, helps finishing it, then reports back.
+***************************************************************************************************/
+
+	void work();
+
+/***************************************************************************************************
+ Method:
+	void drain()
+
+ Scope:
+	Private.
+
+ Description:
+	Claims and runs tasks of the current batch until none are left.
+***************************************************************************************************/
+
+	void drain();
+
+	/* Pools own their threads and cannot be copied. */
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+public:
+
+/***************************************************************************************************
+ Method:
+	ThreadPool(int numThreads)
+
+ Scope:
+	Public.
+
+ Description:
+	A constructor. Starts the worker threads.
+
+ Parameters:
+	1.	int numThreads - The number of threads that run tasks, including the one calling run(). A
+		value of 0 or less uses one thread per hardware thread.
+***************************************************************************************************/
+
+	explicit ThreadPool(int numThreads);
+
+/***************************************************************************************************
+ Method:
+	~ThreadPool()
+
+ Scope:
+	Public.
+
+ Description:
+	The destructor. Stops and joins the worker threads.
+***************************************************************************************************/
+
+	~ThreadPool();
+
+/***************************************************************************************************
+ Method:
+	int getThreads() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of threads that run tasks, including the one calling run().
+
+ Returns:
+	This method returns the number of threads of the pool.
+***************************************************************************************************/
+
+	int getThreads() const;
+
+/***************************************************************************************************
+ Method:
+	void run(int count, const std::function<void(int)>& job)
+
+ Scope:
+	Public.
+
+ Description:
+	Runs job(0) to job(count - 1) on the threads of the pool and waits for all of them to finish.
+
+ Parameters:
+	1.	int count - The number of tasks.
+	2.	const std::function<void(int)>& job - The task, called with the index of each task once.
+
+ Remarks:
+	The tasks run in no particular order and concurrently, so they must not depend on each other.
+***************************************************************************************************/
+
+	void run(int count, const std::function<void(int)>& job);
+
+};
+
+#endif
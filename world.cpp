@@ -11,120 +11,217 @@
 ***************************************************************************************************/
 
 #include "world.h"
+#include "threadpool.h"
+#include "hashlife.h"
+#include "sparseplane.h"
+#include "edges.h"
+#include "snapshot.h"
+#include "history.h"
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+namespace
+{
+
+/* The part of the hash of a board that a word at a position (row * words + word) gives: nothing for
+an empty word, so empty space is never looked at, and otherwise the two halves of the 128-bit
+product of the word, keyed by its position, with an odd constant, folded together. */
+inline uint64_t hashWord(const uint64_t position, const uint64_t word)
+{
+	const uint64_t keyed = word ^ (position * 0x9e3779b97f4a7c15ULL);
+	const unsigned __int128 product = (unsigned __int128)keyed * 0xbf58476d1ce4e5b9ULL;
+	return ((uint64_t)product ^ (uint64_t)(product >> 64)) & (0 - (uint64_t)(word != 0));
+}
+}
 
 /*string World::allocFail() const
 {
 	return "Error... Dynamic memory allocation failed.\n";
 }*/
 
-Cell* World::find(int row, int col)
+bool World::getBit(const uint64_t* board, const int row, const int col) const
 {
-	if((row < 0) || (col > cols))
-		return 0;
-	return grid[row][col];
+	if((row < 0) || (row >= rows) || (col < 0) || (col >= cols))
+		return false;
+	return (board[(int64_t)row * stride + (col >> 6)] >> (col & 63)) & 1;
 }
 
-Cell* World::findNeighbor(int row, int col, int index)
+void World::setBit(uint64_t* board, const int row, const int col, const bool health)
 {
-	int nRow, nCol;
-	// Determine the special cases (boundary of world)
-	if((row == 0) && (index >= 0 && index <= 2))
-		return 0;
-	else if((row == (rows - 1)) && (index >= 4 && index <= 6))
-		return 0;
-	else if((col == 0) && ((index == 0) || (index == 6) || (index == 7)))
-		return 0;
-	else if((col == (cols - 1)) && ((index >= 2) && (index <= 4)))
-		return 0;
+	uint64_t& word = board[(int64_t)row * stride + (col >> 6)];
+	const uint64_t bit = (uint64_t)1 << (col & 63);
+	if(health)
+		word |= bit;
 	else
+		word &= ~bit;
+}
+
+template<class Edges>
+int World::countNeighbors(const uint64_t* board, const int row, const int col) const
+{
+	int tally = 0;
+	for(int i = row - 1; i <= row + 1; i++)
 	{
-		switch(index) // Determine the coordinates of the neighbor
+		for(int j = col - 1; j <= col + 1; j++)
 		{
-			case 0:
-				nRow = row - 1;
-				nCol = col - 1;
-				break;
-			case 1:
-				nRow = row - 1;
-				nCol = col;
-				break;
-			case 2:
-				nRow = row - 1;
-				nCol = col + 1;
-				break;
-			case 3:
-				nRow = row;
-				nCol = col + 1;
-				break;
-			case 4:
-				nRow = row + 1;
-				nCol = col + 1;
-				break;
-			case 5:
-				nRow = row + 1;
-				nCol = col;
-				break;
-			case 6:
-				nRow = row + 1;
-				nCol = col - 1;
-				break;
-			case 7:
-				nRow = row;
-				nCol = col - 1;
+			int neighborRow = i, neighborCol = j;
+			if(((i != row) || (j != col)) && Edges::wrap(neighborRow, neighborCol, rows, cols) &&
+			   getBit(board, neighborRow, neighborCol))
+				tally++;
 		}
-		return find(nRow, nCol);
 	}
+	return tally;
 }
 
-bool World::checkRule1(const bool health, const int numLiving) const
+void World::allocate(const int numRows, const int numCols)
 {
-	if((health == true) && (numLiving < rules.rule1))
-		return false;
-	else
-		return health;
+	rows = (numRows > 0) ? numRows : 25;
+	cols = (numCols > 0) ? numCols : 35;
+	size = (int64_t)rows * cols;
+
+	// Pad each row to whole cache lines, leaving at least two dead words past the last cell
+	words = (cols + 63) / 64;
+	stride = (words + 2 + LINE_WORDS - 1) / LINE_WORDS * LINE_WORDS;
+	halo = LINE_WORDS + stride;
+
+	front = allocBuffer(rows, stride);
+	back = allocBuffer(rows, stride);
+	mappedBoard = 0;
+	mappedBytes = 0;
+	living = 0;
+	born = 0;
+	died = 0;
+	engine = SWAR;
+	kernel = detectKernel();
+	pool = 0;
+	setTileShape(64, 512);
+	universeStale = true;
+	hashLifeMemory = (size_t)512 << 20;
+	topology = BOUNDED;
+	plane = 0;
+	planeStale = true;
+	history = 0;
+	boardHash = 0;
+	periodWindow = 0;
+	stopOnPeriod = false;
+	forgetPeriods();
 }
 
-bool World::checkRule2(const bool health, const int numLiving) const
+size_t World::bufferBytes(const int numRows, const int numStride)
 {
-	if(health == true && (numLiving > rules.rule2))
-		return false;
-	else
-		return health;
+	// Leading padding and top halo, the rows, the bottom halo, then a line for the vector kernels
+	return ((size_t)LINE_WORDS + numStride + ((size_t)numRows + 1) * numStride + LINE_WORDS) *
+		   sizeof(uint64_t);
 }
 
-bool World::checkRule3(const bool health, const int numLiving) const
+uint64_t* World::allocBuffer(const int numRows, const int numStride) const
 {
-	if(health == false && (numLiving == rules.rule3))
-		return true;
+	const size_t bytes = bufferBytes(numRows, numStride);
+	void* block = 0;
+	if(posix_memalign(&block, LINE_WORDS * sizeof(uint64_t), bytes) != 0)
+		throw std::bad_alloc();
+	memset(block, 0, bytes);
+	return (uint64_t*)block + LINE_WORDS + numStride;
+}
+
+void World::freeBuffer(uint64_t* board)
+{
+	if(board == 0)
+		return;
+	if(board == mappedBoard)
+	{
+		unmapSnapshot(board - halo, mappedBytes);
+		mappedBoard = 0;
+	}
 	else
-		return health;
+		free(board - halo);
+}
+
+BoardLayout World::getLayout() const
+{
+	BoardLayout layout;
+	layout.rows = rows;
+	layout.cols = cols;
+	layout.words = words;
+	layout.stride = stride;
+	layout.lastMask = (cols % 64 == 0) ? ~(uint64_t)0 : ((uint64_t)1 << (cols % 64)) - 1;
+	return layout;
+}
+
+const uint64_t* World::getBoard() const
+{
+	return front;
+}
+
+KernelRule World::getClassicRule() const
+{
+	KernelRule classic;
+	classic.birth = 1u << rules.rule3;
+	classic.survival = 0;
+	for(int i = rules.rule1; i <= rules.rule2; i++)
+		classic.survival |= 1u << i;
+	return classic;
+}
+
+KernelRule World::getKernelRule() const
+{
+	return kernelRule;
+}
+
+void World::applyRule(const KernelRule& newRule)
+{
+	kernelRule = newRule;
+	compileRule(kernelRule, ruleTable);
+	wakeTiles();
+	delete universe;
+	universe = 0;
+	forgetPeriods();
 }
 
 World::World()
 {
-	rows = 25;
-	cols = 35;
-	size = rows * cols;
 	turn = 0;
-	setRule1(0);
-	setRule2(0);
-	setRule3(0);
+	universe = 0;
+	rules.rule1 = 2;
+	rules.rule2 = 3;
+	rules.rule3 = 3;
+	applyRule(getClassicRule());
+	allocate(25, 35);
+}
 
-	for(int i = 0; i < rows; i++)
-	{
-		for (int j = 0; j < cols; j++)
-		{
-			grid[i][j] = new Cell();
-		}
-	}
+World::World(const int numRows, const int numCols)
+{
+	turn = 0;
+	universe = 0;
+	rules.rule1 = 2;
+	rules.rule2 = 3;
+	rules.rule3 = 3;
+	applyRule(getClassicRule());
+	allocate(numRows, numCols);
+}
+
+World::World(const int numRows, const int numCols, const int rule1, const int rule2,
+			 const int rule3)
+{
+	turn = 0;
+	universe = 0;
+	rules.rule1 = ((rule1 > 0) && (rule1 <= 8)) ? rule1 : 2;
+	rules.rule2 = ((rule2 > 0) && (rule2 <= 8)) ? rule2 : 3;
+	rules.rule3 = ((rule3 > 0) && (rule3 <= 8)) ? rule3 : 3;
+	applyRule(getClassicRule());
+	allocate(numRows, numCols);
 }
 
 World::~World()
 {
-	// Free the grid
-	for(int i = 0; i < cols; i++)
-		delete[] grid[i];
-	delete[] grid;
+	delete pool;
+	delete universe;
+	delete plane;
+
+	// Free the board
+	freeBuffer(front);
+	freeBuffer(back);
 }
 
 int World::getRows() const
@@ -137,16 +234,31 @@ int World::getCols() const
 	return cols;
 }
 
-int World::getSize() const
+int64_t World::getSize() const
 {
 	return size;
 }
 
-int World::getTurn() const
+int64_t World::getTurn() const
 {
 	return turn;
 }
 
+int64_t World::getPopulation() const
+{
+	return living;
+}
+
+int64_t World::getBorn() const
+{
+	return born;
+}
+
+int64_t World::getDied() const
+{
+	return died;
+}
+
 int World::getRule1() const
 {
 	return rules.rule1;
@@ -162,39 +274,461 @@ int World::getRule3() const
 	return rules.rule3;
 }
 
-int World::getLivingNeighbors(const int row, const int col)
+World::Engine World::getEngine() const
 {
-	int tally = 0;
-	for(int i = 0; i < 8; i++)
+	return engine;
+}
+
+void World::setEngine(const Engine newEngine)
+{
+	engine = newEngine;
+}
+
+World::Topology World::getTopology() const
+{
+	return topology;
+}
+
+void World::setTopology(const Topology newTopology)
+{
+	topology = newTopology;
+	planeStale = true;
+	wakeTiles();
+	forgetPeriods();
+}
+
+size_t World::getChunks() const
+{
+	return ((topology == UNBOUNDED) && (plane != 0)) ? plane->getChunks() : 0;
+}
+
+KernelType World::getKernel() const
+{
+	return kernel;
+}
+
+void World::setKernel(const KernelType newKernel)
+{
+	kernel = (newKernel <= detectKernel()) ? newKernel : detectKernel();
+}
+
+int World::getThreads() const
+{
+	return (pool != 0) ? pool->getThreads() : 1;
+}
+
+void World::setThreads(const int numThreads)
+{
+	delete pool;
+	pool = 0;
+	if(numThreads != 1)
 	{
-		Cell* curNeighbor = findNeighbor(row, col, i);
-		if(curNeighbor != 0) // If the current Neighbor doesn't exist, don't worry about it
+		pool = new ThreadPool(numThreads);
+		if(pool->getThreads() == 1)
 		{
-			if(curNeighbor->isHealthy())
-				tally++;
+			delete pool;
+			pool = 0;
 		}
 	}
-	return tally;
 }
 
-bool World::isHealthy(const int row, const int col)
+int World::getTileRows() const
 {
-	Cell* cell = find(row, col);
-	if(cell == 0)
+	return tileRows;
+}
+
+int World::getTileCols() const
+{
+	return tileWords * 64;
+}
+
+void World::setTileShape(const int numRows, const int numCols)
+{
+	tileRows = (numRows > 0) ? numRows : 64;
+	if(numCols <= 0)
+		tileWords = words;
+	else
 	{
-		//throw NullPointerException;
-		return false;
+		// Whole cache lines (512 cells) so the vector kernels stay inside their tile
+		const int numWords = (numCols + 63) / 64;
+		tileWords = (numWords + LINE_WORDS - 1) / LINE_WORDS * LINE_WORDS;
+		if(tileWords > words)
+			tileWords = words;
+	}
+
+	tilesDown = (rows + tileRows - 1) / tileRows;
+	tilesAcross = (words + tileWords - 1) / tileWords;
+	changed.assign((size_t)tilesDown * tilesAcross, 1);
+	changing.assign(changed.size(), 0);
+	dirty.assign(changed.size(), 1);
+	tileCounts.resize(changed.size());
+	tileHashes.resize(changed.size());
+	activeTiles = 0;
+}
+
+int World::getTiles() const
+{
+	return tilesDown * tilesAcross;
+}
+
+int World::getActiveTiles() const
+{
+	return activeTiles;
+}
+
+bool World::takeDirtyTiles(std::vector<unsigned char>& tiles)
+{
+	tiles.assign(dirty.begin(), dirty.end());
+	bool any = false;
+	for(size_t tile = 0; tile < dirty.size(); tile++)
+		any = any || (dirty[tile] != 0);
+	dirty.assign(dirty.size(), 0);
+	return any;
+}
+
+size_t World::getHashLifeMemory() const
+{
+	return hashLifeMemory;
+}
+
+void World::setHashLifeMemory(const size_t maxBytes)
+{
+	hashLifeMemory = (maxBytes > HashLife::MIN_MEMORY) ? maxBytes : HashLife::MIN_MEMORY;
+	if(universe != 0)
+		universe->setMaxMemory(hashLifeMemory);
+}
+
+void World::clearBuffer(uint64_t* board)
+{
+	for(int i = 0; i < rows; i++)
+		memset(board + (int64_t)i * stride, 0, words * sizeof(uint64_t));
+}
+
+void World::wakeTiles()
+{
+	changed.assign(changed.size(), 1);
+	dirty.assign(dirty.size(), 1);
+}
+
+void World::wakeTile(const int row, const int col)
+{
+	const size_t tile = (size_t)(row / tileRows) * tilesAcross + (col >> 6) / tileWords;
+	changed[tile] = 1;
+	dirty[tile] = 1;
+}
+
+int World::getLivingNeighbors(const int row, const int col) const
+{
+	switch(topology)
+	{
+		case TOROIDAL:
+			return countNeighbors<TorusEdges>(front, row, col);
+		case KLEIN:
+			return countNeighbors<KleinEdges>(front, row, col);
+		default:
+			return countNeighbors<DeadEdges>(front, row, col);
 	}
-	return cell->isHealthy();
+}
+
+bool World::isHealthy(const int row, const int col) const
+{
+	return getBit(front, row, col);
 }
 
 void World::setHealth(const int row, const int col, const bool newHealth)
 {
-	Cell* cell = find(row, col);
-	//if(cell == 0)
-	//	throw NullPointerException;
-	//else
-		cell->setHealth(newHealth);
+	if((row < 0) || (row >= rows) || (col < 0) || (col >= cols))
+		return;
+	if(getBit(front, row, col) != newHealth)
+		living += newHealth ? 1 : -1;
+	const int64_t index = (int64_t)row * stride + (col >> 6);
+	const uint64_t position = (uint64_t)row * words + (col >> 6);
+	boardHash ^= hashWord(position, front[index]);
+	setBit(front, row, col, newHealth);
+	boardHash ^= hashWord(position, front[index]);
+	wakeTile(row, col);
+	forgetPeriods();
+	universeStale = true;
+	planeStale = true;
+}
+
+void World::setRun(const int64_t row, const int64_t col, const int64_t length)
+{
+	if(length <= 0)
+		return;
+	if(topology == UNBOUNDED)
+	{
+		if(plane == 0)
+		{
+			plane = new SparsePlane();
+			planeStale = true;
+		}
+		if(planeStale)
+		{
+			plane->load(getLayout(), front);
+			planeStale = false;
+		}
+		plane->setRun(row, col, length);
+	}
+	else
+		planeStale = true;
+	universeStale = true;
+
+	// Only the part of the run on the board goes into the board
+	const int64_t first = (col > 0) ? col : 0;
+	const int64_t last = (col + length < cols) ? col + length : cols;
+	if((row < 0) || (row >= rows) || (first >= last))
+		return;
+	uint64_t* cells = front + row * stride;
+	for(int64_t w = first >> 6; w <= (last - 1) >> 6; w++)
+	{
+		const int64_t begin = (w << 6 > first) ? w << 6 : first;
+		const int64_t end = ((w + 1) << 6 < last) ? (w + 1) << 6 : last;
+		const int count = (int)(end - begin);
+		const uint64_t mask = ((count == 64) ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1) <<
+							  (begin & 63);
+		living += __builtin_popcountll(mask & ~cells[w]);
+		const uint64_t position = (uint64_t)row * words + w;
+		boardHash ^= hashWord(position, cells[w]) ^ hashWord(position, cells[w] | mask);
+		cells[w] |= mask;
+		wakeTile((int)row, (int)(w << 6));
+	}
+	forgetPeriods();
+}
+
+uint64_t World::hashChanges(const uint64_t* before, const uint64_t* after, const int rowBegin,
+							const int rowEnd, const int wordBegin, const int wordEnd) const
+{
+	// While a generation is computed, the edge policy may have parked cells of the halo past the
+	// last column, which are not part of the board
+	const uint64_t lastMask = getLayout().lastMask;
+	uint64_t hash = 0;
+	for(int i = rowBegin; i < rowEnd; i++)
+	{
+		const uint64_t* was = before + (int64_t)i * stride;
+		const uint64_t* now = after + (int64_t)i * stride;
+		// Unchanged words cancel out, which is cheaper than telling them apart on a busy tile
+		const int end = (wordEnd == words) ? wordEnd - 1 : wordEnd;
+		const uint64_t position = (uint64_t)i * words;
+		for(int w = wordBegin; w < end; w++)
+			hash ^= hashWord(position + w, was[w]) ^ hashWord(position + w, now[w]);
+		if(end != wordEnd)
+			hash ^= hashWord(position + end, was[end] & lastMask) ^
+					hashWord(position + end, now[end] & lastMask);
+	}
+	return hash;
+}
+
+uint64_t World::hashBoard() const
+{
+	const uint64_t lastMask = getLayout().lastMask;
+	uint64_t hash = 0;
+	for(int i = 0; i < rows; i++)
+	{
+		const uint64_t* row = front + (int64_t)i * stride;
+		for(int w = 0; w < words; w++)
+		{
+			const uint64_t word = (w == words - 1) ? (row[w] & lastMask) : row[w];
+			hash ^= hashWord((uint64_t)i * words + w, word);
+		}
+	}
+	return hash;
+}
+
+uint64_t World::getHash() const
+{
+	return (periodWindow > 0) ? boardHash : hashBoard();
+}
+
+void World::forgetPeriods()
+{
+	recentNext = 0;
+	recentCount = 0;
+	period = 0;
+	periodStart = 0;
+}
+
+bool World::notePeriod()
+{
+	if(period != 0)
+		return true;
+	if((periodWindow == 0) || (topology == UNBOUNDED))
+		return false;
+
+	// The newest match is the shortest period
+	for(int i = 1; i <= recentCount; i++)
+	{
+		const RecentHash& entry = recent[(recentNext - i + periodWindow) % periodWindow];
+		if(entry.hash == boardHash)
+		{
+			period = turn - entry.turn;
+			periodStart = entry.turn;
+			return true;
+		}
+	}
+	recent[recentNext].hash = boardHash;
+	recent[recentNext].turn = turn;
+	recentNext = (recentNext + 1) % periodWindow;
+	if(recentCount < periodWindow)
+		recentCount++;
+	return false;
+}
+
+int World::getPeriodWindow() const
+{
+	return periodWindow;
+}
+
+void World::setPeriodWindow(const int numTurns)
+{
+	periodWindow = (numTurns > 0) ? numTurns : 0;
+	recent.assign(periodWindow, RecentHash());
+	boardHash = (periodWindow > 0) ? hashBoard() : 0;
+	forgetPeriods();
+}
+
+int64_t World::getPeriod() const
+{
+	return period;
+}
+
+int64_t World::getPeriodStart() const
+{
+	return periodStart;
+}
+
+bool World::getStopOnPeriod() const
+{
+	return stopOnPeriod;
+}
+
+void World::setStopOnPeriod(const bool stop)
+{
+	stopOnPeriod = stop;
+}
+
+void World::setCells(const uint64_t* cells, const int64_t numTurn)
+{
+	const BoardLayout layout = getLayout();
+	living = 0;
+	for(int i = 0; i < rows; i++)
+	{
+		uint64_t* row = front + (int64_t)i * stride;
+		memcpy(row, cells + (int64_t)i * words, words * sizeof(uint64_t));
+		row[words - 1] &= layout.lastMask;
+		for(int w = 0; w < words; w++)
+			living += __builtin_popcountll(row[w]);
+	}
+	boardHash = (periodWindow > 0) ? hashBoard() : 0;
+	born = 0;
+	died = 0;
+	turn = numTurn;
+	wakeTiles();
+	universeStale = true;
+	planeStale = true;
+	forgetPeriods();
+}
+
+HistoryWriter* World::getHistory() const
+{
+	return history;
+}
+
+void World::setHistory(HistoryWriter* writer)
+{
+	history = writer;
+	if(history != 0)
+		history->record(*this);
+}
+
+bool World::saveSnapshot(const std::string& path) const
+{
+	SnapshotHeader header;
+	memset(&header, 0, sizeof(header));
+	header.rows = rows;
+	header.cols = cols;
+	header.words = words;
+	header.stride = stride;
+	header.halo = halo;
+	header.birth = kernelRule.birth;
+	header.survival = kernelRule.survival;
+	header.topology = topology;
+	header.turn = turn;
+	header.population = living;
+	header.dataBytes = bufferBytes(rows, stride);
+	return writeSnapshot(path.c_str(), header, front - halo);
+}
+
+bool World::loadSnapshot(const std::string& path)
+{
+	SnapshotHeader header;
+	uint64_t* block = (uint64_t*)mapSnapshot(path.c_str(), header);
+	if(block == 0)
+		return false;
+
+	// The buffer is used as it is, so its layout must be the one this build gives the same board
+	const int numWords = (header.cols + 63) / 64;
+	const int numStride = (numWords + 2 + LINE_WORDS - 1) / LINE_WORDS * LINE_WORDS;
+	if((header.rows <= 0) || (header.cols <= 0) || (header.words != numWords) ||
+	   (header.stride != numStride) || (header.halo != LINE_WORDS + numStride) ||
+	   (header.dataBytes != bufferBytes(header.rows, numStride)) || (header.birth >= (1u << 9)) ||
+	   (header.survival >= (1u << 9)) || (header.topology < BOUNDED) || (header.topology > KLEIN))
+	{
+		unmapSnapshot(block, header.dataBytes);
+		return false;
+	}
+	uint64_t* numBack;
+	try
+	{
+		numBack = allocBuffer(header.rows, numStride);
+	}
+	catch(const std::bad_alloc&)
+	{
+		unmapSnapshot(block, header.dataBytes);
+		throw;
+	}
+
+	freeBuffer(front);
+	freeBuffer(back);
+	rows = header.rows;
+	cols = header.cols;
+	size = (int64_t)rows * cols;
+	words = numWords;
+	stride = numStride;
+	halo = header.halo;
+	front = block + halo;
+	back = numBack;
+	mappedBoard = front;
+	mappedBytes = header.dataBytes;
+
+	turn = header.turn;
+	living = header.population;
+	born = 0;
+	died = 0;
+	topology = (Topology)header.topology;
+	KernelRule newRule;
+	newRule.birth = header.birth;
+	newRule.survival = header.survival;
+	applyRule(newRule);
+	setTileShape(tileRows, tileWords * 64);
+	universeStale = true;
+	planeStale = true;
+	boardHash = (periodWindow > 0) ? hashBoard() : 0;
+	return true;
+}
+
+std::string World::getRule() const
+{
+	return formatRule(kernelRule);
+}
+
+bool World::setRule(const std::string& rulestring)
+{
+	KernelRule newRule;
+	if(!parseRule(rulestring.c_str(), newRule))
+		return false;
+	applyRule(newRule);
+	return true;
 }
 
 void World::setRule1(const int rule)
@@ -203,6 +737,7 @@ void World::setRule1(const int rule)
 		rules.rule1 = rule;
 	else
 		rules.rule1 = 2;
+	applyRule(getClassicRule());
 }
 
 void World::setRule2(const int rule)
@@ -211,6 +746,7 @@ void World::setRule2(const int rule)
 		rules.rule2 = rule;
 	else
 		rules.rule2 = 3;
+	applyRule(getClassicRule());
 }
 
 void World::setRule3(const int rule)
@@ -219,41 +755,271 @@ void World::setRule3(const int rule)
 		rules.rule3 = rule;
 	else
 		rules.rule3 = 3;
+	applyRule(getClassicRule());
 }
 
-void World::play(const int numTurns)
+template<class Edges>
+void World::playScalar()
 {
-	for(int i = 0; i < numTurns; i++)
+	born = 0;
+	died = 0;
+	for(int j = 0; j < rows; j++)
 	{
-		for(int j = 0; j < rows; j++)
+		for(int k = 0; k < cols; k++)
 		{
-			for(int k = 0; k < cols; k++)
+			bool health, newHealth;
+			int numLiving;
+			health = getBit(front, j, k);
+			numLiving = countNeighbors<Edges>(front, j, k);
+			// Look the cell up in the survival or birth set of the rule
+			newHealth = (((health ? kernelRule.survival : kernelRule.birth) >> numLiving) & 1) != 0;
+			if(newHealth != health)
 			{
-				bool health, newHealth;
-				int numLiving;
-				health = isHealthy(j, k);
-				numLiving = getLivingNeighbors(j, k);
-				/* The following if-else chain is structured the way it is to promote efficiency in 
-				checking the rules for each cell. If the first rule changes the health of the cell,
-				the next don't need to be checked, and so on. Could have put the repeated code in a
-				function but I think it might be more efficient this way. Not sure though... */
-				newHealth = checkRule1(health, numLiving); // Check rule 1
-				if(health != newHealth)
-					setHealth(j, k, newHealth);
+				if(newHealth)
+					born++;
 				else
+					died++;
+			}
+			// The next generation goes into the back buffer so neighbors still see this one
+			setBit(back, j, k, newHealth);
+		}
+	}
+}
+
+template<class Edges>
+bool World::isAwake(const int tileRow, const int tileCol) const
+{
+	for(int i = tileRow - 1; i <= tileRow + 1; i++)
+	{
+		for(int j = tileCol - 1; j <= tileCol + 1; j++)
+		{
+			int ni = i, nj = j;
+			if((nj < 0) || (nj >= tilesAcross))
+			{
+				if(!Edges::WRAPS)
+					continue;
+				nj = (nj < 0) ? nj + tilesAcross : nj - tilesAcross;
+			}
+			if((ni < 0) || (ni >= tilesDown))
+			{
+				if(!Edges::WRAPS)
+					continue;
+				ni = (ni < 0) ? ni + tilesDown : ni - tilesDown;
+
+				// A flipped edge meets tiles that need not line up with this one, so the whole
+				// row of tiles on the other side counts
+				if(Edges::MIRRORS)
 				{
-					newHealth = checkRule2(health, numLiving); // Check rule 2
-					if(health != newHealth)
-						setHealth(j, k, newHealth);
-					else
+					for(int k = 0; k < tilesAcross; k++)
 					{
-						newHealth = checkRule3(health, numLiving); // Check rule 3
-						if(health != newHealth)
-							setHealth(j, k, newHealth);
+						if(changed[(size_t)ni * tilesAcross + k] != 0)
+							return true;
 					}
+					continue;
 				}
-				// Otherwise, leave the cell alone.
 			}
+			if(changed[(size_t)ni * tilesAcross + nj] != 0)
+				return true;
+		}
+	}
+	return false;
+}
+
+template<class Edges>
+void World::playTiles(const RuleTable& rule)
+{
+	// Only the tiles with a changed tile in their 3x3 block of tiles can change
+	active.clear();
+	for(int i = 0; i < tilesDown; i++)
+	{
+		for(int j = 0; j < tilesAcross; j++)
+		{
+			if(isAwake<Edges>(i, j))
+				active.push_back(i * tilesAcross + j);
+		}
+	}
+	changing.assign(changing.size(), 0);
+	activeTiles = (int)active.size();
+
+	const BoardLayout layout = getLayout();
+	const std::function<void(int)> job = [&](const int index)
+	{
+		const int tile = active[index];
+		const int rowBegin = (tile / tilesAcross) * tileRows;
+		const int rowEnd = (rowBegin + tileRows < rows) ? rowBegin + tileRows : rows;
+		const int wordBegin = (tile % tilesAcross) * tileWords;
+		const int wordEnd = (wordBegin + tileWords < words) ? wordBegin + tileWords : words;
+		changing[tile] = stepKernel(kernel, layout, front, back, rowBegin, rowEnd, wordBegin,
+									wordEnd, rule, tileCounts[tile]);
+		tileHashes[tile] = (changing[tile] && (periodWindow > 0)) ?
+						   hashChanges(front, back, rowBegin, rowEnd, wordBegin, wordEnd) : 0;
+	};
+	if(pool != 0)
+		pool->run(activeTiles, job);
+	else
+	{
+		for(int index = 0; index < activeTiles; index++)
+			job(index);
+	}
+	changed.swap(changing);
+
+	// Dormant tiles neither gain nor lose cells
+	born = 0;
+	died = 0;
+	for(int index = 0; index < activeTiles; index++)
+	{
+		born += tileCounts[active[index]].born;
+		died += tileCounts[active[index]].died;
+		boardHash ^= tileHashes[active[index]];
+		dirty[active[index]] |= changed[active[index]];
+	}
+}
+
+void World::playHashLife(const int64_t numTurns)
+{
+	if(universe == 0)
+	{
+		universe = new HashLife(kernelRule, hashLifeMemory);
+		universeStale = true;
+	}
+	if(universeStale)
+	{
+		universe->load(getLayout(), front);
+		universeStale = false;
+	}
+	universe->run((uint64_t)numTurns);
+	planeStale = true;
+
+	clearBuffer(back);
+	universe->store(getLayout(), back);
+	countChanges();
+	wakeTiles();
+	turn += numTurns;
+	if(history != 0)
+		history->record(*this);
+	notePeriod();
+}
+
+void World::playPlane(const int64_t numTurns)
+{
+	if(plane == 0)
+	{
+		plane = new SparsePlane();
+		planeStale = true;
+	}
+	if(planeStale)
+	{
+		plane->load(getLayout(), front);
+		planeStale = false;
+	}
+	for(int64_t i = 0; i < numTurns; i++)
+		plane->step(ruleTable, pool);
+	universeStale = true;
+
+	clearBuffer(back);
+	plane->store(getLayout(), back);
+	countChanges();
+	wakeTiles();
+	turn += numTurns;
+	if(history != 0)
+		history->record(*this);
+	notePeriod();
+}
+
+void World::countChanges()
+{
+	born = 0;
+	died = 0;
+	for(int i = 0; i < rows; i++)
+	{
+		const uint64_t* before = front + (int64_t)i * stride;
+		const uint64_t* after = back + (int64_t)i * stride;
+		for(int w = 0; w < words; w++)
+		{
+			const uint64_t diff = before[w] ^ after[w];
+			if(diff != 0)
+			{
+				born += __builtin_popcountll(diff & after[w]);
+				died += __builtin_popcountll(diff & before[w]);
+				if(periodWindow > 0)
+					boardHash ^= hashWord((uint64_t)i * words + w, before[w]) ^
+								 hashWord((uint64_t)i * words + w, after[w]);
+			}
+		}
+	}
+	living += born - died;
+
+	uint64_t* swap = front;
+	front = back;
+	back = swap;
+}
+
+void World::play(const int64_t numTurns)
+{
+	if((numTurns <= 0) || (stopOnPeriod && (period != 0)))
+		return;
+	// The generation play() starts from is the first to compare the next ones with
+	if((recentCount == 0) && (periodWindow > 0))
+		notePeriod();
+	// A rule giving birth with no living neighbors would fill the unbounded plane, so it only ever
+	// runs on the board itself. Neither can HashLife wrap the board, so a torus or a Klein bottle
+	// is stepped on the board with any engine.
+	const bool finite = (kernelRule.birth & 1) == 0;
+	const bool wraps = (topology == TOROIDAL) || (topology == KLEIN);
+	if((engine == HASHLIFE) && finite && !wraps)
+	{
+		playHashLife(numTurns);
+		return;
+	}
+	switch(topology)
+	{
+		case UNBOUNDED:
+			if(finite)
+				playPlane(numTurns);
+			else
+				playBoard<DeadEdges>(numTurns);
+			break;
+		case TOROIDAL:
+			playBoard<TorusEdges>(numTurns);
+			break;
+		case KLEIN:
+			playBoard<KleinEdges>(numTurns);
+			break;
+		default:
+			playBoard<DeadEdges>(numTurns);
+			break;
+	}
+}
+
+template<class Edges>
+void World::playBoard(const int64_t numTurns)
+{
+	const BoardLayout layout = getLayout();
+	universeStale = true;
+	planeStale = true;
+	for(int64_t i = 0; i < numTurns; i++)
+	{
+		Edges::fillHalo(layout, front);
+		if(engine == SCALAR)
+		{
+			playScalar<Edges>();
+			if(periodWindow > 0)
+				boardHash ^= hashChanges(front, back, 0, rows, 0, words);
+			wakeTiles();
 		}
+		else
+			playTiles<Edges>(ruleTable);
+		Edges::clearHalo(layout, front);
+		living += born - died;
+
+		// The next generation becomes the current one
+		uint64_t* swap = front;
+		front = back;
+		back = swap;
+		turn++;
+		if(history != 0)
+			history->record(*this);
+		if(notePeriod() && stopOnPeriod)
+			break;
 	}
 }
@@ -15,425 +15,1631 @@
 
 #include <iostream>
 #include <string>
-#include "cell.h"
+#include <stdint.h>
+#include <vector>
+#include "kernel.h"
 //#include "gobject.h"
 //#include "error.h"
 using std::cerr;
 using std::string;
 
+class ThreadPool;
+class HashLife;
+class SparsePlane;
+class HistoryWriter;
+
 /***************************************************************************************************
  Class:
 	World
 
  Description:
-	Defines the environment for the game to take place.
+	Defines the environment for the game to take place.
+
+ Remarks:
+	The board is stored bit-packed rather than as individual Cell objects. The Cell class is no
+	longer used by the world.
+***************************************************************************************************/
+
+class World /*: public Gobject, public Error*/
+{
+
+public:
+
+	/* The engines that can evolve the world:
+		1.	SCALAR - Visits the cells one at a time and applies the rules to each of them.
+		2.	SWAR - Evolves 64 cells at a time with bitwise arithmetic on the packed board, or 256 or
+			512 at a time with AVX2 or AVX-512 if the CPU supports them (see getKernel()).
+		3.	HASHLIFE - Jumps ahead by powers of two generations with the HashLife algorithm.
+	SCALAR and SWAR produce exactly the same generations. HASHLIFE evolves the board as a window
+	onto the unbounded plane: cells that leave the board keep evolving off of it and may come back,
+	which makes it the engine of choice for gliders and guns run for billions of turns. */
+	enum Engine {SCALAR, SWAR, HASHLIFE};
+
+	/* The shapes of the space the cells live in:
+		1.	BOUNDED - The board is all there is. Cells off of its edges are always dead.
+		2.	UNBOUNDED - The board is a window onto the unbounded plane. The plane is stored as 64x64
+			chunks of cells, and only the chunks with living cells are kept, so the memory used
+			grows with the population rather than with the area the pattern has spread over.
+		3.	TOROIDAL - The left edge of the board is glued to the right edge and the top edge to the
+			bottom edge, so nothing is ever lost off of the board.
+		4.	KLEIN - Like TOROIDAL, but the top edge is glued to the bottom edge flipped left to
+			right, which makes a Klein bottle.
+	The HASHLIFE engine works on the unbounded plane, so it cannot wrap the board: TOROIDAL and
+	KLEIN worlds are stepped as by SWAR whatever the engine. */
+	enum Topology {BOUNDED, UNBOUNDED, TOROIDAL, KLEIN};
+
+private:
+
+	/* The board of the game. Each generation is stored bit-packed, one bit per cell, in a single
+	contiguous block of 64-bit words. Bit (col % 64) of word (row * stride + col / 64) holds the
+	health of the cell at (row, col). The front buffer holds the current generation and the back
+	buffer receives the next one while it is computed, after which the two are swapped. Both point
+	at row 0 of their block (see HALO). */
+	uint64_t* front;
+	uint64_t* back;
+
+	/* The buffer mapped from a snapshot by loadSnapshot(), which is unmapped rather than freed, and
+	the size of its block, or NULL if neither buffer came from a snapshot. */
+	uint64_t* mappedBoard;
+	size_t mappedBytes;
+
+	/* The number of 64-bit words needed to hold one row of cells. */
+	int words;
+
+	/* The distance in words between the starts of two consecutive rows. Each row is padded to a
+	whole number of cache lines and always has at least two dead words of padding after its cells,
+	so reading one word past either end of a row never leaves the board. */
+	int stride;
+
+	/* The number of words in front of row 0 of each block: a cache line of padding followed by one
+	dead halo row above the board. A second dead halo row follows the last row. The halos let the
+	neighbors of a border cell be read without bounds checks. */
+	static const int LINE_WORDS = 8;
+	int halo;
+
+	/* The number of rows of the grid. */
+	int rows;
+
+	/* The number of columns of the grid. */
+	int cols;
+
+	/* The number of cells in the grid. Really just rows * columns but it's provided for
+	convenience. */
+	int64_t size;
+
+	/* The turn number of the game. */
+	int64_t turn;
+
+	/* The number of living cells on the board, and the number of cells born and died during the
+	last generation. They are kept up to date by the engines as they go, so reading them costs
+	nothing, and every world has its own. */
+	int64_t living;
+	int64_t born;
+	int64_t died;
+
+	/* The rules are defined as follows:
+        1.	Any live cell with fewer than (rule1) live neighbors dies, as if caused by
+			under-population.
+		2.	Any live cell with more than (rule3) live neighbors dies, as if by overcrowding.
+		3.	Any dead cell with exactly (rule4) live neighbors becomes a live cell, as if by
+			reproduction. */
+	struct Rules
+	{
+		int rule1;
+		int rule2;
+		int rule3;
+	};
+
+	/* Contains the current configuration for rules. */
+	Rules rules;
+
+	/* The rule in force, as birth and survival sets, and the same rule compiled for the kernels.
+	It is either the rule made of rules or a rule set from a rulestring. Compiling happens only
+	when the rule changes, so switching rules costs nothing per cell. */
+	KernelRule kernelRule;
+	RuleTable ruleTable;
+
+	/* The engine used by play(). */
+	Engine engine;
+
+	/* The implementation of the SWAR engine, the widest one supported by the CPU unless changed. */
+	KernelType kernel;
+
+	/* The threads stepping the tiles of the board, or NULL if play() runs on the calling thread
+	alone. */
+	ThreadPool* pool;
+
+	/* The shape of the tiles the board is split into for the SWAR engine: tileRows rows of
+	tileWords words each. Tiles are stepped independently, so the board is always evolved the same
+	way whatever the number of threads. */
+	int tileRows;
+	int tileWords;
+
+	/* The number of tiles down and across the board. */
+	int tilesDown;
+	int tilesAcross;
+
+	/* Whether each tile changed during the last generation (nonzero) or not, in row-major order,
+	and the same for the generation being computed. A tile whose 3x3 block of tiles did not change
+	is dormant: its next generation is the same as its current one, which is also what the back
+	buffer still holds from the generation before, so it is skipped altogether. */
+	std::vector<unsigned char> changed;
+	std::vector<unsigned char> changing;
+
+	/* The number of cells born and died in each tile during the generation being computed. Each
+	tile has its own entry so the threads never share a counter; they are added up once every
+	tile is finished. */
+	std::vector<TileCounts> tileCounts;
+
+	/* The tiles computed during the current generation. */
+	std::vector<int> active;
+
+	/* The number of tiles computed during the last generation. */
+	int activeTiles;
+
+	/* Whether each tile may have changed since the last call to takeDirtyTiles() (nonzero) or
+	not, in row-major order. Set from changing after every generation and by anything else that
+	wakes tiles up. */
+	std::vector<unsigned char> dirty;
+
+	/* The unbounded universe of the HASHLIFE engine, created when it is first used. It is reloaded
+	from the board whenever the board was changed some other way (universeStale) and thrown away
+	when the rules change. */
+	HashLife* universe;
+	bool universeStale;
+
+	/* The memory cap of the HashLife node cache in bytes. */
+	size_t hashLifeMemory;
+
+	/* The shape of the space. */
+	Topology topology;
+
+	/* The unbounded plane of the UNBOUNDED topology, created when it is first used. Like universe,
+	it is reloaded from the board whenever the board was changed some other way (planeStale). */
+	SparsePlane* plane;
+	bool planeStale;
+
+	/* The history every generation played is recorded to, if any. Not owned by the world. */
+	HistoryWriter* history;
+
+	/* The hash of the board (see getHash()), kept up to date while period detection is on, and the
+	changes to it found in each tile during the generation being computed, folded in once every
+	tile is finished. */
+	uint64_t boardHash;
+	std::vector<uint64_t> tileHashes;
+
+	/* A generation remembered for period detection: the hash of its board and its turn. */
+	struct RecentHash
+	{
+		uint64_t hash;
+		int64_t turn;
+	};
+
+	/* The hashes of the last generations played, as a ring of periodWindow entries of which
+	recentCount are filled, the newest one just before recentNext. */
+	std::vector<RecentHash> recent;
+	int periodWindow;
+	int recentNext;
+	int recentCount;
+
+	/* The period of the board and the turn it has repeated since, once a repeat is found, or 0. */
+	int64_t period;
+	int64_t periodStart;
+
+	/* Whether play() stops as soon as the board repeats. */
+	bool stopOnPeriod;
+
+protected:
+
+/***************************************************************************************************
+ Method:
+	bool getBit(const uint64_t* board, int row, int col) const
+
+ Scope:
+	Protected.
+
+ Description:
+	Reads the health of a cell from a bit-packed board.
+
+ Parameters:
+	1.	const uint64_t* board - The board to read (front or back buffer).
+	2.	int row - The row of the cell.
+	3.	int col - The column of the cell.
+
+ Returns:
+	This method returns TRUE if the cell is alive. Cells outside of the world are considered dead
+	and FALSE is returned for them.
+***************************************************************************************************/
+
+	bool getBit(const uint64_t* board, int row, int col) const;
+
+/***************************************************************************************************
+ Method:
+	void setBit(uint64_t* board, int row, int col, bool health)
+
+ Scope:
+	Protected.
+
+ Description:
+	Writes the health of a cell into a bit-packed board.
+
+ Parameters:
+	1.	uint64_t* board - The board to write (front or back buffer).
+	2.	int row - The row of the cell.
+	3.	int col - The column of the cell.
+	4.	bool health - The new health of the cell (TRUE for alive, FALSE for dead).
+
+ Remarks:
+	The location must lie inside of the world.
+***************************************************************************************************/
+
+	void setBit(uint64_t* board, int row, int col, bool health);
+
+/***************************************************************************************************
+ Method:
+	template<class Edges> int countNeighbors(const uint64_t* board, int row, int col) const
+
+ Scope:
+	Protected.
+
+ Description:
+	Counts the living neighbors of a cell on a bit-packed board. The 8 neighbors surround the cell
+	in a 3x3 shell. Edges is the edge policy of the topology (see edges.h).
+
+ Parameters:
+	1.	const uint64_t* board - The board to read (front or back buffer).
+	2.	int row - The row of the cell.
+	3.	int col - The column of the cell.
+
+ Returns:
+	This method returns the number of living neighbors of the cell. Neighbors that lie outside of
+	a bounded world are considered dead.
+***************************************************************************************************/
+
+	template<class Edges> int countNeighbors(const uint64_t* board, int row, int col) const;
+
+/***************************************************************************************************
+ Method:
+	void allocate(int numRows, int numCols)
+
+ Scope:
+	Protected.
+
+ Description:
+	Sets the dimensions of the world and allocates both buffers of the board, aligned to a cache
+	line, with every cell dead. Invalid dimensions (not positive) are replaced by the defaults of 25
+	rows and 35 columns.
+
+ Parameters:
+	1.	int numRows - The number of rows of the board.
+	2.	int numCols - The number of columns of the board.
+
+ Remarks:
+	Throws std::bad_alloc if the board cannot be allocated.
+***************************************************************************************************/
+
+	void allocate(int numRows, int numCols);
+
+/***************************************************************************************************
+ Method:
+	uint64_t* allocBuffer(int numRows, int numStride) const
+
+ Scope:
+	Protected.
+
+ Description:
+	Allocates one cache-line aligned buffer of a board with every cell (and all of the padding)
+	dead.
+
+ Parameters:
+	1.	int numRows - The number of rows of the board.
+	2.	int numStride - The stride of the board.
+
+ Returns:
+	This method returns a pointer to row 0 of the new buffer, which lies LINE_WORDS + numStride
+	words into its block.
+
+ Remarks:
+	Throws std::bad_alloc if the buffer cannot be allocated.
+***************************************************************************************************/
+
+	uint64_t* allocBuffer(int numRows, int numStride) const;
+
+/***************************************************************************************************
+ Method:
+	static size_t bufferBytes(int numRows, int numStride)
+
+ Scope:
+	Protected.
+
+ Description:
+	Determines the size of the block of a buffer of the board, halos and padding included.
+
+ Parameters:
+	1.	int numRows - The number of rows of the board.
+	2.	int numStride - The stride of the board.
+
+ Returns:
+	This method returns the size of the block in bytes.
+***************************************************************************************************/
+
+	static size_t bufferBytes(int numRows, int numStride);
+
+/***************************************************************************************************
+ Method:
+	void freeBuffer(uint64_t* board)
+
+ Scope:
+	Protected.
+
+ Description:
+	Frees a buffer obtained from allocBuffer(), or unmaps it if it was mapped from a snapshot.
+
+ Parameters:
+	1.	uint64_t* board - A pointer to row 0 of the buffer.
+***************************************************************************************************/
+
+	void freeBuffer(uint64_t* board);
+
+/***************************************************************************************************
+ Method:
+	KernelRule getClassicRule() const
+
+ Scope:
+	Protected.
+
+ Description:
+	Translates rule1, rule2 and rule3 into birth and survival sets. A living cell survives with
+	between (rule1) and (rule2) living neighbors, and a dead cell is born with exactly (rule3)
+	living neighbors.
+
+ Returns:
+	This method returns the rules in kernel form.
+***************************************************************************************************/
+
+	KernelRule getClassicRule() const;
+
+/***************************************************************************************************
+ Method:
+	KernelRule getKernelRule() const
+
+ Scope:
+	Protected.
+
+ Description:
+	Gets the rule in force as the birth and survival sets used by the kernels.
+
+ Returns:
+	This method returns the rule in kernel form.
+***************************************************************************************************/
+
+	KernelRule getKernelRule() const;
+
+/***************************************************************************************************
+ Method:
+	void applyRule(const KernelRule& newRule)
+
+ Scope:
+	Protected.
+
+ Description:
+	Puts a rule in force and compiles it for the kernels. Every tile is woken up and the HashLife
+	universe, which has the old rule built in, is thrown away.
+
+ Parameters:
+	1.	const KernelRule& newRule - The new rule.
+***************************************************************************************************/
+
+	void applyRule(const KernelRule& newRule);
+
+/***************************************************************************************************
+ Method:
+	template<class Edges> void playBoard(int64_t numTurns)
+
+ Scope:
+	Protected.
+
+ Description:
+	Plays the game a specified number of turns on the bounded board with the SCALAR or SWAR
+	engine. Edges is the edge policy of the topology (see edges.h): it writes the halo around the
+	front buffer before every generation and clears it afterwards, so the kernels never branch on
+	the edges.
+
+ Parameters:
+	1.	int64_t numTurns - The number of turns the game will be played.
+***************************************************************************************************/
+
+	template<class Edges> void playBoard(int64_t numTurns);
+
+/***************************************************************************************************
+ Method:
+	template<class Edges> void playScalar()
+
+ Scope:
+	Protected.
+
+ Description:
+	Computes the next generation into the back buffer one cell at a time (the SCALAR engine).
+***************************************************************************************************/
+
+	template<class Edges> void playScalar();
+
+/***************************************************************************************************
+ Method:
+	template<class Edges> void playTiles(const RuleTable& rule)
+
+ Scope:
+	Protected.
+
+ Description:
+	Computes the next generation into the back buffer tile by tile with the SWAR engine, spreading
+	the tiles over the thread pool. Returns once every tile is finished. With wrapping edges, the
+	tiles on one edge wake the tiles on the opposite edge.
+
+ Parameters:
+	1.	const RuleTable& rule - The compiled rule of the game.
+***************************************************************************************************/
+
+	template<class Edges> void playTiles(const RuleTable& rule);
+
+/***************************************************************************************************
+ Method:
+	template<class Edges> bool isAwake(int tileRow, int tileCol) const
+
+ Scope:
+	Protected.
+
+ Description:
+	Determines whether a tile may change in the next generation, which is the case if any tile of
+	its 3x3 block of tiles changed in the last one.
+
+ Returns:
+	This method returns TRUE if the tile has to be computed.
+***************************************************************************************************/
+
+	template<class Edges> bool isAwake(int tileRow, int tileCol) const;
+
+/***************************************************************************************************
+ Method:
+	void wakeTiles()
+
+ Scope:
+	Protected.
+
+ Description:
+	Marks every tile as changed so that the whole board is computed next generation. Used whenever
+	the board or the rules change outside of the SWAR engine.
+***************************************************************************************************/
+
+	void wakeTiles();
+
+/***************************************************************************************************
+ Method:
+	void wakeTile(int row, int col)
+
+ Scope:
+	Protected.
+
+ Description:
+	Marks the tile holding a cell as changed so that it and its neighboring tiles are computed next
+	generation.
+
+ Parameters:
+	1.	int row - The row of the cell.
+	2.	int col - The column of the cell.
+***************************************************************************************************/
+
+	void wakeTile(int row, int col);
+
+/***************************************************************************************************
+ Method:
+	void playHashLife(int64_t numTurns)
+
+ Scope:
+	Protected.
+
+ Description:
+	Plays the game a specified number of turns with the HASHLIFE engine and copies the part of the
+	universe that lies on the board into the front buffer.
+
+ Parameters:
+	1.	int64_t numTurns - The number of turns the game will be played.
+***************************************************************************************************/
+
+	void playHashLife(int64_t numTurns);
+
+/***************************************************************************************************
+ Method:
+	void playPlane(int64_t numTurns)
+
+ Scope:
+	Protected.
+
+ Description:
+	Plays the game a specified number of turns on the unbounded plane and copies the part of the
+	plane that lies on the board into the front buffer.
+
+ Parameters:
+	1.	int64_t numTurns - The number of turns the game will be played.
+***************************************************************************************************/
+
+	void playPlane(int64_t numTurns);
+
+/***************************************************************************************************
+ Method:
+	void countChanges()
+
+ Scope:
+	Protected.
+
+ Description:
+	Counts the cells born and died between the front buffer and the back buffer, which holds the
+	board after a jump of any number of generations, then makes the back buffer the front one and
+	brings the number of living cells up to date.
+***************************************************************************************************/
+
+	void countChanges();
+
+/***************************************************************************************************
+ Method:
+	uint64_t hashChanges(const uint64_t* before, const uint64_t* after, int rowBegin, int rowEnd,
+						 int wordBegin, int wordEnd) const
+
+ Scope:
+	Private.
+
+ Description:
+	Finds how the hash of the board changes from one board to another over a block of words, by
+	looking at the words that differ only.
+
+ Parameters:
+	1.	const uint64_t* before - Row 0 of the board before.
+	2.	const uint64_t* after - Row 0 of the board after.
+	3.	int rowBegin and int rowEnd - The rows of the block, rowEnd excluded.
+	4.	int wordBegin and int wordEnd - The words of each row of the block, wordEnd excluded.
+
+ Returns:
+	This method returns what to combine with the hash of before, by exclusive or, to get the hash
+	of after.
+***************************************************************************************************/
+
+	uint64_t hashChanges(const uint64_t* before, const uint64_t* after, int rowBegin, int rowEnd,
+						 int wordBegin, int wordEnd) const;
+
+/***************************************************************************************************
+ Method:
+	uint64_t hashBoard() const
+
+ Scope:
+	Private.
+
+ Description:
+	Hashes the whole board from scratch.
+
+ Returns:
+	This method returns the hash of the board.
+***************************************************************************************************/
+
+	uint64_t hashBoard() const;
+
+/***************************************************************************************************
+ Method:
+	void forgetPeriods()
+
+ Scope:
+	Private.
+
+ Description:
+	Forgets the generations remembered for period detection and the period found, because the
+	board or the rule was changed by something other than play().
+***************************************************************************************************/
+
+	void forgetPeriods();
+
+/***************************************************************************************************
+ Method:
+	bool notePeriod()
+
+ Scope:
+	Private.
+
+ Description:
+	Looks the hash of the current generation up among the recent ones, then remembers it. Called
+	after every generation play() computes.
+
+ Returns:
+	This method returns TRUE if the board is known to repeat.
+***************************************************************************************************/
+
+	bool notePeriod();
+
+/***************************************************************************************************
+ Method:
+	void clearBuffer(uint64_t* board)
+
+ Scope:
+	Protected.
+
+ Description:
+	Kills every cell of a buffer of the board.
+
+ Parameters:
+	1.	uint64_t* board - Row 0 of the buffer.
+***************************************************************************************************/
+
+	void clearBuffer(uint64_t* board);
+
+private:
+
+	/* Worlds own their boards and cannot be copied. */
+	World(const World&);
+	World& operator=(const World&);
+
+public:
+
+/***************************************************************************************************
+ Method:
+	World()
+
+ Scope:
+	Public.
+
+ Description:
+	The default constructor. Initializes the number of rows and columns of the grid to 25 and 35.
+	The size is set to 875. Every cell is initialized dead. The turn number is set to 0. The rules
+	are set to their default values.
+***************************************************************************************************/
+
+	World();
+
+/***************************************************************************************************
+ Method:
+	World(int aSize, int rule1, int rule2, int rule3)
+
+ Scope:
+	Public.
+
+ Description:
+	A constructor. Initializes the number of rows and columns of the grid by size / 2. The size of
+    the grid is then set to rows * columns. Each cell is initialized to it's default configuration
+    (normal and dead). The turn number is set to 0. The rules are set to their specified values. A
+    value of 0 for a rule sets that particular to rule to its default value.
+
+ Parameters:
+	1.	int aSize - The value used to determine the size of the grid.
+	2.	int rule1 - The value rule 1 will be set to.
+	3.	int rule2 - The value rule 2 will be set to.
+	4.	int rule3 - The value rule 3 will be set to.
+
+ Remarks:
+	Memory tests for recommended sizes must be performed.
+***************************************************************************************************/
+
+	World(int aSize, int rule1, int rule2, int rule3);
+
+/***************************************************************************************************
+ Method:
+	World(int numRows, int numCols)
+
+ Scope:
+	Public.
+
+ Description:
+	A constructor. Initializes the number of rows and columns of the grid to the specified values.
+	The size of the grid is set to rows * columns. Every cell is initialized dead. The turn number
+	is set to 0. The rules are set to their default values.
+
+ Parameters:
+	1.	const int numRows - The number of rows the grid will be set to.
+	2.	const int numCols - The number of cols the grid will be set to.
+
+ Remarks:
+	The board takes roughly rows * columns / 4 bytes (two generations of one bit per cell), so
+	boards of hundreds of millions of cells are fine.
+***************************************************************************************************/
+
+	World(int numRows, int numCols);
+
+/***************************************************************************************************
+ Method:
+	World(int numRows, int numCols, int rule1, int rule2, int rule3)
+
+ Scope:
+	Public.
+
+ Description:
+	A constructor. Initializes the number of rows and columns of the grid to the specified values.
+    The size of the grid is set to rows * columns. Each cell is initialized to it's default
+    configuration (normal and dead). The turn number is set to 0. The rules are set to their
+    specified values. A value of 0 for a rule sets that particular to rule to its default value.
+
+ Parameters:
+	1.	const int numRows - The number of rows the grid will be set to.
+	2.	const int numCols - The number of cols the grid will be set to.
+	3.	const int rule1 - The value rule 1 will be set to.
+	4.	const int rule2 - The value rule 2 will be set to.
+	5.	const int rule3 - The value rule 3 will be set to.
+
+ Remarks:
+	Memory tests for recommended sizes must be performed.
+***************************************************************************************************/
+
+	World(int numRows, int numCols, int rule1, int rule2, int rule3);
+
+/***************************************************************************************************
+ Method:
+	~World()
+
+ Scope:
+	Public.
+
+ Description:
+	The default destructor. Frees both buffers of the board.
+***************************************************************************************************/
+
+	~World();
+
+/***************************************************************************************************
+ Method:
+	int getRows() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of rows of the grid.
+
+ Returns:
+	This method returns the number of rows of the grid.
+***************************************************************************************************/
+
+	int getRows() const;
+
+/***************************************************************************************************
+ Method:
+	int getCols() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of columns of the grid.
+
+ Returns:
+	This method returns the number of columns of the grid.
+***************************************************************************************************/
+
+	int getCols() const;
+
+/***************************************************************************************************
+ Method:
+	int64_t getSize() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the size of the grid.
+
+ Returns:
+	This method returns the size of the grid (rows * columns).
+***************************************************************************************************/
+
+	int64_t getSize() const;
+
+/***************************************************************************************************
+ Method:
+	int64_t getTurn() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the turn number of the game.
+
+ Returns:
+	This method returns the turn number of the game.
+***************************************************************************************************/
+
+	int64_t getTurn() const;
+
+/***************************************************************************************************
+ Method:
+	int64_t getPopulation() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of living cells on the board.
+
+ Returns:
+	This method returns the number of living cells on the board.
+***************************************************************************************************/
+
+	int64_t getPopulation() const;
+
+/***************************************************************************************************
+ Method:
+	int64_t getBorn() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of cells born during the last generation.
+
+ Returns:
+	This method returns the number of cells born during the last generation, or 0 before the first
+	one.
+
+ Remarks:
+	The HASHLIFE engine and the unbounded plane only bring the board up to date at the end of a call
+	to play(), so for them the count covers every generation of the call: a cell born and killed
+	again in between is not counted. The same holds for getDied().
+***************************************************************************************************/
+
+	int64_t getBorn() const;
+
+/***************************************************************************************************
+ Method:
+	int64_t getDied() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of cells that died during the last generation.
+
+ Returns:
+	This method returns the number of cells that died during the last generation, or 0 before the
+	first one.
+***************************************************************************************************/
+
+	int64_t getDied() const;
+
+/***************************************************************************************************
+ Method:
+	BoardLayout getLayout() const
+
+ Scope:
+	Public.
+
+ Description:
+	Describes the layout of the board buffers for the kernels, and for anything reading the board
+	through getBoard().
+
+ Returns:
+	This method returns the layout of the board.
+***************************************************************************************************/
+
+	BoardLayout getLayout() const;
+
+/***************************************************************************************************
+ Method:
+	const uint64_t* getBoard() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the bit-packed cells of the current generation, laid out as getLayout() describes, so
+	that the whole board can be read a word at a time rather than a cell at a time.
+
+ Returns:
+	This method returns a pointer to row 0 of the board.
+
+ Remarks:
+	The pointer stays valid for the life of the world, but it points at the other buffer after
+	every call to play(), so it must be fetched again once the world has been played.
+***************************************************************************************************/
+
+	const uint64_t* getBoard() const;
+
+/***************************************************************************************************
+ Method:
+	int getRule1() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets rule 1 of the game.
+
+ Returns:
+	This method returns the value of rule 1 of the game.
+***************************************************************************************************/
+
+	int getRule1() const;
+
+/***************************************************************************************************
+ Method:
+	int getRule2() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets rule 2 of the game.
+
+ Returns:
+	This method returns the value of rule 2 of the game.
+***************************************************************************************************/
+
+	int getRule2() const;
+
+/***************************************************************************************************
+ Method:
+	int getRule3() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets rule 3 of the game.
+
+ Returns:
+	This method returns the value of rule 3 of the game.
+***************************************************************************************************/
+
+	int getRule3() const;
+
+/***************************************************************************************************
+ Method:
+	std::string getRule() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the rule in force as a rulestring in B/S notation. The default rules give "B3/S23".
+
+ Returns:
+	This method returns the rulestring of the game.
+***************************************************************************************************/
+
+	std::string getRule() const;
+
+/***************************************************************************************************
+ Method:
+	Engine getEngine() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the engine used to evolve the world.
+
+ Returns:
+	This method returns the engine used by play().
+***************************************************************************************************/
+
+	Engine getEngine() const;
+
+/***************************************************************************************************
+ Method:
+	void setEngine(Engine newEngine)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the engine used to evolve the world. The engine can be changed between any two turns
+	without affecting the game.
+
+ Parameters:
+	1.	Engine newEngine - The engine play() will use. The default is SWAR.
+***************************************************************************************************/
+
+	void setEngine(Engine newEngine);
+
+/***************************************************************************************************
+ Method:
+	Topology getTopology() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the shape of the space the cells live in.
+
+ Returns:
+	This method returns the topology of the world.
+***************************************************************************************************/
+
+	Topology getTopology() const;
+
+/***************************************************************************************************
+ Method:
+	void setTopology(Topology newTopology)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the shape of the space the cells live in. Switching to UNBOUNDED starts the plane from the
+	board, and switching away from it forgets the cells off of the board.
+
+ Parameters:
+	1.	Topology newTopology - The topology of the world. The default is BOUNDED.
+***************************************************************************************************/
+
+	void setTopology(Topology newTopology);
+
+/***************************************************************************************************
+ Method:
+	size_t getChunks() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of 64x64 chunks of the unbounded plane that are stored.
+
+ Returns:
+	This method returns the number of chunks, or 0 if the plane is not in use.
+***************************************************************************************************/
+
+	size_t getChunks() const;
+
+/***************************************************************************************************
+ Method:
+	KernelType getKernel() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the implementation used by the SWAR engine. The CPU is checked once at startup and the
+	widest implementation it supports is picked (KERNEL_AVX512, then KERNEL_AVX2, then the portable
+	KERNEL_SWAR). kernelName(getKernel()) gives a name suitable for logs.
 
- Remarks:
-	Depends on Cell class.
+ Returns:
+	This method returns the kernel used by the SWAR engine.
 ***************************************************************************************************/
 
-class World /*: public Gobject, public Error*/
-{
+	KernelType getKernel() const;
 
-private:
+/***************************************************************************************************
+ Method:
+	void setKernel(KernelType newKernel)
 
-    /* The grid of the game. The grid is a 2x2 dynamically allocated matrix whose elements are
-    pointers to dynamically allocated instances of cells. */
-    Cell* grid[25][35];
-    
-	/* The number of rows of the grid. */
-	int rows;
+ Scope:
+	Public.
 
-	/* The number of columns of the grid. */
-	int cols;
+ Description:
+	Sets the implementation used by the SWAR engine, for example to compare kernels. All kernels
+	produce bit-identical results.
 
-	/* The number of cells in the grid. Really just rows * columns but it's provided for
-	convenience. */
-	int size;
+ Parameters:
+	1.	KernelType newKernel - The kernel to use.
 
-	/* The turn number of the game. */
-	int turn;
+ Remarks:
+	A kernel that the CPU does not support is replaced by the widest one it does support.
+***************************************************************************************************/
 
-	/* The rules are defined as follows:
-        1.	Any live cell with fewer than (rule1) live neighbors dies, as if caused by
-			under-population.
-		2.	Any live cell with more than (rule3) live neighbors dies, as if by overcrowding.
-		3.	Any dead cell with exactly (rule4) live neighbors becomes a live cell, as if by
-			reproduction. */
-	struct Rules
-	{
-		int rule1;
-		int rule2;
-		int rule3;
-	};
+	void setKernel(KernelType newKernel);
 
-	/* Contains the current configuration for rules. */
-	Rules rules;
+/***************************************************************************************************
+ Method:
+	int getThreads() const
 
-protected:
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of threads that step the board, including the one calling play().
+
+ Returns:
+	This method returns the number of threads used by play().
+***************************************************************************************************/
+
+	int getThreads() const;
 
 /***************************************************************************************************
  Method:
-	Cell* find(int row, int col)
+	void setThreads(int numThreads)
 
  Scope:
-	Protected.
+	Public.
 
  Description:
-	Determines the pointer to the cell at the specified location.
+	Sets the number of threads that step the board with the SWAR engine. The threads are kept alive
+	between turns and wait at a barrier at the end of every generation. The generations do not
+	depend on the number of threads.
 
  Parameters:
-	1.	int row - The row of the cell (first index of matrix).
-	2.	int col - The column of the cell (second index of matrix).
+	1.	int numThreads - The number of threads, including the one calling play(). A value of 0 uses
+		one thread per hardware thread. The default is 1.
+***************************************************************************************************/
+
+	void setThreads(int numThreads);
+
+/***************************************************************************************************
+ Method:
+	int getTileRows() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of rows of the tiles the board is split into.
 
  Returns:
-	This method returns a pointer to the cell at the specified location.
+	This method returns the height of a tile.
 ***************************************************************************************************/
 
-    Cell* find(int row, int col);
+	int getTileRows() const;
 
 /***************************************************************************************************
  Method:
-	Cell* findNeighbor(int row, int col, int index)
+	int getTileCols() const
 
  Scope:
-	Protected.
+	Public.
 
  Description:
-	Determines the pointer to the neighbor of a cell at the specified location.
-
- Parameters:
-	1.  int row - The row of the cell whose neighbor is being found.
-	2.	int col - The column of the cell whose neighbor is being found.
-	3.	int index - The index of the neighbor. Each cell has 8 neighbors that surround it in a 3x3
-    shell. The top left neighbor is first (starting at at 0) and each subsequent neighbor is
-    linearly clockwise from the previous.
+	Gets the number of columns of the tiles the board is split into. Tiles at the right edge of the
+	board may be narrower.
 
  Returns:
-	This method returns a pointer to the specified neighbor of a specified cell. If a cell is
-	specified with no neighbor in the specified location, NULL is returned.
+	This method returns the width of a tile.
 ***************************************************************************************************/
 
-	Cell* findNeighbor(int row, int col, int index);
+	int getTileCols() const;
 
 /***************************************************************************************************
  Method:
-	bool checkRule1(bool health, int numLiving) const
+	void setTileShape(int numRows, int numCols)
 
  Scope:
-	Protected.
+	Public.
 
  Description:
-	Checks whether a cell would die by under-population given the conditions of its existence.
+	Sets the shape of the tiles the board is split into for the SWAR engine. Tiles are the unit of
+	work handed to the threads. Wide, short tiles (row bands) stream through memory best, while
+	smaller square tiles balance the load better on many threads.
 
  Parameters:
-	1.	bool health - The health of the cell.
-	2.	int numLiving - The number of living neighbors the cell has.
+	1.	int numRows - The number of rows of a tile. A value of 0 or less uses the default of 64.
+	2.	int numCols - The number of columns of a tile, rounded up to a multiple of 512 so that the
+		vector kernels never share a word between tiles. A value of 0 or less makes every tile
+		span the whole width of the board (row bands). The default is 512.
+***************************************************************************************************/
+
+	void setTileShape(int numRows, int numCols);
+
+/***************************************************************************************************
+ Method:
+	int getTiles() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the number of tiles the board is split into.
 
  Returns:
-	This method returns TRUE if the cell is alive after rule 1 is applied or FALSE if the cell is
-	dead after rule 1 is applied.
+	This method returns the number of tiles of the board.
 ***************************************************************************************************/
 
-	bool checkRule1(bool health, int numLiving) const;
+	int getTiles() const;
 
 /***************************************************************************************************
  Method:
-	bool checkRule2(bool health, int numLiving) const
+	int getActiveTiles() const
 
  Scope:
-	Protected.
+	Public.
 
  Description:
-	Checks whether a cell would die by overcrowding given the conditions of its existence.
-
- Parameters:
-	1.	bool health - The health of the cell.
-	2.	int numLiving - The number of living neighbors the cell has.
+	Gets the number of tiles the SWAR engine computed during the last generation. Only the tiles
+	that changed during the generation before and their neighbors are computed; the others are
+	stable and cost nothing. getTiles() - getActiveTiles() is the number of tiles skipped.
 
  Returns:
-	This method returns TRUE if the cell is alive after rule 2 is applied or FALSE if the cell is
-	dead after rule 2 is applied.
+	This method returns the number of active tiles of the last generation.
 ***************************************************************************************************/
 
-    bool checkRule2(bool health, int numLiving) const;
+	int getActiveTiles() const;
 
 /***************************************************************************************************
  Method:
-	bool checkRule3(bool health, int numLiving) const
+	bool takeDirtyTiles(std::vector<unsigned char>& tiles)
 
  Scope:
-	Protected.
+	Public.
 
  Description:
-	Checks whether a cell would revive given the conditions of its existence.
+	Gets the tiles that may have changed since the last call and starts over, so that a view of
+	the board only has to redraw those. With the SWAR engine these are the tiles that changed
+	during the generations played since; edits mark the tile of the cell edited, and anything else
+	that changes the board (the other engines, setCells(), a new topology or tile shape) marks
+	every tile.
 
  Parameters:
-	1.	bool health - The health of the cell.
-	2.	int numLiving - The number of living neighbors the cell has.
+	1.	std::vector<unsigned char>& tiles - Receives one entry per tile, nonzero if the tile may have
+		changed, in row-major order: tile (i, j) covers the rows from i * getTileRows() and the
+		columns from j * getTileCols(), and there are (getCols() + getTileCols() - 1) /
+		getTileCols() tiles across.
 
  Returns:
-	This method returns TRUE if the cell is alive after rule 3 is applied or FALSE if the cell is
-	dead after rule 3 is applied.
+	This method returns TRUE if any tile may have changed.
 ***************************************************************************************************/
 
-	bool checkRule3(bool health, int numLiving) const;
+	bool takeDirtyTiles(std::vector<unsigned char>& tiles);
 
-public:
+/***************************************************************************************************
+ Method:
+	size_t getHashLifeMemory() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the memory cap of the HASHLIFE engine's node cache.
+
+ Returns:
+	This method returns the memory cap in bytes.
+***************************************************************************************************/
+
+	size_t getHashLifeMemory() const;
 
 /***************************************************************************************************
  Method:
-	World()
+	void setHashLifeMemory(size_t maxBytes)
 
  Scope:
 	Public.
 
  Description:
-	The default constructor. Initializes the number of rows and columns of the grid to 100. The size
-    is set to 1000. Each cell is initialized to it's default configuration (normal and dead). The
-    turn number is set to 0. The rules are set to their default values.
+	Sets the memory cap of the HASHLIFE engine's node cache. When the cache reaches the cap, the
+	nodes that are no longer needed and the remembered results are garbage collected.
+
+ Parameters:
+	1.	size_t maxBytes - The memory cap in bytes. The default is 512 MB, and a cap below
+		HashLife::MIN_MEMORY (1 MB) is raised to it.
 ***************************************************************************************************/
 
-	World();
+	void setHashLifeMemory(size_t maxBytes);
 
 /***************************************************************************************************
  Method:
-	World(int aSize, int rule1, int rule2, int rule3)
+	int getLivingNeighbors(int row, int col) const
 
  Scope:
 	Public.
 
  Description:
-	A constructor. Initializes the number of rows and columns of the grid by size / 2. The size of
-    the grid is then set to rows * columns. Each cell is initialized to it's default configuration
-    (normal and dead). The turn number is set to 0. The rules are set to their specified values. A
-    value of 0 for a rule sets that particular to rule to its default value.
+	Determines the number of living neighbors a cell has.
 
  Parameters:
-	1.	int aSize - The value used to determine the size of the grid.
-	2.	int rule1 - The value rule 1 will be set to.
-	3.	int rule2 - The value rule 2 will be set to.
-	4.	int rule3 - The value rule 3 will be set to.
+    1.  int row - The row of the cell.
+	2.	int col - The column of the cell.
+
+ Returns:
+	This method returns the number of living neighbors a cell has.
 
  Remarks:
-	Memory tests for recommended sizes must be performed.
+	For a cell located on the boundary of a bounded or unbounded world, those neighbors that are
+	not on the board are considered dead. Toroidal and Klein bottle worlds wrap around.
 ***************************************************************************************************/
 
-	World(int aSize, int rule1, int rule2, int rule3);
+	int getLivingNeighbors(int row, int col) const;
 
 /***************************************************************************************************
  Method:
-	World(int numRows, int numCols)
+	bool isHealthy(int row, int col) const
 
  Scope:
 	Public.
 
+ Parameters:
+    1.  int row - The row of the cell.
+	2.	int col - The column of the cell.
+ 
  Description:
-	A constructor. Initializes the number of rows and columns of the grid to the specified values.
-    The size of the grid is set to rows * columns. Each cell is initialized to it's default
-    configuration (normal and dead). The turn number is set to 0. The rules are set to their
-    specified values. A value of 0 for a rule sets that particular to rule to its default value.
+	Determines if the specified cell is dead or alive. A living cell has its health member set to
+    TRUE, while an decease cell has its health member set to FALSE.
 
- Parameters:
-	1.	const int numRows - The number of rows the grid will be set to.
-	2.	const int numCols - The number of cols the grid will be set to.
-	3.	const int rule1 - The value rule 1 will be set to.
-	4.	const int rule2 - The value rule 2 will be set to.
-	5.	const int rule3 - The value rule 3 will be set to.
+ Returns:
+	This method returns TRUE if the cell is alive and FALSE if the cell is dead.
+***************************************************************************************************/
 
- Remarks:
-	Memory tests for recommended sizes must be performed.
+	bool isHealthy(int row, int col) const;
+
+/***************************************************************************************************
+ Method:
+	void setHealth(int row, int col, bool newHealth)
+
+ Scope:
+	Public.
+
+ Description:
+	Revives or kills the specified cell.
+
+ Parameters:
+	1.	int row - The row of the cell.
+	2.	int col - The column of the cell.
+	3.	bool newHealth - The new health of the cell (TRUE for alive, FALSE for dead).
 ***************************************************************************************************/
 
-	World(int numRows, int numCols, int rule1, int rule2, int rule3);
+	void setHealth(int row, int col, bool newHealth);
 
 /***************************************************************************************************
  Method:
-	~World()
+	void setRun(int64_t row, int64_t col, int64_t length)
 
  Scope:
 	Public.
 
  Description:
-	The default destructor. Frees the grid.
+	Revives a run of cells, (row, col) to (row, col + length - 1), a word at a time. This is how
+	patterns are loaded (see WorldSink in patternio.h). The part of the run off of the board is
+	dropped, except on the UNBOUNDED topology, where the whole run is written to the unbounded plane
+	as well and is kept for the engines that evolve the plane.
+
+ Parameters:
+	1.	int64_t row - The row of the run.
+	2.	int64_t col - The first column of the run.
+	3.	int64_t length - The number of cells of the run.
+
+ Remarks:
+	Like every other change to the board, a later call to setHealth() rebuilds the plane from the
+	board, which loses the cells off of the board. The HASHLIFE engine always starts from the board.
 ***************************************************************************************************/
 
-	~World();
+	void setRun(int64_t row, int64_t col, int64_t length);
 
 /***************************************************************************************************
  Method:
-	int getRows() const
+	uint64_t getHash() const
 
  Scope:
 	Public.
 
  Description:
-	Gets the number of rows of the grid.
+	Gets a 64-bit hash of the board. Every nonzero word of the board adds a mix of its value and
+	its position, by exclusive or, so while period detection is on the hash is kept up to date
+	from the words that change: the engines only look at the words of the tiles that changed, and
+	editing a cell rehashes one word. Otherwise the board is hashed in full on every call.
 
  Returns:
-	This method returns the number of rows of the grid.
+	This method returns the hash of the board. Equal boards have equal hashes, and different
+	boards of the same size are all but certain to have different ones.
 ***************************************************************************************************/
 
-	int getRows() const;
+	uint64_t getHash() const;
 
 /***************************************************************************************************
  Method:
-	int getCols() const
+	int getPeriodWindow() const
 
  Scope:
 	Public.
 
  Description:
-	Gets the number of columns of the grid.
+	Gets the number of recent generations remembered for period detection.
 
  Returns:
-	This method returns the number of columns of the grid.
+	This method returns the number of generations, which is also the longest period detected.
 ***************************************************************************************************/
 
-	int getCols() const;
+	int getPeriodWindow() const;
 
 /***************************************************************************************************
  Method:
-	int getSize() const
+	void setPeriodWindow(int numTurns)
 
  Scope:
 	Public.
 
  Description:
-	Gets the size of the grid.
+	Sets the number of recent generations remembered for period detection, which is off (0) by
+	default. While it is on, the engines keep the hash of the board up to date, which takes a
+	second look at the tiles that changed, and every generation is looked up among the recent ones.
+	That roughly doubles the cost of a generation of a busy board, but costs little once the board
+	settles, which is when detection pays off.
 
- Returns:
-	This method returns the size of the grid.
+ Parameters:
+	1.	int numTurns - The number of generations, such as 64. 0 turns period detection off.
 ***************************************************************************************************/
 
-	int getSize() const;
+	void setPeriodWindow(int numTurns);
 
 /***************************************************************************************************
  Method:
-	int getTurn() const
+	int64_t getPeriod() const
 
  Scope:
 	Public.
 
  Description:
-	Gets the turn number of the game.
+	Gets the period of the board, found by play() when the hash of a generation matches that of a
+	recent one: 1 for a still life, P for a board that repeats every P generations. The period
+	stays found until the board or the rule is changed by something other than play().
 
  Returns:
-	This method returns the turn number of the game.
+	This method returns the period, or 0 if no repeat has been found.
+
+ Remarks:
+	The HASHLIFE engine and the unbounded plane leap over generations, so with them the period
+	found is the number of turns between the two matching calls to play(), which may be a multiple
+	of the true period. There is no detection on the UNBOUNDED topology, where the board is only a
+	window onto the plane.
 ***************************************************************************************************/
 
-	int getTurn() const;
+	int64_t getPeriod() const;
 
 /***************************************************************************************************
  Method:
-	int getRule1() const
+	int64_t getPeriodStart() const
 
  Scope:
 	Public.
 
  Description:
-	Gets rule 1 of the game.
+	Gets the turn since which the board repeats: the still life or oscillator of getPeriod() is
+	the board of that turn.
 
  Returns:
-	This method returns the value of rule 1 of the game.
+	This method returns the turn, or 0 if no repeat has been found.
 ***************************************************************************************************/
 
-	int getRule1() const;
+	int64_t getPeriodStart() const;
 
 /***************************************************************************************************
  Method:
-	int getRule2() const
+	bool getStopOnPeriod() const
 
  Scope:
 	Public.
 
  Description:
-	Gets rule 2 of the game.
+	Determines whether play() stops as soon as the board repeats.
 
  Returns:
-	This method returns the value of rule 2 of the game.
+	This method returns TRUE if play() stops early.
 ***************************************************************************************************/
 
-	int getRule2() const;
+	bool getStopOnPeriod() const;
 
 /***************************************************************************************************
  Method:
-	int getRule3() const
+	void setStopOnPeriod(bool stop)
 
  Scope:
 	Public.
 
  Description:
-	Gets rule 3 of the game.
+	Sets whether play() stops as soon as the board repeats (it does not by default). A stopped
+	play() leaves the world at the first generation found to repeat, so getTurn() tells how far it
+	got, and further calls do nothing until the board is changed.
 
- Returns:
-	This method returns the value of rule 3 of the game.
+ Parameters:
+	1.	bool stop - TRUE to stop early.
 ***************************************************************************************************/
 
-	int getRule3() const;
+	void setStopOnPeriod(bool stop);
 
 /***************************************************************************************************
  Method:
-	int getLivingNeighbors(int row, int col) const
+	void setCells(const uint64_t* cells, int64_t numTurn)
 
  Scope:
 	Public.
 
  Description:
-	Determines the number of living neighbors a cell has.
+	Replaces every cell of the board at once and sets the turn, as when a generation is read back
+	from a history (see HistoryReader in history.h). The population is counted again and the born
+	and died counts are cleared.
 
  Parameters:
-    1.  int row - The row of the cell.
-	2.	int col - The column of the cell.
+	1.	const uint64_t* cells - The new board: getRows() rows of getLayout().words words each, one
+		after the other, with bit col % 64 of word col / 64 of a row for each cell.
+	2.	int64_t numTurn - The new turn number.
+
+ Remarks:
+	Like setHealth(), this rebuilds the unbounded plane from the board, so on the UNBOUNDED topology
+	the cells off of the board are lost.
+***************************************************************************************************/
+
+	void setCells(const uint64_t* cells, int64_t numTurn);
+
+/***************************************************************************************************
+ Method:
+	HistoryWriter* getHistory() const
+
+ Scope:
+	Public.
+
+ Description:
+	Gets the history the world records its generations to.
 
  Returns:
-	This method returns the number of living neighbors a cell has.
+	This method returns the history writer, or NULL if the world is not recorded.
+***************************************************************************************************/
+
+	HistoryWriter* getHistory() const;
+
+/***************************************************************************************************
+ Method:
+	void setHistory(HistoryWriter* writer)
+
+ Scope:
+	Public.
+
+ Description:
+	Records the world to a history (see history.h): the current generation right away, then every
+	generation play() steps through. The HASHLIFE engine and the unbounded plane leap over
+	generations, so with them only the generation each call to play() ends on is recorded.
+
+ Parameters:
+	1.	HistoryWriter* writer - The history writer, which must outlive the world or be detached
+		first, or NULL to stop recording.
 
  Remarks:
-	For a cell located on the boundary of the world, those neighbors that do not exist are
-	considered dead.
+	Recording copies the board once per generation; the encoding is done on the writer's thread.
+	A writer only takes boards of one size, so after loadSnapshot() changes the size of the world
+	its generations are no longer recorded.
 ***************************************************************************************************/
 
-	int getLivingNeighbors(int row, int col);
+	void setHistory(HistoryWriter* writer);
 
 /***************************************************************************************************
  Method:
-	bool isHealthy(int row, int col) const
+	bool saveSnapshot(const std::string& path) const
 
  Scope:
 	Public.
 
- Parameters:
-    1.  int row - The row of the cell.
-	2.	int col - The column of the cell.
- 
  Description:
-	Determines if the specified cell is dead or alive. A living cell has its health member set to
-    TRUE, while an decease cell has its health member set to FALSE.
+	Writes a checkpoint of the world to a snapshot file (see snapshot.h): the size, rule, turn,
+	topology and population, then the board buffer exactly as it is in memory, in a single write.
+
+ Parameters:
+	1.	const std::string& path - The file to write. It is replaced only once the snapshot is
+		safely on disk.
 
  Returns:
-	This method returns TRUE if the cell is alive and FALSE if the cell is dead.
+	This method returns TRUE if the snapshot was written and FALSE if the file could not be
+	written.
+
+ Remarks:
+	Only the board is saved. On the UNBOUNDED topology, the cells of the plane off of the board are
+	left out, as is the state of the HASHLIFE engine.
 ***************************************************************************************************/
 
-	bool isHealthy(int row, int col);
+	bool saveSnapshot(const std::string& path) const;
 
 /***************************************************************************************************
  Method:
-	void setHealth(int row, int col, bool newHealth)
+	bool loadSnapshot(const std::string& path)
 
  Scope:
 	Public.
 
  Description:
-	Revives or kills the specified cell.
+	Restarts the world from a snapshot file written by saveSnapshot(). The board buffer of the file
+	is mapped into memory and becomes the current generation as it is, with nothing parsed or
+	copied, so the cost of a restart is that of the page faults on the first generation. The size,
+	rule, turn, topology and population are taken from the snapshot; the engine, kernel, threads
+	and tile shape are kept.
 
  Parameters:
-	1.	int row - The row of the cell.
-	2.	int col - The column of the cell.
-	3.	bool newHealth - The new health of the cell (TRUE for alive, FALSE for dead).
+	1.	const std::string& path - The snapshot file.
+
+ Returns:
+	This method returns TRUE if the world was restored and FALSE if the file is not a snapshot this
+	build can map, in which case the world is left as it was.
+
+ Remarks:
+	The mapping is private: generations written into it are copies that never reach the file. The
+	board is trusted as it is, so a damaged file gives a damaged board. Throws std::bad_alloc,
+	leaving the world as it was, if the second buffer cannot be allocated.
 ***************************************************************************************************/
 
-	void setHealth(int row, int col, bool newHealth);
+	bool loadSnapshot(const std::string& path);
 
 /***************************************************************************************************
  Method:
@@ -503,22 +1709,53 @@ public:
 
 /***************************************************************************************************
  Method:
-	void play(int numTurns)
+	bool setRule(const std::string& rulestring)
+
+ Scope:
+	Public.
+
+ Description:
+	Sets the rule of the game from a rulestring, such as "B3/S23" for the default rules, "B36/S23"
+	for HighLife or "B3678/S34678" for Day & Night. The S/B notation ("23/3") is accepted as well.
+	Any number of counts can cause birth or survival, which rule1, rule2 and rule3 cannot express.
+
+ Parameters:
+	1.	const std::string& rulestring - The rulestring.
+
+ Returns:
+	This method returns TRUE if the rulestring is valid. An invalid rulestring leaves the rule
+	unchanged.
+
+ Remarks:
+	Calling setRule1, setRule2 or setRule3 afterwards replaces the rule with the one made of the
+	three rules again. A rule giving birth to cells with no living neighbors (B0) is evolved on the
+	board alone, even with the HASHLIFE engine or the UNBOUNDED topology.
+***************************************************************************************************/
+
+	bool setRule(const std::string& rulestring);
+
+/***************************************************************************************************
+ Method:
+	void play(int64_t numTurns)
 
  Scope:
 	Public.
 
  Description:
-	Plays the game a specified number of turns.
+	Plays the game a specified number of turns. Each turn reads the current generation from the
+	front buffer and writes the next generation into the back buffer, so every cell is evolved from
+	the same generation. The buffers are then swapped. The HASHLIFE engine instead jumps by powers
+	of two turns, so its cost grows roughly with the logarithm of the number of turns. With
+	setStopOnPeriod(), it stops early once the board repeats.
 
  Precondition:
 	The size of the world cannot change during the function call.
 
  Parameters:
-	1.	int numTurns - The number of turns the game will be played.
+	1.	int64_t numTurns - The number of turns the game will be played.
 ***************************************************************************************************/
 
-	void play(int numTurns);
+	void play(int64_t numTurns);
 
 
 };